@@ -0,0 +1,396 @@
+#include "Jahley.h"
+#include <benchmark/benchmark.h>
+
+const std::string APP_NAME = "Kernels";
+
+// Throughput of the dense matrix kernels, reported in GFLOP/s against problem size.
+// A square n x n x n GEMM performs 2 * n^3 floating point operations. A dense layer
+// with n inputs and n outputs over a batch of n samples costs 2 * n^3 forward and
+// 4 * n^3 backward (dW and dX are one GEMM each), so backward is directly comparable.
+// BM_GemmParallel shows how the tiled parallel GEMM scales with the thread count.
+// BM_SparseForward runs a 1024 x 1024 layer with the given percentage of nonzero weights
+// through the CSR kernel; the density at which it drops below BM_DenseLayerForward at the
+// same batch size is the crossover below which pruned layers are worth storing sparse.
+// BM_Dropout runs a dropout forward and backward over 64k activations with the mask drawn
+// per element from generateRandomDouble(0, 1), from one shared mt19937 into a stored mask,
+// or regenerated from the counter-based generator inside the fused kernel.
+// BM_RandomFill fills a buffer with uniform doubles one generateRandomDouble call at a time,
+// from one shared mt19937, or with the bulk counter-based fills on one thread and on a pool
+// of eight (real time), which give the same numbers.
+
+template <typename T>
+static std::vector<T, AlignedAllocator<T, 64>> randomBuffer(size_t n)
+{
+	std::vector<T, AlignedAllocator<T, 64>> v(n);
+	for (auto& x : v)
+	{
+		x = static_cast<T>(generateRandomDouble());
+	}
+	return v;
+}
+
+static void setFlops(benchmark::State& state, double flopsPerIteration)
+{
+	state.counters["GFLOP/s"] = benchmark::Counter(flopsPerIteration * 1e-9, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+template <typename T>
+static void BM_Gemm(benchmark::State& state)
+{
+	const size_t n = static_cast<size_t>(state.range(0));
+	auto A = randomBuffer<T>(n * n);
+	auto B = randomBuffer<T>(n * n);
+	auto C = randomBuffer<T>(n * n);
+
+	for (auto _ : state)
+	{
+		kernels::gemm<T>(n, n, n, T(1), A.data(), n, B.data(), n, T(0), C.data(), n);
+		benchmark::DoNotOptimize(C.data());
+		benchmark::ClobberMemory();
+	}
+	setFlops(state, 2.0 * n * n * n);
+}
+
+// Square GEMM on a pool of range(1) threads. Wall time is what matters here, since the
+// calling thread only waits, so this benchmark uses real time and reports GFLOP/s from it.
+template <typename T>
+static void BM_GemmParallel(benchmark::State& state)
+{
+	const size_t n = static_cast<size_t>(state.range(0));
+	BS::thread_pool pool(static_cast<BS::concurrency_t>(state.range(1)));
+	auto A = randomBuffer<T>(n * n);
+	auto B = randomBuffer<T>(n * n);
+	auto C = randomBuffer<T>(n * n);
+
+	for (auto _ : state)
+	{
+		kernels::gemmParallel<T>(pool, n, n, n, T(1), A.data(), n, B.data(), n, T(0), C.data(), n);
+		benchmark::DoNotOptimize(C.data());
+		benchmark::ClobberMemory();
+	}
+	setFlops(state, 2.0 * n * n * n);
+}
+
+template <typename T>
+static void BM_GemmReference(benchmark::State& state)
+{
+	const size_t n = static_cast<size_t>(state.range(0));
+	auto A = randomBuffer<T>(n * n);
+	auto B = randomBuffer<T>(n * n);
+	auto C = randomBuffer<T>(n * n);
+
+	for (auto _ : state)
+	{
+		kernels::gemmReference<T>(n, n, n, T(1), A.data(), n, 1, B.data(), n, 1, T(0), C.data(), n, 1);
+		benchmark::DoNotOptimize(C.data());
+		benchmark::ClobberMemory();
+	}
+	setFlops(state, 2.0 * n * n * n);
+}
+
+template <typename T>
+static void BM_Gemv(benchmark::State& state)
+{
+	const size_t n = static_cast<size_t>(state.range(0));
+	auto A = randomBuffer<T>(n * n);
+	auto x = randomBuffer<T>(n);
+	auto y = randomBuffer<T>(n);
+
+	for (auto _ : state)
+	{
+		kernels::gemv<T>(n, n, T(1), A.data(), n, x.data(), T(0), y.data());
+		benchmark::DoNotOptimize(y.data());
+		benchmark::ClobberMemory();
+	}
+	setFlops(state, 2.0 * n * n);
+}
+
+template <typename T>
+static void BM_DenseForward(benchmark::State& state)
+{
+	const size_t n = static_cast<size_t>(state.range(0));
+	auto X = randomBuffer<T>(n * n);
+	auto W = randomBuffer<T>(n * n);
+	auto b = randomBuffer<T>(n);
+	auto Y = randomBuffer<T>(n * n);
+
+	for (auto _ : state)
+	{
+		kernels::denseForward<T>(n, n, n, Activation::TanH, X.data(), n, W.data(), n, b.data(), Y.data(), n);
+		benchmark::DoNotOptimize(Y.data());
+		benchmark::ClobberMemory();
+	}
+	setFlops(state, 2.0 * n * n * n);
+}
+
+// Dense forward over small batches: range(0) inputs and outputs, range(1) samples. These
+// batches read each weight once per call, so the time tracks the weight bytes.
+template <typename T>
+static void BM_DenseForwardBatch(benchmark::State& state)
+{
+	const size_t n = static_cast<size_t>(state.range(0));
+	const size_t batch = static_cast<size_t>(state.range(1));
+	auto X = randomBuffer<T>(batch * n);
+	auto W = randomBuffer<T>(n * n);
+	auto b = randomBuffer<T>(n);
+	auto Y = randomBuffer<T>(batch * n);
+
+	for (auto _ : state)
+	{
+		kernels::denseForward<T>(batch, n, n, Activation::TanH, X.data(), n, W.data(), n, b.data(), Y.data(), n);
+		benchmark::DoNotOptimize(Y.data());
+		benchmark::ClobberMemory();
+	}
+	setFlops(state, 2.0 * batch * n * n);
+}
+
+template <typename T>
+static void BM_DenseBackward(benchmark::State& state)
+{
+	const size_t n = static_cast<size_t>(state.range(0));
+	auto X = randomBuffer<T>(n * n);
+	auto W = randomBuffer<T>(n * n);
+	auto Y = randomBuffer<T>(n * n);
+	auto dY = randomBuffer<T>(n * n);
+	auto dW = randomBuffer<T>(n * n);
+	auto db = randomBuffer<T>(n);
+	auto dX = randomBuffer<T>(n * n);
+
+	for (auto _ : state)
+	{
+		kernels::denseBackward<T>(n, n, n, Activation::TanH, X.data(), n, W.data(), n,
+			Y.data(), dY.data(), n, dW.data(), db.data(), dX.data());
+		benchmark::DoNotOptimize(dW.data());
+		benchmark::DoNotOptimize(dX.data());
+		benchmark::ClobberMemory();
+	}
+	setFlops(state, 4.0 * n * n * n);
+}
+
+// Layer width for the sparse/dense crossover benchmarks
+constexpr size_t SparseBenchWidth = 1024;
+
+template <typename T>
+static void BM_SparseForward(benchmark::State& state)
+{
+	const size_t n = SparseBenchWidth;
+	const double density = state.range(0) / 100.0;
+	const size_t N = static_cast<size_t>(state.range(1));
+	auto W = randomBuffer<T>(n * n);
+	for (auto& w : W)
+	{
+		if (std::abs(generateRandomDouble()) >= density) w = T(0);
+	}
+	const kernels::CsrMatrix<T> csr = kernels::toCsr(n, n, W.data(), n);
+	auto X = randomBuffer<T>(N * n);
+	auto b = randomBuffer<T>(n);
+	auto Y = randomBuffer<T>(N * n);
+
+	for (auto _ : state)
+	{
+		kernels::sparseForward<T>(N, Activation::TanH, csr, X.data(), n, b.data(), Y.data(), n);
+		benchmark::DoNotOptimize(Y.data());
+		benchmark::ClobberMemory();
+	}
+	state.counters["density"] = csr.density();
+	setFlops(state, 2.0 * N * csr.nonZeros());
+}
+
+// The dense baseline for BM_SparseForward, with the same width and batch sizes
+template <typename T>
+static void BM_DenseLayerForward(benchmark::State& state)
+{
+	const size_t n = SparseBenchWidth;
+	const size_t N = static_cast<size_t>(state.range(0));
+	auto W = randomBuffer<T>(n * n);
+	auto X = randomBuffer<T>(N * n);
+	auto b = randomBuffer<T>(n);
+	auto Y = randomBuffer<T>(N * n);
+
+	for (auto _ : state)
+	{
+		kernels::denseForward<T>(N, n, n, Activation::TanH, X.data(), n, W.data(), n, b.data(), Y.data(), n);
+		benchmark::DoNotOptimize(Y.data());
+		benchmark::ClobberMemory();
+	}
+	setFlops(state, 2.0 * N * n * n);
+}
+
+// Elementwise transcendental throughput, vectorized kernels against the libm loop.
+// Inputs are spread over [-4, 4] (and (0, 8] for log), the range activations actually see.
+enum class MathOp { Exp, Log, TanH, Sigmoid };
+
+template <typename T, MathOp op, bool vectorized>
+static void BM_Math(benchmark::State& state)
+{
+	const size_t n = static_cast<size_t>(state.range(0));
+	auto x = randomBuffer<T>(n);
+	for (auto& v : x)
+	{
+		v = op == MathOp::Log ? T(4) * (v + T(1)) + T(1e-3) : T(4) * v;
+	}
+	std::vector<T, AlignedAllocator<T, 64>> y(n);
+
+	for (auto _ : state)
+	{
+		// The explicit template argument selects the generic libm loop, the plain call the vectorized overload
+		if constexpr (vectorized)
+		{
+			if constexpr (op == MathOp::Exp) kernels::vexp(n, x.data(), y.data());
+			if constexpr (op == MathOp::Log) kernels::vlog(n, x.data(), y.data());
+			if constexpr (op == MathOp::TanH) kernels::vtanh(n, x.data(), y.data());
+			if constexpr (op == MathOp::Sigmoid) kernels::vsigmoid(n, x.data(), y.data());
+		}
+		else
+		{
+			if constexpr (op == MathOp::Exp) kernels::vexp<T>(n, x.data(), y.data());
+			if constexpr (op == MathOp::Log) kernels::vlog<T>(n, x.data(), y.data());
+			if constexpr (op == MathOp::TanH) kernels::vtanh<T>(n, x.data(), y.data());
+			if constexpr (op == MathOp::Sigmoid) kernels::vsigmoid<T>(n, x.data(), y.data());
+		}
+		benchmark::DoNotOptimize(y.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+
+enum class DropoutMask { PerCallHelper, SharedEngine, Counter };
+
+template <DropoutMask source>
+static void BM_Dropout(benchmark::State& state)
+{
+	const size_t n = static_cast<size_t>(state.range(0));
+	const double p = 0.5, scale = 1.0 / (1.0 - p);
+	auto x = randomBuffer<double>(n);
+	auto dY = randomBuffer<double>(n);
+	std::vector<double, AlignedAllocator<double, 64>> y(n), dX(n), mask(n);
+	std::mt19937 engine(42);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	uint64_t step = 0;
+
+	for (auto _ : state)
+	{
+		if constexpr (source == DropoutMask::Counter)
+		{
+			kernels::dropoutForward<double>(n, Activation::None, p, splitMix64(42), step, 0, x.data(), y.data());
+			kernels::dropoutBackward<double>(n, Activation::None, p, splitMix64(42), step, 0, y.data(), dY.data(), dX.data());
+			++step;
+		}
+		else
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				const double u = source == DropoutMask::PerCallHelper ? generateRandomDouble(0.0, 1.0) : uniform(engine);
+				mask[i] = u >= p ? scale : 0.0;
+				y[i] = x[i] * mask[i];
+			}
+			for (size_t i = 0; i < n; ++i) dX[i] += dY[i] * mask[i];
+		}
+		benchmark::DoNotOptimize(dX.data());
+	}
+	state.SetItemsProcessed(state.iterations() * n);
+}
+
+enum class RandomSource { PerCallHelper, SharedEngine, Counter, CounterParallel };
+
+template <RandomSource source>
+static void BM_RandomFill(benchmark::State& state)
+{
+	const size_t n = static_cast<size_t>(state.range(0));
+	std::vector<double, AlignedAllocator<double, 64>> out(n);
+	std::mt19937 engine(42);
+	std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+	BS::thread_pool pool(source == RandomSource::CounterParallel ? 8 : 1);
+
+	for (auto _ : state)
+	{
+		if constexpr (source == RandomSource::PerCallHelper)
+		{
+			for (auto& x : out) x = generateRandomDouble(-1.0, 1.0);
+		}
+		else if constexpr (source == RandomSource::SharedEngine)
+		{
+			for (auto& x : out) x = uniform(engine);
+		}
+		else if constexpr (source == RandomSource::Counter)
+		{
+			kernels::fillUniform<double>(n, out.data(), -1.0, 1.0, splitMix64(42), 0);
+		}
+		else
+		{
+			kernels::fillUniformParallel<double>(pool, n, out.data(), -1.0, 1.0, splitMix64(42), 0);
+		}
+		benchmark::DoNotOptimize(out.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * n);
+}
+
+// Register the function as a benchmark
+BENCHMARK_TEMPLATE(BM_Gemm, double)->RangeMultiplier(2)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Gemm, float)->RangeMultiplier(2)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_GemmParallel, double)->ArgsProduct({ { 512, 1024, 2048, 4096 }, { 1, 2, 4, 8 } })->ArgNames({ "n", "threads" })->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_GemmParallel, float)->ArgsProduct({ { 512, 1024, 2048, 4096 }, { 1, 2, 4, 8 } })->ArgNames({ "n", "threads" })->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_GemmReference, double)->RangeMultiplier(2)->Range(16, 256)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_GemmReference, float)->RangeMultiplier(2)->Range(16, 256)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Gemv, double)->RangeMultiplier(4)->Range(16, 4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Gemv, float)->RangeMultiplier(4)->Range(16, 4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_DenseForward, double)->RangeMultiplier(2)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_DenseBackward, double)->RangeMultiplier(2)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_DenseForwardBatch, double)->ArgsProduct({ { 256, 1024 }, { 2, 4, 8, 15, 16, 64 } })->ArgNames({ "n", "batch" })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_DenseForward, float)->RangeMultiplier(2)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_DenseBackward, float)->RangeMultiplier(2)->Range(16, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_DenseForwardBatch, float)->ArgsProduct({ { 256, 1024 }, { 2, 4, 8, 15, 16, 64 } })->ArgNames({ "n", "batch" })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_SparseForward, double)->ArgsProduct({ { 1, 2, 5, 10, 20, 30, 50, 100 }, { 1, 32 } })->ArgNames({ "percent", "batch" })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_DenseLayerForward, double)->Arg(1)->Arg(32)->ArgName("batch")->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_SparseForward, float)->ArgsProduct({ { 1, 2, 5, 10, 20, 30, 50, 100 }, { 1, 32 } })->ArgNames({ "percent", "batch" })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_DenseLayerForward, float)->Arg(1)->Arg(32)->ArgName("batch")->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, double, MathOp::Exp, true)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, double, MathOp::Exp, false)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, double, MathOp::Log, true)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, double, MathOp::Log, false)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, double, MathOp::TanH, true)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, double, MathOp::TanH, false)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, double, MathOp::Sigmoid, true)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, double, MathOp::Sigmoid, false)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, float, MathOp::Exp, true)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, float, MathOp::Exp, false)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, float, MathOp::Log, true)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, float, MathOp::Log, false)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, float, MathOp::TanH, true)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, float, MathOp::TanH, false)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, float, MathOp::Sigmoid, true)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Math, float, MathOp::Sigmoid, false)->Arg(4096)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Dropout, DropoutMask::PerCallHelper)->Arg(65536)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Dropout, DropoutMask::SharedEngine)->Arg(65536)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Dropout, DropoutMask::Counter)->Arg(65536)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_RandomFill, RandomSource::PerCallHelper)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_RandomFill, RandomSource::SharedEngine)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_RandomFill, RandomSource::Counter)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_RandomFill, RandomSource::CounterParallel)->Arg(1 << 20)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+class Application : public Jahley::App
+{
+public:
+	Application() :
+		Jahley::App()
+	{
+		int argc = 1;
+
+		std::vector<char*> argv;
+		char test[] = "Kernels";
+		argv.push_back(test);
+
+		benchmark::Initialize(&argc, argv.data());
+		// Record which kernel variant the numbers were measured with
+		benchmark::AddCustomContext("kernels_isa", kernels::isaName(kernels::activeIsa()));
+		benchmark::RunSpecifiedBenchmarks();
+	}
+
+private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+	return new Application();
+}
@@ -137,6 +137,25 @@ static void BM_MLP_MT_2H(benchmark::State& state) {
 	}
 }
 
+// Packs the samples [first, first + count) into a count x width tensor
+TensorPtr batchTensor(const std::vector<std::vector<ValuePtr>>& samples, size_t first, size_t count)
+{
+	const size_t width = samples[first].size();
+	TensorPtr t = Tensor::Create({ count, width });
+	for (size_t n = 0; n < count; ++n)
+	{
+		for (size_t j = 0; j < width; ++j)
+		{
+			t->at(n, j) = samples[first + n][j]->get_val();
+		}
+	}
+	t->set_requires_grad(false);
+	return t;
+}
+
+// range(0) is the number of epochs, range(1) the batch size. A batch size of 1 trains on
+// the scalar ExprNode graph one sample at a time; larger batches run each step as one
+// batched forward (a GEMM per layer), one Tensor::mseLoss and one backward.
 static void BM_MLP(benchmark::State& state) {
 	for (auto _ : state) 
 	{
@@ -150,7 +169,30 @@ static void BM_MLP(benchmark::State& state) {
 		fillTargets(targets);
 
 		int epochs = state.range(0);
-		
+		const size_t batchSize = static_cast<size_t>(state.range(1));
+
+		if (batchSize > 1)
+		{
+			// Batches are built once; the weights change every step, the data does not
+			std::vector<std::pair<TensorPtr, TensorPtr>> batches;
+			for (size_t first = 0; first < inputs.size(); first += batchSize)
+			{
+				const size_t count = std::min(batchSize, inputs.size() - first);
+				batches.push_back({ batchTensor(inputs, first, count), batchTensor(targets, first, count) });
+			}
+
+			for (int epoch = 0; epoch < epochs; ++epoch) {
+				for (auto& [x, target] : batches) {
+					TensorPtr prediction = mlp(x);
+					TensorPtr loss = Tensor::mseLoss(prediction, target);
+					mlp.zero_grad();
+					loss->backward();
+					gradientDescent(mlp.parameters());
+				}
+			}
+			continue;
+		}
+
 		for (int epoch = 0; epoch < epochs; ++epoch) {
 			for (size_t i = 0; i < inputs.size(); ++i) {
 				// Forward propagation
@@ -172,6 +214,295 @@ static void BM_MLP(benchmark::State& state) {
 	}
 }
 
+// The scalar MLP graph evaluated on lane vectors: the graph is built once and each step
+// trains on LaneNode<double>::Width samples in lockstep. When the sample count is not a
+// multiple of the width, the last step's backward() takes the count of real samples.
+static void BM_MLP_Lanes(benchmark::State& state) {
+	for (auto _ : state)
+	{
+		MLP mlp(INPUT_LAYER_NEURONS, { HIDDEN_LAYER_NEURONS, HIDDEN_LAYER_NEURONS, HIDDEN_LAYER_NEURONS, OUTPUT_LAYER_NEURONS }, false);
+
+		std::vector<std::vector<ValuePtr>> inputs;
+		fillInputs(inputs);
+
+		std::vector<std::vector<ValuePtr>> targets;
+		fillTargets(targets);
+
+		constexpr size_t W = LaneNode<double>::Width;
+		std::vector<LanePtr> x(INPUT_LAYER_NEURONS);
+		for (auto& v : x) v = LaneNode<double>::Create();
+		LanePtr target = LaneNode<double>::Create();
+
+		LanePtr diff = *mlp(x)[0] - target;
+		LanePtr loss = *diff * diff;
+
+		int epochs = state.range(0);
+
+		for (int epoch = 0; epoch < epochs; ++epoch) {
+			for (size_t first = 0; first < inputs.size(); first += W) {
+				const size_t active = std::min(W, inputs.size() - first);
+				for (size_t lane = 0; lane < active; ++lane) {
+					for (size_t j = 0; j < INPUT_LAYER_NEURONS; ++j) {
+						x[j]->set_lane(lane, inputs[first + lane][j]->get_val());
+					}
+					target->set_lane(lane, targets[first + lane][0]->get_val());
+				}
+
+				loss->forward();
+				mlp.zero_grad();
+				loss->backward(active);
+				gradientDescent(mlp.parameters());
+			}
+		}
+	}
+}
+
+// Inference throughput of a trained-size network, range(0) inputs and hidden neurons wide,
+// over batches of range(1) samples: the double-precision batched MLP against its int8
+// QuantizedMLP. The quantized run also reports its mean and largest deviation from the
+// double path; the untrained network's weights in [-1, 1] amplify rounding errors layer by
+// layer, so the largest deviation is a pessimistic bound for a trained network.
+template <bool quantized>
+static void BM_MLP_Inference(benchmark::State& state) {
+	const size_t width = static_cast<size_t>(state.range(0));
+	const size_t batch = static_cast<size_t>(state.range(1));
+	MLP mlp(width, { static_cast<int>(width), static_cast<int>(width), OUTPUT_LAYER_NEURONS }, false);
+
+	std::vector<std::vector<double>> calibration(256, std::vector<double>(width));
+	for (auto& sample : calibration)
+	{
+		for (auto& v : sample) v = generateRandomDouble();
+	}
+	QuantizedMLP engine(mlp, calibration);
+
+	std::vector<double> x(batch * width);
+	for (size_t n = 0; n < batch; ++n)
+	{
+		std::copy(calibration[n % calibration.size()].begin(), calibration[n % calibration.size()].end(), x.begin() + n * width);
+	}
+	TensorPtr X = Tensor::FromData({ batch, width }, x);
+	X->set_requires_grad(false);
+	std::vector<double> y(batch * OUTPUT_LAYER_NEURONS);
+
+	for (auto _ : state)
+	{
+		if constexpr (quantized)
+		{
+			engine.forward(x.data(), batch, y.data());
+			benchmark::DoNotOptimize(y.data());
+		}
+		else
+		{
+			TensorPtr prediction = mlp(X);
+			benchmark::DoNotOptimize(prediction->data());
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * batch);
+
+	if constexpr (quantized)
+	{
+		const std::vector<double> expected = mlp(X)->to_vector();
+		double maxError = 0.0, meanError = 0.0;
+		for (size_t i = 0; i < y.size(); ++i)
+		{
+			maxError = std::max(maxError, std::abs(y[i] - expected[i]));
+			meanError += std::abs(y[i] - expected[i]) / y.size();
+		}
+		state.counters["mean_abs_err"] = meanError;
+		state.counters["max_abs_err"] = maxError;
+	}
+}
+
+// Latency of a network range(0) wide exported with PackedMLP<T>, over batches of range(1)
+// samples. At batch 1 every weight is read once per sample, so the time tracks the bytes
+// per inference and the 16-bit formats should run close to twice as fast as float.
+template <typename T>
+static void BM_MLP_Precision(benchmark::State& state) {
+	const size_t width = static_cast<size_t>(state.range(0));
+	const size_t batch = static_cast<size_t>(state.range(1));
+	MLP mlp(width, { static_cast<int>(width), static_cast<int>(width), OUTPUT_LAYER_NEURONS }, false);
+	PackedMLP<T> packed(mlp);
+
+	std::vector<double> x(batch * width);
+	for (auto& v : x) v = generateRandomDouble();
+	std::vector<double> y(batch * OUTPUT_LAYER_NEURONS);
+
+	for (auto _ : state)
+	{
+		packed.forward(x.data(), batch, y.data());
+		benchmark::DoNotOptimize(y.data());
+	}
+	state.SetItemsProcessed(state.iterations() * batch);
+	state.counters["bytes_per_inference"] = static_cast<double>(packed.weightBytes()) / batch;
+	state.counters["weight_bandwidth"] = benchmark::Counter(static_cast<double>(packed.weightBytes()), benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::kIs1024);
+}
+
+// Latency of the batched forward pass before and after structured pruning, for a network
+// range(0) wide in which half of each hidden layer's neurons are dead (constant input and a
+// saturated output), as is common after training. The pruned run reports the neurons left
+// and its largest deviation from the original network.
+template <bool pruned>
+static void BM_MLP_NeuronPruning(benchmark::State& state) {
+	const size_t width = static_cast<size_t>(state.range(0));
+	const size_t batch = static_cast<size_t>(state.range(1));
+	MLP mlp(width, { static_cast<int>(width), static_cast<int>(width), OUTPUT_LAYER_NEURONS }, false);
+	for (size_t l = 0; l < 2; ++l)
+	{
+		auto& neurons = mlp.getLayers()[l].getNeurons();
+		for (size_t j = 0; j < neurons.size(); j += 2)
+		{
+			for (const auto& w : neurons[j].getWeights()) w->set_val(0.0);
+			neurons[j].getBias()->set_val(3.0);
+		}
+	}
+
+	std::vector<std::vector<double>> samples(256, std::vector<double>(width));
+	for (auto& sample : samples)
+	{
+		for (auto& v : sample) v = generateRandomDouble();
+	}
+	std::unique_ptr<MLP> smaller = pruneNeurons(mlp, samples, 1e-9, false);
+	MLP& network = pruned ? *smaller : mlp;
+
+	std::vector<double> x(batch * width);
+	for (auto& v : x) v = generateRandomDouble();
+	TensorPtr X = Tensor::FromData({ batch, width }, x);
+	X->set_requires_grad(false);
+
+	for (auto _ : state)
+	{
+		TensorPtr prediction = network(X);
+		benchmark::DoNotOptimize(prediction->data());
+	}
+	state.SetItemsProcessed(state.iterations() * batch);
+
+	size_t hidden = 0;
+	for (size_t l = 0; l + 1 < network.getLayers().size(); ++l) hidden += network.getLayers()[l].size();
+	state.counters["hidden_neurons"] = static_cast<double>(hidden);
+	if constexpr (pruned)
+	{
+		const std::vector<double> expected = mlp(X)->to_vector();
+		const std::vector<double> y = network(X)->to_vector();
+		double maxError = 0.0;
+		for (size_t i = 0; i < y.size(); ++i) maxError = std::max(maxError, std::abs(y[i] - expected[i]));
+		state.counters["max_abs_err"] = maxError;
+	}
+}
+
+// One training step (forward, backward, update) of a first layer with 64 neurons over
+// range(0) mostly-zero inputs, batches of 32 samples with 8 active inputs each: the
+// DenseLayer on the expanded inputs against the SparseInputLayer on (index, value) pairs.
+template <bool sparse>
+static void BM_SparseInputLayer(benchmark::State& state) {
+	const size_t inputs = static_cast<size_t>(state.range(0));
+	constexpr size_t neurons = 64, batch = 32, active = 8;
+
+	std::vector<SparseSample> samples(batch);
+	std::vector<double> x(batch * inputs, 0.0);
+	for (size_t n = 0; n < batch; ++n)
+	{
+		for (size_t k = 0; k < active; ++k)
+		{
+			const uint32_t j = static_cast<uint32_t>((std::abs(generateRandomDouble()) * (inputs - 1)));
+			samples[n].push_back({ j, 1.0 });
+			x[n * inputs + j] = 1.0;
+		}
+	}
+	std::vector<double> y(batch * neurons), dy(batch * neurons, 1.0);
+
+	DenseLayer dense(static_cast<int>(sparse ? 1 : inputs), static_cast<int>(neurons));
+	SparseInputLayer layer(static_cast<int>(sparse ? inputs : 1), static_cast<int>(neurons));
+
+	for (auto _ : state)
+	{
+		if constexpr (sparse)
+		{
+			layer.zero_grad();
+			layer.forward(samples, y.data());
+			layer.backward(samples, y.data(), dy.data());
+			layer.sgd_step(0.001);
+		}
+		else
+		{
+			dense.zero_grad();
+			dense.forward(x.data(), batch, y.data());
+			dense.backward(x.data(), batch, y.data(), dy.data(), nullptr);
+			dense.sgd_step(0.001);
+		}
+		benchmark::DoNotOptimize(y.data());
+	}
+	state.SetItemsProcessed(state.iterations() * batch);
+}
+
+// One training step of an Embedding with range(0) rows of 16 values and weight decay: a
+// lookup of 256 IDs, backward of their gradient rows and the SGD update. The lazy update
+// touches only the looked-up rows, so the time should not grow with the table size.
+static void BM_Embedding(benchmark::State& state) {
+	const size_t rows = static_cast<size_t>(state.range(0));
+	constexpr size_t dim = 16, batch = 256;
+	Embedding embedding(rows, dim, 1e-4);
+
+	std::vector<uint32_t> ids(batch);
+	for (auto& id : ids) id = static_cast<uint32_t>(std::abs(generateRandomDouble()) * (rows - 1));
+	std::vector<double> g(dim, 1.0);
+
+	for (auto _ : state)
+	{
+		embedding.zero_grad();
+		for (auto& id : ids) id = static_cast<uint32_t>((id * 2654435761u + 1) % rows);
+		for (Embedding::RowView r : embedding.lookup(ids))
+		{
+			benchmark::DoNotOptimize(r.data());
+		}
+		for (uint32_t id : ids) embedding.accumulate(id, g.data());
+		embedding.sgd_step(0.01);
+	}
+	state.SetItemsProcessed(state.iterations() * batch);
+}
+
+// Construction of an MLP with one hidden layer of range(0) x range(0) weights and of a
+// DenseLayer of the same size, with generateRandomDouble() per weight or with the seeded
+// Xavier initialization on a thread pool. The MLP still creates one ExprNode per weight, so
+// its seeded path also builds the nodes in parallel; the DenseLayer fills one matrix.
+template <bool seeded>
+static void BM_MLP_Construction(benchmark::State& state) {
+	const int width = static_cast<int>(state.range(0));
+	for (auto _ : state)
+	{
+		if constexpr (seeded)
+		{
+			MLP mlp(width, { width, 1 }, WeightInit::XavierUniform, 42);
+			benchmark::DoNotOptimize(mlp.getLayers().data());
+		}
+		else
+		{
+			MLP mlp(width, { width, 1 });
+			benchmark::DoNotOptimize(mlp.getLayers().data());
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * width * width);
+}
+
+template <bool seeded>
+static void BM_DenseLayer_Construction(benchmark::State& state) {
+	const int width = static_cast<int>(state.range(0));
+	BS::thread_pool pool;
+	for (auto _ : state)
+	{
+		if constexpr (seeded)
+		{
+			DenseLayer layer(width, width, Activation::TanH, WeightInit::XavierUniform, 42, 0, pool);
+			benchmark::DoNotOptimize(layer.neuron(0).data());
+		}
+		else
+		{
+			DenseLayer layer(width, width);
+			benchmark::DoNotOptimize(layer.neuron(0).data());
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * width * width);
+}
+
 static void BM_MLP_2H(benchmark::State& state) {
 	for (auto _ : state)
 	{
@@ -209,7 +540,23 @@ static void BM_MLP_2H(benchmark::State& state) {
 
 // Register the function as a benchmark
 BENCHMARK(BM_MLP_MT)->Arg(1000)->Arg(2000)->Arg(3000)->Arg(4000)->Arg(5000)->Unit(benchmark::kSecond);
-BENCHMARK(BM_MLP)->Arg(1000)->Arg(2000)->Arg(3000)->Arg(4000)->Arg(5000)->Unit(benchmark::kSecond);
+BENCHMARK(BM_MLP)->ArgsProduct({ { 1000, 2000, 3000, 4000, 5000 }, { 1, 5, 10 } })->ArgNames({ "epochs", "batch" })->Unit(benchmark::kSecond);
+BENCHMARK(BM_MLP_Lanes)->Arg(1000)->Arg(2000)->Arg(3000)->Arg(4000)->Arg(5000)->Unit(benchmark::kSecond);
+BENCHMARK_TEMPLATE(BM_MLP_Inference, false)->ArgsProduct({ { 64, 256, 1024 }, { 1, 256 } })->ArgNames({ "width", "batch" })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_MLP_Inference, true)->ArgsProduct({ { 64, 256, 1024 }, { 1, 256 } })->ArgNames({ "width", "batch" })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_MLP_Precision, double)->ArgsProduct({ { 256, 512, 1024 }, { 1, 8 } })->ArgNames({ "width", "batch" })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_MLP_Precision, float)->ArgsProduct({ { 256, 512, 1024 }, { 1, 8 } })->ArgNames({ "width", "batch" })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_MLP_Precision, kernels::bf16)->ArgsProduct({ { 256, 512, 1024 }, { 1, 8 } })->ArgNames({ "width", "batch" })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_MLP_Precision, kernels::fp16)->ArgsProduct({ { 256, 512, 1024 }, { 1, 8 } })->ArgNames({ "width", "batch" })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_MLP_NeuronPruning, false)->ArgsProduct({ { 256, 1024 }, { 1, 256 } })->ArgNames({ "width", "batch" })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_MLP_NeuronPruning, true)->ArgsProduct({ { 256, 1024 }, { 1, 256 } })->ArgNames({ "width", "batch" })->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_SparseInputLayer, false)->RangeMultiplier(10)->Range(1000, 100000)->ArgName("inputs")->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_SparseInputLayer, true)->RangeMultiplier(10)->Range(1000, 100000)->ArgName("inputs")->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Embedding)->RangeMultiplier(10)->Range(1000, 1000000)->ArgName("rows")->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_MLP_Construction, false)->Arg(256)->Arg(1024)->Arg(2048)->ArgName("width")->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MLP_Construction, true)->Arg(256)->Arg(1024)->Arg(2048)->ArgName("width")->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_DenseLayer_Construction, false)->Arg(1024)->Arg(4096)->ArgName("width")->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_DenseLayer_Construction, true)->Arg(1024)->Arg(4096)->ArgName("width")->UseRealTime()->Unit(benchmark::kMillisecond);
 BENCHMARK(BM_MLP_MT_2H)->Arg(1000)->Arg(2000)->Arg(3000)->Arg(4000)->Arg(5000)->Unit(benchmark::kSecond);
 BENCHMARK(BM_MLP_2H)->Arg(1000)->Arg(2000)->Arg(3000)->Arg(4000)->Arg(5000)->Unit(benchmark::kSecond);
 
@@ -230,6 +577,8 @@ public:
 		argv.push_back(test);
 
 		benchmark::Initialize(&argc, argv.data());
+		// Record which kernel variant the numbers were measured with
+		benchmark::AddCustomContext("kernels_isa", kernels::isaName(kernels::activeIsa()));
 		benchmark::TimeUnit::kMillisecond; //  how to set this???
 		benchmark::RunSpecifiedBenchmarks();
 	}
@@ -0,0 +1,358 @@
+#include "Jahley.h"
+#include <benchmark/benchmark.h>
+
+const std::string APP_NAME = "Tensor";
+
+// Compares one dense layer (width x width, tanh) built from scalar ExprNodes,
+// the same layer backed by one matrix (DenseLayer) and as a single fused Tensor node.
+// Each iteration runs forward, a sum-of-squares loss and backward for one sample.
+// BM_LeNet reports images/s for a LeNet-5 sized convolutional network on 28 x 28 images.
+// BM_Recurrent trains an LSTM or GRU over a 256 step sequence with truncated BPTT and
+// reports timesteps/s, one item per sample per step.
+// BM_Attention runs forward and backward of one 64-wide attention head as the sequence
+// grows, tiled with the online softmax against a naive version that materializes the
+// L x L probabilities, and reports tokens/s and the scratch memory each one needs.
+// BM_Normalization runs forward and backward of LayerNorm or BatchNorm on a 64 x width
+// batch; bytes/s counts one read of x and dY and one write of y and dx per element.
+// BM_MemoryPlanner runs a training step of an MLP, LeNet and a transformer block with the
+// plain backward or with MemoryPlanner, and reports the intermediate buffer bytes of the
+// graph without planning (naive) and with it (planned), and the bytes the plan saves.
+
+static void BM_ScalarLayer(benchmark::State& state)
+{
+	const int width = static_cast<int>(state.range(0));
+	Layer layer(width, width, 0);
+
+	std::vector<ValuePtr> input(width);
+	for (auto& v : input)
+	{
+		v = ExprNode::Create(generateRandomDouble());
+	}
+
+	for (auto _ : state)
+	{
+		std::vector<ValuePtr> out = layer(input);
+
+		ValuePtr loss = ExprNode::Create(0.0);
+		for (auto& o : out)
+		{
+			loss = *loss + *o * o;
+		}
+
+		layer.zero_grad();
+		loss->backward();
+		benchmark::DoNotOptimize(loss->get_val());
+	}
+
+	state.counters["weights"] = static_cast<double>(width) * width;
+}
+
+static void BM_DenseLayer(benchmark::State& state)
+{
+	const int width = static_cast<int>(state.range(0));
+	DenseLayer layer(width, width);
+
+	std::vector<ValuePtr> input(width);
+	for (auto& v : input)
+	{
+		v = ExprNode::Create(generateRandomDouble());
+	}
+
+	for (auto _ : state)
+	{
+		std::vector<ValuePtr> out = layer(input);
+
+		ValuePtr loss = ExprNode::Create(0.0);
+		for (auto& o : out)
+		{
+			loss = *loss + *o * o;
+		}
+
+		layer.zero_grad();
+		loss->backward();
+		benchmark::DoNotOptimize(loss->get_val());
+	}
+
+	state.counters["weights"] = static_cast<double>(width) * width;
+}
+
+static void BM_TensorLayer(benchmark::State& state)
+{
+	const int width = static_cast<int>(state.range(0));
+	TensorLayer layer(width, width);
+
+	TensorPtr input = Tensor::Random({ 1, static_cast<size_t>(width) });
+	input->set_requires_grad(false);
+
+	for (auto _ : state)
+	{
+		TensorPtr out = layer(input);
+		TensorPtr loss = Tensor::sum(Tensor::mul(out, out));
+
+		layer.zero_grad();
+		loss->backward();
+		benchmark::DoNotOptimize(loss->item());
+	}
+
+	state.counters["weights"] = static_cast<double>(width) * width;
+}
+
+// LeNet-5 sized network with strided convolutions in place of the pooling layers:
+// 1x28x28 -> conv 5x5 stride 2 -> 6x14x14 -> conv 6x6 stride 2 -> 16x5x5 -> 120 -> 84 -> 10.
+// Inference runs the forward pass on a batch of range(0) images; training adds a softmax
+// cross-entropy loss, backward and an SGD step.
+template <bool training>
+static void BM_LeNet(benchmark::State& state)
+{
+	const size_t batch = static_cast<size_t>(state.range(0));
+	Conv2D conv1(1, 6, 5, 2, 2);
+	Conv2D conv2(6, 16, 6, 2, 0);
+	TensorLayer fc1(400, 120);
+	TensorLayer fc2(120, 84);
+	TensorLayer fc3(84, 10, Activation::None);
+	std::vector<Module*> modules = { &conv1, &conv2, &fc1, &fc2, &fc3 };
+
+	TensorPtr images = Tensor::Random({ batch, 1, 28, 28 });
+	images->set_requires_grad(false);
+	std::vector<int> labels(batch);
+	for (size_t n = 0; n < batch; ++n) labels[n] = static_cast<int>(n % 10);
+
+	for (auto _ : state)
+	{
+		TensorPtr h = conv2(conv1(images));
+		TensorPtr logits = fc3(fc2(fc1(h->reshape({ batch, 400 }))));
+		if constexpr (training)
+		{
+			for (Module* m : modules) m->zero_grad();
+			Tensor::softmaxCrossEntropy(logits, labels)->backward();
+			for (Module* m : modules) m->sgd_step(0.01);
+		}
+		benchmark::DoNotOptimize(logits->data());
+	}
+	state.SetItemsProcessed(state.iterations() * batch);
+}
+
+template <typename Recurrent>
+static void BM_Recurrent(benchmark::State& state)
+{
+	const size_t window = static_cast<size_t>(state.range(0));
+	const size_t batch = 16, inputs = 32, hidden = 64, steps = 256;
+	Recurrent layer(inputs, hidden, window);
+
+	std::vector<TensorPtr> windows;
+	for (size_t t = 0; t < steps; t += window)
+	{
+		TensorPtr x = Tensor::Random({ window, batch, inputs });
+		x->set_requires_grad(false);
+		windows.push_back(x);
+	}
+
+	for (auto _ : state)
+	{
+		layer.resetState();
+		for (const TensorPtr& x : windows)
+		{
+			TensorPtr y = layer(x);
+			layer.zero_grad();
+			Tensor::sum(Tensor::mul(y, y))->backward();
+			layer.sgd_step(0.001);
+			benchmark::DoNotOptimize(y->data());
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * steps * batch);
+}
+
+// Unfused attention for one head: S = scale * Q K^T is materialized, softmaxed in place and
+// kept for backward, which needs a second L x L buffer for dS.
+static void naiveAttention(size_t L, size_t d, const double* Q, const double* K, const double* V,
+	const double* dO, double* O, double* dQ, double* dK, double* dV, double* P, double* dS)
+{
+	const double scale = 1.0 / std::sqrt(static_cast<double>(d));
+	const ptrdiff_t ld = static_cast<ptrdiff_t>(d), lL = static_cast<ptrdiff_t>(L);
+	kernels::gemm<double>(L, L, d, scale, Q, ld, 1, K, 1, ld, 0.0, P, lL, 1);
+	for (size_t i = 0; i < L; ++i)
+	{
+		double* p = P + i * L;
+		const double m = *std::max_element(p, p + L);
+		double sum = 0.0;
+		for (size_t j = 0; j < L; ++j) sum += p[j] = std::exp(p[j] - m);
+		for (size_t j = 0; j < L; ++j) p[j] /= sum;
+	}
+	kernels::gemm<double>(L, d, L, 1.0, P, lL, 1, V, ld, 1, 0.0, O, ld, 1);
+
+	kernels::gemm<double>(L, d, L, 1.0, P, 1, lL, dO, ld, 1, 0.0, dV, ld, 1);
+	kernels::gemm<double>(L, L, d, 1.0, dO, ld, 1, V, 1, ld, 0.0, dS, lL, 1);
+	for (size_t i = 0; i < L; ++i)
+	{
+		const double D = kernels::dot(d, dO + i * d, O + i * d);
+		for (size_t j = 0; j < L; ++j) dS[i * L + j] = P[i * L + j] * (dS[i * L + j] - D) * scale;
+	}
+	kernels::gemm<double>(L, d, L, 1.0, dS, lL, 1, K, ld, 1, 0.0, dQ, ld, 1);
+	kernels::gemm<double>(L, d, L, 1.0, dS, 1, lL, Q, ld, 1, 0.0, dK, ld, 1);
+}
+
+template <bool tiled>
+static void BM_Attention(benchmark::State& state)
+{
+	const size_t L = static_cast<size_t>(state.range(0)), d = 64;
+	const double scale = 1.0 / std::sqrt(static_cast<double>(d));
+	AlignedVector<double> Q(L * d), K(L * d), V(L * d), dO(L * d), O(L * d), dQ(L * d), dK(L * d), dV(L * d), lse(L);
+	for (auto* v : { &Q, &K, &V, &dO })
+	{
+		for (double& x : *v) x = generateRandomDouble();
+	}
+
+	AlignedVector<double> P, dS;
+	if constexpr (!tiled)
+	{
+		P.resize(L * L);
+		dS.resize(L * L);
+	}
+
+	for (auto _ : state)
+	{
+		if constexpr (tiled)
+		{
+			std::fill(dQ.begin(), dQ.end(), 0.0);
+			std::fill(dK.begin(), dK.end(), 0.0);
+			std::fill(dV.begin(), dV.end(), 0.0);
+			kernels::attentionForward<double>(L, d, false, scale, Q.data(), K.data(), V.data(), d, O.data(), d, lse.data());
+			kernels::attentionBackward<double>(L, d, false, scale, Q.data(), K.data(), V.data(), d, O.data(), dO.data(), d,
+				lse.data(), dQ.data(), dK.data(), dV.data());
+		}
+		else
+		{
+			naiveAttention(L, d, Q.data(), K.data(), V.data(), dO.data(), O.data(), dQ.data(), dK.data(), dV.data(), P.data(), dS.data());
+		}
+		benchmark::DoNotOptimize(dQ.data());
+	}
+
+	// Working memory beyond the inputs, outputs and gradients
+	const size_t tile = kernels::AttentionTile;
+	const double scratch = tiled ? (3.0 * tile * tile + 2.0 * tile + 2.0 * L) : 2.0 * L * L;
+	state.counters["scratch_KB"] = scratch * sizeof(double) / 1024.0;
+	state.SetItemsProcessed(state.iterations() * L);
+}
+
+template <typename Norm>
+static void BM_Normalization(benchmark::State& state)
+{
+	const size_t width = static_cast<size_t>(state.range(0)), batch = 64;
+	Norm norm(width);
+	TensorPtr x = Tensor::Random({ batch, width });
+
+	for (auto _ : state)
+	{
+		norm.zero_grad();
+		x->zero_grad();
+		TensorPtr y = norm(x);
+		Tensor::sum(y)->backward();
+		benchmark::DoNotOptimize(x->grad());
+	}
+	state.SetItemsProcessed(state.iterations() * batch);
+	state.SetBytesProcessed(state.iterations() * batch * width * 4 * sizeof(double));
+}
+
+enum class PlannedModel { MLP, LeNet, Transformer };
+
+template <PlannedModel model, bool planned>
+static void BM_MemoryPlanner(benchmark::State& state)
+{
+	const size_t batch = 32, L = 64, D = 64;
+	TensorLayer fc1(784, 512), fc2(512, 512), fc3(512, 10, Activation::None);
+	Conv2D conv1(1, 6, 5, 2, 2);
+	Conv2D conv2(6, 16, 6, 2, 0);
+	TensorLayer lenet1(400, 120), lenet2(120, 84), lenet3(84, 10, Activation::None);
+	LayerNorm norm1(D), norm2(D);
+	MultiHeadAttention attention(D, 4, true);
+	TensorLayer up(D, 4 * D, Activation::ReLU), down(4 * D, D, Activation::None);
+	std::vector<Module*> modules = { &fc1, &fc2, &fc3, &conv1, &conv2, &lenet1, &lenet2, &lenet3, &norm1, &norm2, &attention, &up, &down };
+
+	TensorPtr images = Tensor::Random({ batch, 1, 28, 28 });
+	TensorPtr tokens = Tensor::Random({ batch, L, D });
+	images->set_requires_grad(false);
+	tokens->set_requires_grad(false);
+	std::vector<int> labels(batch);
+	for (size_t n = 0; n < batch; ++n) labels[n] = static_cast<int>(n % 10);
+
+	auto loss = [&]()
+	{
+		if constexpr (model == PlannedModel::MLP)
+		{
+			return Tensor::softmaxCrossEntropy(fc3(fc2(fc1(images->reshape({ batch, 784 })))), labels);
+		}
+		else if constexpr (model == PlannedModel::LeNet)
+		{
+			TensorPtr h = conv2(conv1(images));
+			return Tensor::softmaxCrossEntropy(lenet3(lenet2(lenet1(h->reshape({ batch, 400 })))), labels);
+		}
+		else
+		{
+			// Pre-norm block: x + attention(norm(x)), then + mlp(norm(.))
+			TensorPtr h = Tensor::add(tokens, attention(norm1(tokens)));
+			TensorPtr flat = h->reshape({ batch * L, D });
+			TensorPtr y = Tensor::add(flat, down(up(norm2(flat))));
+			return Tensor::mean(Tensor::mul(y, y));
+		}
+	};
+
+	MemoryPlanner planner;
+	for (auto _ : state)
+	{
+		for (Module* m : modules) m->zero_grad();
+		TensorPtr l = loss();
+		if constexpr (planned) planner.backward(l);
+		else l->backward();
+		benchmark::DoNotOptimize(l->data());
+	}
+
+	const MemoryReport& report = planned ? planner.report() : planner.plan(loss());
+	state.counters["naive_MB"] = report.naiveBytes() / 1e6;
+	state.counters["planned_MB"] = report.plannedBytes() / 1e6;
+	state.counters["saved_MB"] = report.savedBytes() / 1e6;
+}
+
+// Register the function as a benchmark
+BENCHMARK(BM_ScalarLayer)->RangeMultiplier(2)->Range(8, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_DenseLayer)->RangeMultiplier(2)->Range(8, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_TensorLayer)->RangeMultiplier(2)->Range(8, 1024)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_LeNet, false)->Arg(1)->Arg(32)->Arg(128)->ArgName("batch")->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_LeNet, true)->Arg(1)->Arg(32)->Arg(128)->ArgName("batch")->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Recurrent, LSTM)->Arg(8)->Arg(32)->Arg(128)->ArgName("window")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Recurrent, GRU)->Arg(8)->Arg(32)->Arg(128)->ArgName("window")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Attention, false)->RangeMultiplier(4)->Range(256, 4096)->ArgName("L")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Attention, true)->RangeMultiplier(4)->Range(256, 4096)->ArgName("L")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Normalization, LayerNorm)->RangeMultiplier(4)->Range(64, 4096)->ArgName("width")->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Normalization, BatchNorm)->RangeMultiplier(4)->Range(64, 4096)->ArgName("width")->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_MemoryPlanner, PlannedModel::MLP, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MemoryPlanner, PlannedModel::MLP, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MemoryPlanner, PlannedModel::LeNet, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MemoryPlanner, PlannedModel::LeNet, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MemoryPlanner, PlannedModel::Transformer, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_MemoryPlanner, PlannedModel::Transformer, true)->Unit(benchmark::kMillisecond);
+
+class Application : public Jahley::App
+{
+public:
+	Application() :
+		Jahley::App()
+	{
+		int argc = 1;
+
+		std::vector<char*> argv;
+		char test[] = "Tensor";
+		argv.push_back(test);
+
+		benchmark::Initialize(&argc, argv.data());
+		// Record which kernel variant the numbers were measured with
+		benchmark::AddCustomContext("kernels_isa", kernels::isaName(kernels::activeIsa()));
+		benchmark::RunSpecifiedBenchmarks();
+	}
+
+private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+	return new Application();
+}
@@ -18,10 +18,11 @@ end
 		"Debug", 
         "Release",
     }
-	vectorextensions "AVX2"
 	filter "configurations:Debug"    defines { "DEBUG" }  symbols  "On"
     filter "configurations:Release"  defines { "NDEBUG" } optimize "On"
     
 	outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 	
-    include "benchmarks/Micrograd"
\ No newline at end of file
+    include "benchmarks/Micrograd"
+    include "benchmarks/Tensor"
+    include "benchmarks/Kernels"
\ No newline at end of file
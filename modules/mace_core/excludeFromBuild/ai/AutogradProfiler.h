@@ -0,0 +1,193 @@
+#pragma once
+
+// Opt-in per-opcode profiler for the ExprNode autograd engine.
+// When enabled, every ExprNode operation records a call count and the cumulative
+// time spent in it, split into the forward pass (building the node) and the
+// backward pass (running its _backward closure). When disabled the only cost
+// is a relaxed atomic load per operation.
+//
+// Usage:
+//   AutogradProfiler::enable();
+//   ... forward + loss->backward() ...
+//   json report = AutogradProfiler::report();
+
+// The operations tracked by the profiler. Composite operations such as
+// subtraction or division by a double are recorded as the primitive ops they are built from.
+enum class ProfileOp : uint8_t
+{
+	Add,
+	Mul,
+	TanH,
+	Pow,
+	Div,
+	Softmax,
+	Other,
+	Count
+};
+
+enum class ProfilePass : uint8_t
+{
+	Forward,
+	Backward,
+	Count
+};
+
+// Call count and cumulative time of one op in one pass
+struct ProfileCounter
+{
+	std::atomic<uint64_t> count{ 0 };
+	std::atomic<uint64_t> nanos{ 0 };
+};
+
+class AutogradProfiler
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static void enable(bool state = true) { enabled.store(state, std::memory_order_relaxed); }
+	static void disable() { enable(false); }
+	static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+	// Clears all recorded counts and times
+	static void reset()
+	{
+		for (auto& pass : counters)
+		{
+			for (auto& c : pass)
+			{
+				c.count.store(0, std::memory_order_relaxed);
+				c.nanos.store(0, std::memory_order_relaxed);
+			}
+		}
+		topoNanos.store(0, std::memory_order_relaxed);
+		backwardCalls.store(0, std::memory_order_relaxed);
+	}
+
+	// Counters are atomic because the multithreaded MLP builds nodes from several pool threads at once
+	static void record(ProfileOp op, ProfilePass pass, uint64_t nanos)
+	{
+		Counter& c = counters[static_cast<size_t>(pass)][static_cast<size_t>(op)];
+		c.count.fetch_add(1, std::memory_order_relaxed);
+		c.nanos.fetch_add(nanos, std::memory_order_relaxed);
+	}
+
+	// Time spent building the topological order in backward(), reported separately from the closures
+	static void recordTopoSort(uint64_t nanos)
+	{
+		topoNanos.fetch_add(nanos, std::memory_order_relaxed);
+		backwardCalls.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	static uint64_t count(ProfileOp op, ProfilePass pass)
+	{
+		return counters[static_cast<size_t>(pass)][static_cast<size_t>(op)].count.load(std::memory_order_relaxed);
+	}
+
+	static uint64_t nanoseconds(ProfileOp op, ProfilePass pass)
+	{
+		return counters[static_cast<size_t>(pass)][static_cast<size_t>(op)].nanos.load(std::memory_order_relaxed);
+	}
+
+	// Maps the ExprNode _op string to a ProfileOp
+	static ProfileOp opFromString(const std::string& op)
+	{
+		if (op == "+") return ProfileOp::Add;
+		if (op == "*") return ProfileOp::Mul;
+		if (op == "TanH") return ProfileOp::TanH;
+		if (op == "^") return ProfileOp::Pow;
+		if (op == "/") return ProfileOp::Div;
+		if (op == "Softmax") return ProfileOp::Softmax;
+		return ProfileOp::Other;
+	}
+
+	static const char* opName(ProfileOp op)
+	{
+		static const char* names[] = { "+", "*", "TanH", "^", "/", "Softmax", "Other" };
+		return names[static_cast<size_t>(op)];
+	}
+
+	// Builds a JSON report with one entry per op and pass. Ops that were never
+	// executed are omitted so reports from different runs diff cleanly.
+	static json report()
+	{
+		json out;
+		const char* passNames[] = { "forward", "backward" };
+
+		for (size_t p = 0; p < static_cast<size_t>(ProfilePass::Count); ++p)
+		{
+			json pass = json::object();
+			uint64_t passCount = 0;
+			uint64_t passNanos = 0;
+
+			for (size_t o = 0; o < static_cast<size_t>(ProfileOp::Count); ++o)
+			{
+				uint64_t n = counters[p][o].count.load(std::memory_order_relaxed);
+				if (n == 0) continue;
+
+				uint64_t ns = counters[p][o].nanos.load(std::memory_order_relaxed);
+				pass[opName(static_cast<ProfileOp>(o))] = {
+					{ "count", n },
+					{ "total_ns", ns },
+					{ "mean_ns", static_cast<double>(ns) / static_cast<double>(n) }
+				};
+				passCount += n;
+				passNanos += ns;
+			}
+
+			out[passNames[p]] = { { "ops", pass }, { "count", passCount }, { "total_ns", passNanos } };
+		}
+
+		out["backward"]["topo_sort_ns"] = topoNanos.load(std::memory_order_relaxed);
+		out["backward"]["calls"] = backwardCalls.load(std::memory_order_relaxed);
+
+		return out;
+	}
+
+	static bool writeReport(const std::filesystem::path& path)
+	{
+		std::ofstream ofs(path);
+		if (ofs.fail()) return false;
+
+		ofs << report().dump(4);
+		return true;
+	}
+
+	// RAII timer that records into the profiler on destruction.
+	// Only reads the clock when profiling is enabled.
+	class Scope
+	{
+	public:
+		Scope(ProfileOp op, ProfilePass pass) :
+			op(op), pass(pass), active(AutogradProfiler::isEnabled())
+		{
+			if (active) start = Clock::now();
+		}
+
+		~Scope()
+		{
+			if (active)
+			{
+				auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+				AutogradProfiler::record(op, pass, static_cast<uint64_t>(ns));
+			}
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator= (const Scope&) = delete;
+
+	private:
+		ProfileOp op;
+		ProfilePass pass;
+		bool active;
+		Clock::time_point start;
+	};
+
+private:
+	using Counter = ProfileCounter;
+	using PassCounters = std::array<Counter, static_cast<size_t>(ProfileOp::Count)>;
+
+	inline static std::atomic<bool> enabled{ false };
+	inline static std::array<PassCounters, static_cast<size_t>(ProfilePass::Count)> counters;
+	inline static std::atomic<uint64_t> topoNanos{ 0 };
+	inline static std::atomic<uint64_t> backwardCalls{ 0 };
+};
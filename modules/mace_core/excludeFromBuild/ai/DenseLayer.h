@@ -0,0 +1,226 @@
+#pragma once
+
+// The DenseLayer class is a Layer variant that stores its weights as one matrix instead of
+// a vector of Neurons each holding its own heap-allocated weight nodes.
+//
+// W is row-major with one row per neuron. Every row starts on a 64-byte boundary
+// (the row stride is padded to a multiple of 8 doubles), and the biases live in a
+// separate contiguous vector. Gradients use the same layout.
+//
+// A DenseLayer plugs into the scalar ExprNode graph: it takes and returns
+// std::vector<ValuePtr>, but internally the whole layer is one hub node whose
+// backward walks W, dW and the inputs linearly instead of running one closure
+// per multiply.
+class DenseLayer : public Module
+{
+public:
+	// Read/write view of one neuron's row of the matrix. Holds no storage of its own.
+	class NeuronView
+	{
+	public:
+		NeuronView(double* w, double* b, double* gw, double* gb, size_t n) :
+			w(w), b(b), gw(gw), gb(gb), n(n) {}
+
+		size_t size() const { return n; }
+		double& weight(size_t i) { return w[i]; }
+		double& bias() { return *b; }
+		double weight_grad(size_t i) const { return gw[i]; }
+		double bias_grad() const { return *gb; }
+		double* data() { return w; }
+
+	private:
+		double* w;
+		double* b;
+		double* gw;
+		double* gb;
+		size_t n;
+	};
+
+	// The weights are initialized like Neuron's, with generateRandomDouble() in [-1, 1],
+	// neuron by neuron, and the biases are initialized to 0.
+	DenseLayer(int neuronsIn, int neuronsOut, Activation act = Activation::TanH) :
+		in(neuronsIn), out(neuronsOut), act(act)
+	{
+		allocate();
+		for (size_t i = 0; i < out; ++i)
+		{
+			for (size_t j = 0; j < in; ++j)
+			{
+				storage->W[i * ld + j] = generateRandomDouble();
+			}
+		}
+	}
+
+	// Initializes the weights for the scheme on the pool, with the same values as layer
+	// 'index' of MLP(..., scheme, seed): the padded rows do not change the stream.
+	DenseLayer(int neuronsIn, int neuronsOut, Activation act, WeightInit scheme, uint64_t seed, uint32_t index,
+		BS::thread_pool& pool) :
+		in(neuronsIn), out(neuronsOut), act(act)
+	{
+		allocate();
+		kernels::initWeightsParallel<double>(pool, scheme, out, in, storage->W.data(), ld, splitMix64(seed), kernels::weightStream(index));
+	}
+
+	// Copies the weights and biases of a scalar Layer, so both compute the same function
+	DenseLayer(Layer& layer)
+	{
+		auto& neurons = layer.getNeurons();
+		out = neurons.size();
+		in = out ? neurons[0].getWeights().size() : 0;
+		act = (out && neurons[0].isNonlinear()) ? Activation::TanH : Activation::None;
+		allocate();
+
+		for (size_t i = 0; i < out; ++i)
+		{
+			const auto& w = neurons[i].getWeights();
+			for (size_t j = 0; j < in; ++j)
+			{
+				storage->W[i * ld + j] = w[j]->get_val();
+			}
+			storage->b[i] = neurons[i].getBias()->get_val();
+		}
+	}
+
+	DenseLayer(const DenseLayer& other) :
+		Module(other), in(other.in), out(other.out), ld(other.ld), act(other.act),
+		storage(std::make_shared<Storage>(*other.storage))
+	{
+	}
+
+	DenseLayer& operator= (const DenseLayer& other)
+	{
+		if (this != &other)
+		{
+			Module::operator= (other);
+			in = other.in;
+			out = other.out;
+			ld = other.ld;
+			act = other.act;
+			storage = std::make_shared<Storage>(*other.storage);
+		}
+		return *this;
+	}
+
+	DenseLayer(DenseLayer&&) = default;
+	DenseLayer& operator= (DenseLayer&&) = default;
+
+	// Forward pass on raw values: y = act(W * x + b). Streams W row by row.
+	void forward(const double* x, double* y) const
+	{
+		kernels::denseForward<double>(1, in, out, act, x, in, storage->W.data(), ld, storage->b.data(), y, out);
+	}
+
+	// Batched forward pass: Y (N x out) = act(X (N x in) * W^T + b), as one GEMM
+	void forward(const double* X, size_t N, double* Y) const
+	{
+		kernels::denseForward<double>(N, in, out, act, X, in, storage->W.data(), ld, storage->b.data(), Y, out);
+	}
+
+	// Batched backward pass for the output of forward(X, N, Y) and its gradient dY.
+	// Accumulates into the weight and bias gradients and, if dX is not null, into dX.
+	void backward(const double* X, size_t N, const double* Y, const double* dY, double* dX)
+	{
+		kernels::denseBackward<double>(N, in, out, act, X, in, storage->W.data(), ld, Y, dY, out, storage->gW.data(), storage->gb.data(), dX);
+	}
+
+	// The function call operator computes the layer's outputs as ExprNodes so the layer
+	// can be used anywhere a Layer is. All outputs share one hub node that depends on
+	// the inputs; each output's backward only stores its gradient, and the hub's backward
+	// then runs the fused dense backward kernel once for the whole layer.
+	std::vector<ValuePtr> operator() (const std::vector<ValuePtr>& inputs)
+	{
+		assert(inputs.size() == in);
+
+		// Per-call state shared by the output closures and the hub closure
+		auto x = std::make_shared<AlignedVector<double>>(in);
+		auto y = std::make_shared<AlignedVector<double>>(out);
+		auto dy = std::make_shared<AlignedVector<double>>(out, 0.0);
+
+		for (size_t j = 0; j < in; ++j)
+		{
+			(*x)[j] = inputs[j]->get_val();
+		}
+		forward(x->data(), y->data());
+
+		ValuePtr hub = ExprNode::Create(0.0, inputs, "Dense");
+		hub->set_backward([storage = storage, in = in, out = out, ld = ld, act = act, x, y, dy, hub = hub.get()]()
+		{
+			AlignedVector<double> dx(in, 0.0);
+			kernels::denseBackward<double>(1, in, out, act, x->data(), in, storage->W.data(), ld, y->data(), dy->data(), out,
+				storage->gW.data(), storage->gb.data(), dx.data());
+
+			const auto& inputs = hub->get_prev();
+			for (size_t j = 0; j < in; ++j)
+			{
+				inputs[j]->set_grad(inputs[j]->get_grad() + dx[j]);
+			}
+		});
+
+		std::vector<ValuePtr> outputs(out);
+		for (size_t i = 0; i < out; ++i)
+		{
+			ValuePtr o = ExprNode::Create((*y)[i], { hub }, "DenseOut");
+			o->set_backward([o = o.get(), dy, i]()
+			{
+				(*dy)[i] += o->get_grad();
+			});
+			outputs[i] = o;
+		}
+		return outputs;
+	}
+
+	size_t inputs() const { return in; }
+	size_t size() const { return out; }
+	size_t stride() const { return ld; }
+
+	NeuronView neuron(size_t i)
+	{
+		return NeuronView(storage->W.data() + i * ld, storage->b.data() + i, storage->gW.data() + i * ld, storage->gb.data() + i, in);
+	}
+
+	double* weights() { return storage->W.data(); }
+	double* biases() { return storage->b.data(); }
+	double* weight_grads() { return storage->gW.data(); }
+	double* bias_grads() { return storage->gb.data(); }
+
+	// The weights are not ExprNodes, so parameters() is empty; zero_grad and sgd_step
+	// work directly on the matrix.
+	void zero_grad() override
+	{
+		std::fill(storage->gW.begin(), storage->gW.end(), 0.0);
+		std::fill(storage->gb.begin(), storage->gb.end(), 0.0);
+	}
+
+	void sgd_step(double learningRate) override
+	{
+		for (size_t i = 0; i < storage->W.size(); ++i) storage->W[i] -= learningRate * storage->gW[i];
+		for (size_t i = 0; i < out; ++i) storage->b[i] -= learningRate * storage->gb[i];
+	}
+
+private:
+	size_t in = 0;
+	size_t out = 0;
+	size_t ld = 0; // row stride in doubles, a multiple of 8 so rows stay 64-byte aligned
+	Activation act = Activation::TanH;
+
+	// Weights and gradients sit behind a shared_ptr so the closures of a graph built by
+	// operator() keep them alive without pointing at the layer, which may be moved or
+	// destroyed before backward runs. Copies of the layer still get storage of their own.
+	struct Storage
+	{
+		AlignedVector<double> W;
+		AlignedVector<double> b;
+		AlignedVector<double> gW;
+		AlignedVector<double> gb;
+	};
+	std::shared_ptr<Storage> storage = std::make_shared<Storage>();
+
+	void allocate()
+	{
+		ld = (in + 7) & ~size_t(7);
+		storage->W.assign(out * ld, 0.0);
+		storage->gW.assign(out * ld, 0.0);
+		storage->b.assign(out, 0.0);
+		storage->gb.assign(out, 0.0);
+	}
+};
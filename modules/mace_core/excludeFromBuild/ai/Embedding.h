@@ -0,0 +1,235 @@
+#pragma once
+
+// The Embedding class maps categorical IDs to learned vectors, stored as one contiguous
+// table with one 64-byte aligned row per ID.
+//
+// Training touches only the rows of the IDs in the batch. Backward accumulates into a
+// compact gradient buffer with one row per distinct ID, and sgd_step updates only those
+// rows, so a step costs O(distinct IDs * dim) however large the table is.
+//
+// Weight decay is applied lazily: with decay d and learning rate lr, plain SGD shrinks every
+// row by (1 - lr * d) each step, touched or not. Instead, the table keeps the running log of
+// the product of those factors, and each row remembers the value at which it was last
+// brought up to date. Reading or updating a row first applies the factors it missed, which
+// gives the same weights as the eager update up to rounding, also when lr changes between
+// steps. The factors must stay positive, so every step needs lr * d < 1.
+class Embedding : public Module
+{
+public:
+	// Read-only view of one row of the table. Holds no storage of its own, and stays
+	// valid until the next sgd_step.
+	class RowView
+	{
+	public:
+		RowView(const double* v, size_t n) :
+			v(v), n(n) {}
+
+		size_t size() const { return n; }
+		double operator[] (size_t i) const { return v[i]; }
+		const double* data() const { return v; }
+
+	private:
+		const double* v;
+		size_t n;
+	};
+
+	// The vectors are initialized with generateRandomDouble() in [-1, 1], row by row
+	Embedding(size_t count, size_t dim, double weightDecay = 0.0) :
+		count(count), dim(dim), weightDecay(weightDecay)
+	{
+		if (!(weightDecay >= 0.0))
+		{
+			throw std::invalid_argument("Embedding: weightDecay must be non-negative");
+		}
+		ld = (dim + 7) & ~size_t(7);
+		table.assign(count * ld, 0.0);
+		for (size_t r = 0; r < count; ++r)
+		{
+			for (size_t k = 0; k < dim; ++k)
+			{
+				table[r * ld + k] = generateRandomDouble();
+			}
+		}
+		gradient->slot.assign(count, -1);
+		rowDecayLog.assign(count, 0.0);
+	}
+
+	Embedding(const Embedding& other) :
+		Module(other), count(other.count), dim(other.dim), ld(other.ld), weightDecay(other.weightDecay),
+		table(other.table), gradient(std::make_shared<SparseGradient>(*other.gradient)),
+		decayLog(other.decayLog), rowDecayLog(other.rowDecayLog)
+	{
+	}
+
+	Embedding& operator= (const Embedding& other)
+	{
+		if (this != &other)
+		{
+			Module::operator= (other);
+			count = other.count;
+			dim = other.dim;
+			ld = other.ld;
+			weightDecay = other.weightDecay;
+			table = other.table;
+			gradient = std::make_shared<SparseGradient>(*other.gradient);
+			decayLog = other.decayLog;
+			rowDecayLog = other.rowDecayLog;
+		}
+		return *this;
+	}
+
+	Embedding(Embedding&&) = default;
+	Embedding& operator= (Embedding&&) = default;
+
+	// Zero-copy lookup of one ID's vector
+	RowView row(uint32_t id)
+	{
+		assert(id < count);
+		catchUp(id);
+		return RowView(table.data() + id * ld, dim);
+	}
+
+	// Zero-copy lookup of a batch of IDs, one view per ID
+	std::vector<RowView> lookup(const std::vector<uint32_t>& ids)
+	{
+		std::vector<RowView> rows;
+		rows.reserve(ids.size());
+		for (uint32_t id : ids) rows.push_back(row(id));
+		return rows;
+	}
+
+	// Adds g (dim values) to the gradient of one ID's vector
+	void accumulate(uint32_t id, const double* g)
+	{
+		assert(id < count);
+		gradient->add(id, g, dim, ld);
+	}
+
+	// Looks up a batch of IDs as an N x dim Tensor for the layers that follow. The rows are
+	// copied, since the Tensor owns its storage; backward scatters the gradient rows back
+	// into the sparse gradient of the table.
+	TensorPtr operator() (const std::vector<uint32_t>& ids)
+	{
+		auto batch = std::make_shared<std::vector<uint32_t>>(ids);
+		TensorPtr out = Tensor::Create({ ids.size(), dim }, {}, "Embedding");
+		for (size_t n = 0; n < ids.size(); ++n)
+		{
+			const RowView r = row(ids[n]);
+			std::copy(r.data(), r.data() + dim, out->data() + n * dim);
+		}
+		out->set_backward([gradient = gradient, dim = dim, ld = ld, batch, out = out.get()]()
+		{
+			const double* g = out->grad();
+			for (size_t n = 0; n < batch->size(); ++n)
+			{
+				gradient->add((*batch)[n], g + n * dim, dim, ld);
+			}
+		});
+		return out;
+	}
+
+	size_t size() const { return count; }
+	size_t dimension() const { return dim; }
+
+	// IDs with a gradient since the last zero_grad, in first-touched order
+	const std::vector<uint32_t>& touched_rows() const { return gradient->touched; }
+
+	// Gradient of one ID's vector, or null if it was not touched since the last zero_grad
+	const double* grad(uint32_t id) const
+	{
+		const int32_t slot = gradient->slot[id];
+		return slot < 0 ? nullptr : gradient->rows.data() + static_cast<size_t>(slot) * ld;
+	}
+
+	void zero_grad() override
+	{
+		for (uint32_t id : gradient->touched) gradient->slot[id] = -1;
+		gradient->touched.clear();
+		gradient->rows.clear();
+	}
+
+	// w -= lr * (g + weightDecay * w) for the touched rows; the other rows only record the
+	// decay they missed. Throws if learningRate * weightDecay >= 1, where the eager update
+	// would flip or zero every weight and the decay log is undefined.
+	void sgd_step(double learningRate) override
+	{
+		if (weightDecay != 0.0 && !(learningRate * weightDecay < 1.0))
+		{
+			throw std::invalid_argument("Embedding::sgd_step: learningRate * weightDecay must be below 1");
+		}
+
+		const std::vector<uint32_t>& touched = gradient->touched;
+		for (size_t t = 0; t < touched.size(); ++t)
+		{
+			const uint32_t id = touched[t];
+			catchUp(id);
+			double* w = table.data() + id * ld;
+			const double* g = gradient->rows.data() + t * ld;
+			for (size_t k = 0; k < dim; ++k)
+			{
+				w[k] -= learningRate * (g[k] + weightDecay * w[k]);
+			}
+		}
+
+		if (weightDecay != 0.0)
+		{
+			decayLog += std::log(1.0 - learningRate * weightDecay);
+			for (uint32_t id : touched) rowDecayLog[id] = decayLog;
+		}
+	}
+
+	// Applies the pending decay to every row, e.g. before exporting the table
+	void flush()
+	{
+		for (uint32_t id = 0; id < count; ++id) catchUp(id);
+	}
+
+	// The whole table, count x stride(); rows may have pending decay unless flush() was called
+	const double* data() const { return table.data(); }
+	size_t stride() const { return ld; }
+
+private:
+	size_t count = 0;
+	size_t dim = 0;
+	size_t ld = 0; // row stride in doubles, a multiple of 8 so rows stay 64-byte aligned
+	double weightDecay = 0.0;
+
+	AlignedVector<double> table;
+
+	// Sparse gradient: one row per touched ID, in the order of touched. It sits behind a
+	// shared_ptr so the closures of lookup Tensors keep it alive without pointing at the
+	// layer, which may be moved or destroyed before backward runs.
+	struct SparseGradient
+	{
+		AlignedVector<double> rows;
+		std::vector<uint32_t> touched;
+		std::vector<int32_t> slot; // per ID, its row in rows or -1
+
+		// Adds g (dim values) to the row of id, allocating the row on first touch
+		void add(uint32_t id, const double* g, size_t dim, size_t ld)
+		{
+			if (slot[id] < 0)
+			{
+				slot[id] = static_cast<int32_t>(touched.size());
+				touched.push_back(id);
+				rows.resize(touched.size() * ld, 0.0);
+			}
+			double* dst = rows.data() + static_cast<size_t>(slot[id]) * ld;
+			for (size_t k = 0; k < dim; ++k) dst[k] += g[k];
+		}
+	};
+	std::shared_ptr<SparseGradient> gradient = std::make_shared<SparseGradient>();
+
+	// Lazy weight decay
+	double decayLog = 0.0;           // sum of log(1 - lr * weightDecay) over all steps
+	std::vector<double> rowDecayLog; // decayLog when each row was last brought up to date
+
+	void catchUp(uint32_t id)
+	{
+		if (rowDecayLog[id] == decayLog) return;
+		const double factor = std::exp(decayLog - rowDecayLog[id]);
+		double* w = table.data() + id * ld;
+		for (size_t k = 0; k < dim; ++k) w[k] *= factor;
+		rowDecayLog[id] = decayLog;
+	}
+};
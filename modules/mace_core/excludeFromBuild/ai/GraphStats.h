@@ -0,0 +1,45 @@
+#pragma once
+
+// Structure statistics for an ExprNode graph, collected by ExprNode::graph_stats().
+// Used to size checkpointing, fusion and parallelization settings before
+// committing to them.
+//
+// Depth is measured from the leaves: a leaf is at level 0 and every other node
+// sits one level above its deepest child, so all nodes on one level can be
+// evaluated independently of each other.
+struct GraphStats
+{
+	size_t nodeCount = 0;
+	size_t leafCount = 0;      // nodes with no children (parameters, inputs and constants)
+	size_t parameterCount = 0; // leaves found in the parameter list passed to graph_stats()
+	size_t maxDepth = 0;
+
+	std::map<std::string, size_t> opCounts;       // leaves are counted under "leaf"
+	std::map<size_t, size_t> fanInHistogram;      // children per node -> node count
+	std::map<size_t, size_t> fanOutHistogram;     // parents per node -> node count
+	std::vector<size_t> widthPerLevel;            // node count at each depth level
+
+	size_t nodeBytes = 0;    // ExprNode objects, their child vectors and op strings
+	size_t closureBytes = 0; // state captured by the _backward closures
+
+	json toJson() const
+	{
+		json histIn = json::object();
+		for (const auto& [k, v] : fanInHistogram) histIn[std::to_string(k)] = v;
+
+		json histOut = json::object();
+		for (const auto& [k, v] : fanOutHistogram) histOut[std::to_string(k)] = v;
+
+		return {
+			{ "nodes", nodeCount },
+			{ "leaves", leafCount },
+			{ "parameters", parameterCount },
+			{ "max_depth", maxDepth },
+			{ "ops", opCounts },
+			{ "fan_in", histIn },
+			{ "fan_out", histOut },
+			{ "width_per_level", widthPerLevel },
+			{ "bytes", { { "nodes", nodeBytes }, { "closures", closureBytes }, { "total", nodeBytes + closureBytes } } }
+		};
+	}
+};
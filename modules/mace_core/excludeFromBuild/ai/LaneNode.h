@@ -0,0 +1,296 @@
+#pragma once
+
+// Lane-vector autograd: an ExprNode-style scalar graph whose every value and gradient is a
+// small vector holding one sample per lane, i.e. one 256-bit register's worth of samples
+// (4 doubles or 8 floats). A graph written with scalar operations is built once and then
+// evaluates Width samples in lockstep.
+//
+// Unlike ExprNode, a LaneNode graph can be re-run without rebuilding it: set new input
+// values, call forward() on the root to recompute every node in topological order, then
+// backward() for the gradients. Nodes created with FromParameter() mirror an ExprNode
+// parameter: forward() reloads the parameter's current value into every lane, and backward()
+// adds the gradient summed across lanes into the parameter's grad, so the usual update rules
+// over Module::parameters() apply unchanged.
+//
+// When fewer than Width samples are left, backward(activeLanes) takes the count of real
+// samples in lanes [0, activeLanes); the padding lanes above it may hold anything, even NaN,
+// and add nothing to the parameter gradients.
+
+// One register's worth of values of type T
+template <typename T>
+struct Lanes
+{
+	static constexpr size_t Width = 32 / sizeof(T);
+
+	alignas(32) T v[Width];
+
+	Lanes() { std::fill(v, v + Width, T(0)); }
+	Lanes(T value) { std::fill(v, v + Width, value); }
+
+	T& operator[] (size_t i) { return v[i]; }
+	const T& operator[] (size_t i) const { return v[i]; }
+
+	// Sum across the first n lanes
+	T sum(size_t n = Width) const
+	{
+		T s = T(0);
+		for (size_t i = 0; i < n; ++i) s += v[i];
+		return s;
+	}
+
+	// Fixed-width loops over the aligned array, which the compiler turns into one or two
+	// vector instructions; the binary operators work on a copy to skip the zero fill
+	Lanes& operator+= (const Lanes& o) { for (size_t i = 0; i < Width; ++i) v[i] += o.v[i]; return *this; }
+	Lanes& operator-= (const Lanes& o) { for (size_t i = 0; i < Width; ++i) v[i] -= o.v[i]; return *this; }
+	Lanes& operator*= (const Lanes& o) { for (size_t i = 0; i < Width; ++i) v[i] *= o.v[i]; return *this; }
+	Lanes& operator/= (const Lanes& o) { for (size_t i = 0; i < Width; ++i) v[i] /= o.v[i]; return *this; }
+
+	Lanes operator+ (const Lanes& o) const { Lanes r(*this); return r += o; }
+	Lanes operator- (const Lanes& o) const { Lanes r(*this); return r -= o; }
+	Lanes operator* (const Lanes& o) const { Lanes r(*this); return r *= o; }
+	Lanes operator/ (const Lanes& o) const { Lanes r(*this); return r /= o; }
+	Lanes operator- () const { Lanes r(*this); for (size_t i = 0; i < Width; ++i) r.v[i] = -r.v[i]; return r; }
+
+	// The transcendental functions go through the vectorized kernels
+	Lanes tanh() const { Lanes r; kernels::vtanh(Width, v, r.v); return r; }
+	Lanes exp() const { Lanes r; kernels::vexp(Width, v, r.v); return r; }
+};
+
+template <typename T>
+class LaneNode : public std::enable_shared_from_this<LaneNode<T>>
+{
+public:
+	using Ptr = std::shared_ptr<LaneNode<T>>;
+	using Value = Lanes<T>;
+	static constexpr size_t Width = Value::Width;
+
+	// Factory method for an input node; set its lanes with set_val or set_lane
+	static Ptr Create(const Value& value = Value(), std::vector<Ptr> children = {}, std::string op = "")
+	{
+		Ptr instance = std::make_shared<LaneNode<T>>();
+		instance->data = value;
+		instance->_prev = std::move(children);
+		instance->_op = std::move(op);
+		return instance;
+	}
+
+	// Factory method for a node that mirrors an ExprNode parameter (see the file comment)
+	static Ptr FromParameter(const ValuePtr& parameter)
+	{
+		Ptr instance = Create(Value(static_cast<T>(parameter->get_val())), {}, "Param");
+		LaneNode* node = instance.get();
+		instance->_forward = [node, parameter]()
+		{
+			node->data = Value(static_cast<T>(parameter->get_val()));
+		};
+		instance->_backward = [node, parameter]()
+		{
+			parameter->set_grad(parameter->get_grad() + static_cast<double>(node->grad.sum(node->active)));
+		};
+		return instance;
+	}
+
+	const Value& get_val() const { return data; }
+	const Value& get_grad() const { return grad; }
+	void set_val(const Value& value) { data = value; }
+	void set_lane(size_t lane, T value) { data[lane] = value; }
+	const std::string& get_op() const { return _op; }
+
+	Ptr operator+ (const Ptr& other)
+	{
+		return binary(other, "+", data + other->data,
+			[](LaneNode* a, LaneNode* b, LaneNode* o) { o->data = a->data + b->data; },
+			[](LaneNode* a, LaneNode* b, LaneNode* o) { a->grad += o->grad; b->grad += o->grad; });
+	}
+
+	Ptr operator- (const Ptr& other)
+	{
+		return binary(other, "-", data - other->data,
+			[](LaneNode* a, LaneNode* b, LaneNode* o) { o->data = a->data - b->data; },
+			[](LaneNode* a, LaneNode* b, LaneNode* o) { a->grad += o->grad; b->grad += -o->grad; });
+	}
+
+	Ptr operator* (const Ptr& other)
+	{
+		return binary(other, "*", data * other->data,
+			[](LaneNode* a, LaneNode* b, LaneNode* o) { o->data = a->data * b->data; },
+			[](LaneNode* a, LaneNode* b, LaneNode* o) { a->grad += b->data * o->grad; b->grad += a->data * o->grad; });
+	}
+
+	Ptr operator/ (const Ptr& other)
+	{
+		return binary(other, "/", data / other->data,
+			[](LaneNode* a, LaneNode* b, LaneNode* o) { o->data = a->data / b->data; },
+			[](LaneNode* a, LaneNode* b, LaneNode* o)
+			{
+				a->grad += o->grad / b->data;
+				b->grad += -(o->grad * o->data / b->data);
+			});
+	}
+
+	// Operations with a constant, which is captured rather than turned into a node
+	Ptr operator+ (T c)
+	{
+		return unary("+", data + Value(c),
+			[c](LaneNode* a, LaneNode* o) { o->data = a->data + Value(c); },
+			[](LaneNode* a, LaneNode* o) { a->grad += o->grad; });
+	}
+
+	Ptr operator* (T c)
+	{
+		return unary("*", data * Value(c),
+			[c](LaneNode* a, LaneNode* o) { o->data = a->data * Value(c); },
+			[c](LaneNode* a, LaneNode* o) { a->grad += o->grad * Value(c); });
+	}
+
+	Ptr operator- (T c) { return *this + (-c); }
+	Ptr operator/ (T c) { return *this * (T(1) / c); }
+	Ptr operator-() { return *this * T(-1); }
+
+	Ptr pow(T exponent)
+	{
+		return unary("Pow", power(data, exponent),
+			[exponent](LaneNode* a, LaneNode* o) { o->data = power(a->data, exponent); },
+			[exponent](LaneNode* a, LaneNode* o)
+			{
+				const Value d = power(a->data, exponent - T(1));
+				for (size_t i = 0; i < Width; ++i) a->grad.v[i] += exponent * d.v[i] * o->grad.v[i];
+			});
+	}
+
+	Ptr tanH()
+	{
+		// The derivative is written in terms of the output: 1 - tanh^2
+		return unary("TanH", data.tanh(),
+			[](LaneNode* a, LaneNode* o) { o->data = a->data.tanh(); },
+			[](LaneNode* a, LaneNode* o) { a->grad += o->grad * (Value(T(1)) - o->data * o->data); });
+	}
+
+	Ptr exp()
+	{
+		return unary("Exp", data.exp(),
+			[](LaneNode* a, LaneNode* o) { o->data = a->data.exp(); },
+			[](LaneNode* a, LaneNode* o) { a->grad += o->grad * o->data; });
+	}
+
+	Ptr relu()
+	{
+		auto f = [](const Value& x, Value& y) { for (size_t i = 0; i < Width; ++i) y.v[i] = x.v[i] > T(0) ? x.v[i] : T(0); };
+		Value value;
+		f(data, value);
+		return unary("ReLU", value,
+			[f](LaneNode* a, LaneNode* o) { f(a->data, o->data); },
+			[](LaneNode* a, LaneNode* o)
+			{
+				for (size_t i = 0; i < Width; ++i) a->grad.v[i] += a->data.v[i] > T(0) ? o->grad.v[i] : T(0);
+			});
+	}
+
+	// Recomputes every node below this one from the current inputs and parameters
+	void forward()
+	{
+		for (LaneNode* node : topology())
+		{
+			if (node->_forward) node->_forward();
+		}
+	}
+
+	// Gradients of every lane of this node with respect to everything below it.
+	// Gradients are reset first, so repeated backward() calls do not accumulate, except
+	// in the mirrored ExprNode parameters, which accumulate like ExprNode gradients do.
+	// Only lanes [0, activeLanes) are seeded and summed into the parameters; a padding
+	// lane's gradient is zero, or NaN if its values were, and never reaches them.
+	void backward(size_t activeLanes = Width)
+	{
+		assert(activeLanes <= Width);
+
+		const std::vector<LaneNode*>& topo = topology();
+		for (LaneNode* node : topo)
+		{
+			node->grad = Value();
+			node->active = activeLanes;
+		}
+
+		for (size_t i = 0; i < activeLanes; ++i) grad.v[i] = T(1);
+		for (auto it = topo.rbegin(); it != topo.rend(); ++it)
+		{
+			if ((*it)->_backward) (*it)->_backward();
+		}
+	}
+
+private:
+	Value data;
+	Value grad;
+	size_t active = Width; // lanes holding real samples in the last backward()
+	std::vector<Ptr> _prev;
+	std::string _op;
+	std::function<void()> _forward;
+	std::function<void()> _backward;
+	std::vector<LaneNode*> _topo; // cached; the graph below a node never changes once built
+
+	// x^exponent lane by lane; squares, and the copy the derivative of pow(2) needs, skip std::pow
+	static Value power(const Value& x, T exponent)
+	{
+		Value r(x);
+		if (exponent == T(2))
+		{
+			for (size_t i = 0; i < Width; ++i) r.v[i] *= x.v[i];
+		}
+		else if (exponent != T(1))
+		{
+			for (size_t i = 0; i < Width; ++i) r.v[i] = std::pow(x.v[i], exponent);
+		}
+		return r;
+	}
+
+	// Children are kept alive by the output's _prev, so the closures hold raw pointers
+	template <typename F, typename B>
+	Ptr binary(const Ptr& other, const char* op, const Value& value, F f, B b)
+	{
+		Ptr out = Create(value, { this->shared_from_this(), other }, op);
+		LaneNode* a = this;
+		LaneNode* c = other.get();
+		LaneNode* o = out.get();
+		out->_forward = [a, c, o, f]() { f(a, c, o); };
+		out->_backward = [a, c, o, b]() { b(a, c, o); };
+		return out;
+	}
+
+	template <typename F, typename B>
+	Ptr unary(const char* op, const Value& value, F f, B b)
+	{
+		Ptr out = Create(value, { this->shared_from_this() }, op);
+		LaneNode* a = this;
+		LaneNode* o = out.get();
+		out->_forward = [a, o, f]() { f(a, o); };
+		out->_backward = [a, o, b]() { b(a, o); };
+		return out;
+	}
+
+	// Post-order of the graph below this node, built once with an iterative DFS
+	const std::vector<LaneNode*>& topology()
+	{
+		if (!_topo.empty()) return _topo;
+
+		std::unordered_set<LaneNode*> visited;
+		std::vector<std::pair<LaneNode*, size_t>> stack;
+		stack.push_back({ this, 0 });
+		visited.insert(this);
+		while (!stack.empty())
+		{
+			auto& [node, next] = stack.back();
+			if (next < node->_prev.size())
+			{
+				LaneNode* child = node->_prev[next++].get();
+				if (visited.insert(child).second) stack.push_back({ child, 0 });
+				continue;
+			}
+			_topo.push_back(node);
+			stack.pop_back();
+		}
+		return _topo;
+	}
+};
+
+using LanePtr = LaneNode<double>::Ptr;
+using LanePtrF = LaneNode<float>::Ptr;
@@ -0,0 +1,329 @@
+#pragma once
+
+// Liveness-based buffer planning for Tensor graphs.
+//
+// A Tensor graph keeps every intermediate value and gradient in a buffer of its own until
+// the graph is released, although most of them are needed only for a short stretch of the
+// forward + backward schedule. MemoryPlanner walks the graph captured under a root tensor,
+// lays out the schedule (forward in topological order, then backward in reverse) and gives
+// every intermediate buffer a lifetime:
+//   - a value lives from the forward step of its tensor (or of the tensor that owns the
+//     storage, for views) to its last use: the forward steps of its parents and the
+//     backward steps of the parents and of itself, whose closures read it;
+//   - a gradient lives from the backward step of the first parent that writes it to the
+//     backward step of its own tensor, which reads it.
+// Buffers are packed largest first into slabs, 64-byte aligned buffers that hold one
+// buffer at a time, so buffers whose lifetimes do not overlap share a slab. An elementwise
+// op whose input dies at that op is planned in place: its output takes the input's slab.
+// Leaves (parameters and inputs) and the root's value are never planned.
+//
+// The forward pass runs eagerly as ops are called, so values are already allocated when
+// a graph exists; their plan is only reported. Gradients are allocated during backward,
+// and backward() places them in the planner's slabs, which persist across calls so a
+// training loop allocates no intermediate gradients after its first step. Afterwards only
+// the gradients of the leaves are meaningful; intermediate gradients have been overwritten
+// by later occupants of their slab.
+
+// Buffer sizes of one graph, without and with planning
+struct MemoryReport
+{
+	size_t nodes = 0;
+	size_t valueBuffers = 0;
+	size_t gradientBuffers = 0;
+	size_t inPlace = 0;          // values planned in place of an input
+
+	size_t naiveValueBytes = 0;  // every intermediate value in a buffer of its own
+	size_t peakValueBytes = 0;   // largest total of values alive at one step, a lower bound
+	size_t plannedValueBytes = 0;
+	size_t valueSlabs = 0;
+
+	size_t naiveGradientBytes = 0;
+	size_t peakGradientBytes = 0;
+	size_t plannedGradientBytes = 0;
+	size_t gradientSlabs = 0;
+
+	size_t naiveBytes() const { return naiveValueBytes + naiveGradientBytes; }
+	size_t plannedBytes() const { return plannedValueBytes + plannedGradientBytes; }
+	size_t savedBytes() const { return naiveBytes() - plannedBytes(); }
+
+	json toJson() const
+	{
+		auto pool = [](size_t buffers, size_t naive, size_t peak, size_t planned, size_t slabs)
+		{
+			return json{ { "buffers", buffers }, { "naive_bytes", naive }, { "peak_live_bytes", peak },
+				{ "planned_bytes", planned }, { "slabs", slabs } };
+		};
+		return {
+			{ "nodes", nodes },
+			{ "in_place", inPlace },
+			{ "values", pool(valueBuffers, naiveValueBytes, peakValueBytes, plannedValueBytes, valueSlabs) },
+			{ "gradients", pool(gradientBuffers, naiveGradientBytes, peakGradientBytes, plannedGradientBytes, gradientSlabs) },
+			{ "bytes", { { "naive", naiveBytes() }, { "planned", plannedBytes() }, { "saved", savedBytes() } } }
+		};
+	}
+};
+
+class MemoryPlanner
+{
+public:
+	// Plans the graph under root without running anything
+	const MemoryReport& plan(const TensorPtr& root)
+	{
+		build(root);
+		return lastReport;
+	}
+
+	// root->backward() with the intermediate gradients placed in the planner's slabs
+	const MemoryReport& backward(const TensorPtr& root)
+	{
+		build(root);
+
+		// Slabs grow by replacement, never in place: tensors of earlier graphs may still point
+		// into the old ones
+		gradientSlabs.resize(gradientSlabBytes.size());
+		for (size_t s = 0; s < gradientSlabs.size(); ++s)
+		{
+			const size_t elements = gradientSlabBytes[s] / sizeof(double);
+			if (!gradientSlabs[s] || gradientSlabs[s]->size() < elements)
+			{
+				gradientSlabs[s] = std::make_shared<TensorBuffer>(elements);
+			}
+		}
+		for (const Buffer& b : gradients)
+		{
+			b.tensor->bind_grad(gradientSlabs[b.slab], 0);
+		}
+
+		// Each gradient is cleared at the step that first writes it, when its slab is free
+		std::vector<std::vector<const Buffer*>> starts(2 * order.size());
+		for (const Buffer& b : gradients) starts[b.first / 2].push_back(&b);
+
+		for (size_t k = 0; k < order.size(); ++k)
+		{
+			Tensor* t = order[order.size() - 1 - k];
+			for (const Buffer* b : starts[order.size() + k])
+			{
+				std::fill(b->tensor->grad(), b->tensor->grad() + b->tensor->numel(), 0.0);
+			}
+			if (k == 0)
+			{
+				double* g = t->grad();
+				std::fill(g, g + t->numel(), 1.0);
+			}
+			t->propagate();
+		}
+		return lastReport;
+	}
+
+	const MemoryReport& report() const { return lastReport; }
+
+private:
+	// One planned buffer. Lifetimes are in half steps: a buffer used from step f to step l
+	// covers [2f, 2l + 1], except that the output of an in-place op starts at 2f + 1 and its
+	// input ends at 2l, so the two meet without overlapping.
+	struct Buffer
+	{
+		Tensor* tensor = nullptr;
+		size_t bytes = 0;
+		size_t first = 0;
+		size_t last = 0;
+		ptrdiff_t source = -1; // the input this buffer may overwrite in place, by index
+		ptrdiff_t target = -1; // the output that may overwrite this buffer in place
+		size_t slab = 0;
+	};
+
+	std::vector<Tensor*> order;
+	std::vector<Buffer> values;
+	std::vector<Buffer> gradients;
+	std::vector<size_t> valueSlabBytes;
+	std::vector<size_t> gradientSlabBytes;
+	std::vector<std::shared_ptr<TensorBuffer>> gradientSlabs;
+	MemoryReport lastReport;
+
+	static size_t alignedBytes(size_t elements)
+	{
+		return (elements * sizeof(double) + 63) & ~size_t(63);
+	}
+
+	// Ops whose kernels read element i of the input before writing element i of the output
+	static bool isElementwise(const std::string& op)
+	{
+		static const std::unordered_set<std::string> ops = { "+", "-", "*", "Scale", "TanH", "Sigmoid", "ReLU", "Exp", "Dropout" };
+		return ops.count(op) != 0;
+	}
+
+	void build(const TensorPtr& root)
+	{
+		order = root->topological_order();
+		const size_t F = order.size();
+		std::unordered_map<const Tensor*, size_t> step;
+		for (size_t i = 0; i < F; ++i) step[order[i]] = i;
+		auto backwardStep = [F](size_t forward) { return 2 * F - 1 - forward; };
+
+		std::unordered_map<const Tensor*, std::vector<Tensor*>> parents;
+		for (Tensor* t : order)
+		{
+			for (const TensorPtr& c : t->get_prev()) parents[c.get()].push_back(t);
+		}
+
+		// Storage shared with a leaf, or the root's value, outlives the schedule
+		std::unordered_set<const void*> persistent = { root->storage_id() };
+		for (Tensor* t : order)
+		{
+			if (t->get_prev().empty()) persistent.insert(t->storage_id());
+		}
+
+		// Values, one buffer per storage, extended by the uses of every tensor viewing it
+		values.clear();
+		std::unordered_map<const void*, size_t> owner;
+		for (Tensor* t : order)
+		{
+			if (persistent.count(t->storage_id())) continue;
+
+			auto [it, created] = owner.emplace(t->storage_id(), values.size());
+			if (created)
+			{
+				Buffer b;
+				b.tensor = t;
+				b.bytes = alignedBytes(t->numel());
+				b.first = b.last = step[t];
+				values.push_back(b);
+			}
+			Buffer& b = values[it->second];
+			if (t->requires_grad()) b.last = std::max(b.last, backwardStep(step[t]));
+			for (Tensor* p : parents[t])
+			{
+				b.last = std::max(b.last, p->requires_grad() ? backwardStep(step[p]) : step[p]);
+			}
+		}
+
+		// An elementwise output may take over an input of the same size that dies at its step
+		for (size_t i = 0; i < values.size(); ++i)
+		{
+			Buffer& out = values[i];
+			if (!isElementwise(out.tensor->get_op())) continue;
+			for (const TensorPtr& c : out.tensor->get_prev())
+			{
+				auto it = owner.find(c->storage_id());
+				if (it == owner.end()) continue;
+				Buffer& in = values[it->second];
+				if (in.tensor == c.get() && in.target < 0 && in.last == out.first && in.tensor->numel() == out.tensor->numel())
+				{
+					in.target = static_cast<ptrdiff_t>(i);
+					out.source = static_cast<ptrdiff_t>(it->second);
+					break;
+				}
+			}
+		}
+		for (Buffer& b : values)
+		{
+			b.first = 2 * b.first + (b.source >= 0 ? 1 : 0);
+			b.last = 2 * b.last + (b.target >= 0 ? 0 : 1);
+		}
+
+		// Gradients of the intermediates that backward reaches, the root's first
+		gradients.clear();
+		for (size_t i = F; i-- > 0;)
+		{
+			Tensor* t = order[i];
+			if (!t->requires_grad() || t->get_prev().empty()) continue;
+
+			Buffer b;
+			b.tensor = t;
+			b.bytes = alignedBytes(t->numel());
+			b.first = backwardStep(i);
+			for (Tensor* p : parents[t]) b.first = std::min(b.first, backwardStep(step[p]));
+			b.first *= 2;
+			b.last = 2 * backwardStep(i) + 1;
+			gradients.push_back(b);
+		}
+
+		MemoryReport r;
+		r.nodes = F;
+		r.valueBuffers = values.size();
+		r.gradientBuffers = gradients.size();
+		r.inPlace = assignSlabs(values, valueSlabBytes);
+		assignSlabs(gradients, gradientSlabBytes);
+		summarize(values, valueSlabBytes, r.naiveValueBytes, r.peakValueBytes, r.plannedValueBytes, r.valueSlabs);
+		summarize(gradients, gradientSlabBytes, r.naiveGradientBytes, r.peakGradientBytes, r.plannedGradientBytes, r.gradientSlabs);
+		lastReport = r;
+	}
+
+	// Greedy by size: each buffer goes to the first slab whose occupants it does not overlap,
+	// trying the slab of its in-place input or output first. Returns the number of outputs
+	// that ended up in their input's slab.
+	static size_t assignSlabs(std::vector<Buffer>& buffers, std::vector<size_t>& slabBytes)
+	{
+		std::vector<size_t> byBytes(buffers.size());
+		std::iota(byBytes.begin(), byBytes.end(), size_t(0));
+		std::stable_sort(byBytes.begin(), byBytes.end(), [&](size_t a, size_t b) { return buffers[a].bytes > buffers[b].bytes; });
+
+		slabBytes.clear();
+		std::vector<std::vector<size_t>> occupants;
+		std::vector<bool> placed(buffers.size(), false);
+
+		auto fits = [&](size_t slab, const Buffer& b)
+		{
+			for (size_t o : occupants[slab])
+			{
+				if (buffers[o].first <= b.last && b.first <= buffers[o].last) return false;
+			}
+			return true;
+		};
+
+		for (size_t i : byBytes)
+		{
+			Buffer& b = buffers[i];
+			ptrdiff_t chosen = -1;
+			for (ptrdiff_t partner : { b.source, b.target })
+			{
+				if (chosen < 0 && partner >= 0 && placed[partner] && fits(buffers[partner].slab, b))
+				{
+					chosen = static_cast<ptrdiff_t>(buffers[partner].slab);
+				}
+			}
+			for (size_t s = 0; chosen < 0 && s < slabBytes.size(); ++s)
+			{
+				if (fits(s, b)) chosen = static_cast<ptrdiff_t>(s);
+			}
+			if (chosen < 0)
+			{
+				chosen = static_cast<ptrdiff_t>(slabBytes.size());
+				slabBytes.push_back(b.bytes);
+				occupants.emplace_back();
+			}
+			b.slab = static_cast<size_t>(chosen);
+			occupants[b.slab].push_back(i);
+			placed[i] = true;
+		}
+
+		size_t inPlace = 0;
+		for (const Buffer& b : buffers)
+		{
+			if (b.source >= 0 && buffers[b.source].slab == b.slab) ++inPlace;
+		}
+		return inPlace;
+	}
+
+	static void summarize(const std::vector<Buffer>& buffers, const std::vector<size_t>& slabBytes,
+		size_t& naive, size_t& peak, size_t& planned, size_t& slabs)
+	{
+		naive = 0;
+		std::map<size_t, ptrdiff_t> change;
+		for (const Buffer& b : buffers)
+		{
+			naive += b.bytes;
+			change[b.first] += static_cast<ptrdiff_t>(b.bytes);
+			change[b.last + 1] -= static_cast<ptrdiff_t>(b.bytes);
+		}
+		ptrdiff_t live = 0;
+		peak = 0;
+		for (const auto& [at, delta] : change)
+		{
+			live += delta;
+			peak = std::max(peak, static_cast<size_t>(live));
+		}
+		planned = std::accumulate(slabBytes.begin(), slabBytes.end(), size_t(0));
+		slabs = slabBytes.size();
+	}
+};
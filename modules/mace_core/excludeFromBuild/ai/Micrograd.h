@@ -6,6 +6,10 @@
 // This class was created with some help from ChatGPT4
 using ValuePtr = std::shared_ptr<class ExprNode>;
 
+// Lane-vector nodes for evaluating several samples per graph (see LaneNode.h)
+template <typename T>
+class LaneNode;
+
 // The ExprNode(Expression Node) class is enabled to manage shared_ptr instances of itself
 class ExprNode : public std::enable_shared_from_this<class ExprNode>
 {
@@ -26,6 +30,16 @@ public:
 		return instance;
 	}
 
+	// Factory method for nodes with a runtime number of children, e.g. a whole layer's inputs
+	static ValuePtr Create(double data, const std::vector<ValuePtr>& children, std::string op)
+	{
+		ValuePtr instance = std::make_shared<ExprNode>(data);
+		instance->_prev = children;
+		instance->_op = op;
+		instance->_backward = [] {};
+		return instance;
+	}
+
 	// Constructor that takes initial data and initializes grad to 0
 	ExprNode(double data) :
 		data(data), grad(0.0) {}
@@ -38,6 +52,8 @@ public:
 	// Operator overload for addition with another ValuePtr
 	ValuePtr operator+ (ValuePtr other)
 	{
+		AutogradProfiler::Scope profile(ProfileOp::Add, ProfilePass::Forward);
+
 		// If other is null, create a new ExprNode with data 0
 		if (!other) other = Create(0);
 
@@ -45,11 +61,11 @@ public:
 		auto out = Create(this->data + other->data, { shared_from_this(), other }, "+");
 
 		// Set up _backward function to compute and store gradients
-		out->_backward = [this, other, out]()
+		out->set_backward([this, other, out = out.get()]()
 		{
 			this->grad += out->grad;
 			other->grad += out->grad;
-		};
+		});
 		return out;
 	}
 
@@ -62,29 +78,33 @@ public:
 	// Operator overload for addition with a double
 	ValuePtr operator+ (double val)
 	{
+		AutogradProfiler::Scope profile(ProfileOp::Add, ProfilePass::Forward);
+
 		// Create a new ExprNode with data val
 		ValuePtr other = Create(val);
 
 		// Process as in the previous method
 		auto out = Create(this->data + other->data, { shared_from_this(), other }, "+");
-		out->_backward = [this, other, out]()
+		out->set_backward([this, other, out = out.get()]()
 		{
 			this->grad += out->grad;
 			other->grad += out->grad;
-		};
+		});
 		return out;
 	}
 
 	// Operator overload for multiplication with another ValuePtr
 	ValuePtr operator* (ValuePtr other)
 	{
+		AutogradProfiler::Scope profile(ProfileOp::Mul, ProfilePass::Forward);
+
 		if (!other) other = std::make_shared<ExprNode>(1);
 		auto out = Create(this->data * other->data, { shared_from_this(), other }, "*");
-		out->_backward = [this, other, out]()
+		out->set_backward([this, other, out = out.get()]()
 		{
 			this->grad += other->data * out->grad;
 			other->grad += this->data * out->grad;
-		};
+		});
 		return out;
 	}
 
@@ -106,12 +126,14 @@ public:
 			throw std::invalid_argument("Division by zero is not allowed");
 		}
 
+		AutogradProfiler::Scope profile(ProfileOp::Div, ProfilePass::Forward);
+
 		auto out = Create(this->data / other->data, { shared_from_this(), other }, "/");
-		out->_backward = [this, other, out]()
+		out->set_backward([this, other, out = out.get()]()
 		{
 			this->grad += 1 / other->data * out->grad;
 			other->grad -= this->data / (other->data * other->data) * out->grad;
-		};
+		});
 		return out;
 	}
 
@@ -119,24 +141,28 @@ public:
 	// Operator overload for multiplication with a double
 	ValuePtr operator* (double val)
 	{
+		AutogradProfiler::Scope profile(ProfileOp::Mul, ProfilePass::Forward);
+
 		ValuePtr other = Create(val);
 		auto out = Create(this->data * other->data, { shared_from_this(), other }, "*");
-		out->_backward = [this, other, out]()
+		out->set_backward([this, other, out = out.get()]()
 		{
 			this->grad += other->data * out->grad;
 			other->grad += this->data * out->grad;
-		};
+		});
 		return out;
 	}
 
 	// Power operation
 	ValuePtr pow(double other)
 	{
+		AutogradProfiler::Scope profile(ProfileOp::Pow, ProfilePass::Forward);
+
 		auto out = Create(std::pow(this->data, other), { shared_from_this() }, "^");
-		out->_backward = [this, other, out]()
+		out->set_backward([this, other, out = out.get()]()
 		{
 			this->grad += (other * std::pow(this->data, other - 1)) * out->grad;
-		};
+		});
 		return out;
 	}
 
@@ -150,6 +176,10 @@ public:
 	// Backward propagation
 	void backward()
 	{
+		const bool profiling = AutogradProfiler::isEnabled();
+		AutogradProfiler::Clock::time_point topoStart;
+		if (profiling) topoStart = AutogradProfiler::Clock::now();
+
 		// Topological sort to find execution order
 		std::vector<ValuePtr> topo;
 		std::set<ValuePtr> visited;
@@ -170,6 +200,22 @@ public:
 		// Execute _backward in topological order
 		this->grad = 1.0;
 
+		if (profiling)
+		{
+			AutogradProfiler::recordTopoSort(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				AutogradProfiler::Clock::now() - topoStart).count());
+
+			// Leaves have an empty _backward and are not recorded
+			for (auto it = topo.rbegin(); it != topo.rend(); ++it)
+			{
+				if ((*it)->_op.empty()) continue;
+
+				AutogradProfiler::Scope profile(AutogradProfiler::opFromString((*it)->_op), ProfilePass::Backward);
+				(*it)->_backward();
+			}
+			return;
+		}
+
 		for (auto it = topo.rbegin(); it != topo.rend(); ++it)
 		{
 			(*it)->_backward();
@@ -183,13 +229,16 @@ public:
 	// like gradient descent.
 	ValuePtr tanH()
 	{
+		AutogradProfiler::Scope profile(ProfileOp::TanH, ProfilePass::Forward);
+
 		auto out = Create(std::tanh(this->data), { shared_from_this() }, "TanH");
 
-		out->_backward = [this, out]()
+		out->set_backward([this, out = out.get()]()
 		{
-			double tanh_out_squared = std::pow(std::tanh(out->data), 2);
+			// out->data already holds tanh(x), so it must not be passed through tanh again
+			double tanh_out_squared = out->data * out->data;
 			this->grad = this->grad + out->get_grad() * (1 - tanh_out_squared);
-		};
+		});
 
 		return out;
 	}
@@ -202,6 +251,8 @@ public:
 	// simple version of softmax and may need adjustment based on the exact setup of your network.
 	std::vector<ValuePtr> softmax()
 	{
+		AutogradProfiler::Scope profile(ProfileOp::Softmax, ProfilePass::Forward);
+
 		// Compute the sum of exponential values of all elements
 		double sum_exp = 0;
 		for (auto& node : _prev)
@@ -214,17 +265,96 @@ public:
 		for (auto& node : _prev)
 		{
 			auto out = Create(std::exp(node->data) / sum_exp, { shared_from_this(), node }, "Softmax");
-			out->_backward = [this, node, out, sum_exp]()
+			out->set_backward([this, node, out = out.get(), sum_exp]()
 			{
 				this->grad += (out->get_grad() * (1 - out->get_val())) * out->get_val();
 				node->grad -= this->grad * out->get_val();
-			};
+			});
 			softmax_values.push_back(out);
 		}
 
 		return softmax_values;
 	}
 
+	// Assigns the closure that propagates this node's gradient to its children.
+	// Also records the size of the captured state for graph_stats().
+	// Closures capture the output node by raw pointer; capturing its shared_ptr
+	// would make the node own itself and the graph would never be freed.
+	template <typename F>
+	void set_backward(F&& fn)
+	{
+		_backward = std::forward<F>(fn);
+		_closureBytes = static_cast<uint32_t>(sizeof(std::decay_t<F>));
+	}
+
+	// Collects structure statistics for the graph rooted at this node.
+	// Leaves found in 'parameters' are counted as parameters.
+	// The traversal is iterative so very deep graphs do not overflow the stack.
+	GraphStats graph_stats(const std::vector<ValuePtr>& parameters = {})
+	{
+		GraphStats stats;
+		std::unordered_set<const ExprNode*> params;
+		for (const auto& p : parameters) params.insert(p.get());
+
+		std::unordered_map<const ExprNode*, size_t> level;
+		std::unordered_map<const ExprNode*, size_t> fanOut;
+
+		// Post-order DFS: a node is finished once all of its children are
+		std::vector<std::pair<ExprNode*, size_t>> stack;
+		stack.push_back({ this, 0 });
+		level.reserve(1024);
+
+		while (!stack.empty())
+		{
+			auto& [node, next] = stack.back();
+			if (next == 0)
+			{
+				if (level.count(node))
+				{
+					stack.pop_back();
+					continue;
+				}
+				for (auto& child : node->_prev) ++fanOut[child.get()];
+			}
+
+			if (next < node->_prev.size())
+			{
+				ExprNode* child = node->_prev[next++].get();
+				if (!level.count(child)) stack.push_back({ child, 0 });
+				continue;
+			}
+
+			size_t depth = 0;
+			for (auto& child : node->_prev) depth = std::max(depth, level[child.get()] + 1);
+			level[node] = depth;
+
+			++stats.nodeCount;
+			++stats.fanInHistogram[node->_prev.size()];
+			++stats.opCounts[node->_prev.empty() ? std::string("leaf") : node->_op];
+
+			if (node->_prev.empty())
+			{
+				++stats.leafCount;
+				if (params.count(node)) ++stats.parameterCount;
+			}
+
+			if (stats.widthPerLevel.size() <= depth) stats.widthPerLevel.resize(depth + 1, 0);
+			++stats.widthPerLevel[depth];
+			stats.maxDepth = std::max(stats.maxDepth, depth);
+
+			// Nodes come from make_shared, so the control block shares the allocation
+			stats.nodeBytes += sizeof(ExprNode) + 2 * sizeof(void*) + node->_prev.capacity() * sizeof(ValuePtr);
+			if (node->_op.capacity() > std::string().capacity()) stats.nodeBytes += node->_op.capacity() + 1;
+			stats.closureBytes += node->_closureBytes;
+
+			stack.pop_back();
+		}
+
+		for (const auto& [node, d] : level) ++stats.fanOutHistogram[fanOut.count(node) ? fanOut[node] : 0];
+
+		return stats;
+	}
+
 	// Getters for data and grad
 	double get_val()
 	{
@@ -242,6 +372,14 @@ public:
 	{
 		data = val;
 	}
+	const std::string& get_op() const
+	{
+		return _op;
+	}
+	const std::vector<ValuePtr>& get_prev() const
+	{
+		return _prev;
+	}
 
 private:
 	double data;                     // The data held by the ExprNode
@@ -249,6 +387,7 @@ private:
 	std::string _op;                 // The operation that produced this ExprNode
 	std::vector<ValuePtr> _prev;     // The previous Values that this ExprNode depends on
 	std::function<void()> _backward; // The function to propagate gradients back through this ExprNode
+	uint32_t _closureBytes = 0;      // Size of the state captured by _backward
 };
 
 // The Module class is an abstract base class that represents a component of a neural network.
@@ -265,6 +404,10 @@ public:
 		{
 			p->set_grad(0);
 		}
+		for (auto& t : this->tensor_parameters())
+		{
+			t->zero_grad();
+		}
 	}
 
 	// The 'parameters' member function returns a vector containing all the parameters of the module.
@@ -274,6 +417,32 @@ public:
 	{
 		return {};
 	}
+
+	// The 'sgd_step' member function applies one step of gradient descent to all parameters.
+	// Modules that keep their weights outside ExprNodes (like DenseLayer) override it.
+	virtual void sgd_step(double learningRate)
+	{
+		for (auto& p : this->parameters())
+		{
+			p->set_val(p->get_val() - learningRate * p->get_grad());
+		}
+		for (auto& t : this->tensor_parameters())
+		{
+			double* v = t->data();
+			double* g = t->grad();
+			for (size_t i = 0; i < t->numel(); ++i)
+			{
+				v[i] -= learningRate * g[i];
+			}
+		}
+	}
+
+	// The 'tensor_parameters' member function returns the parameters of modules that keep
+	// their weights in Tensors (like TensorLayer) rather than in individual ExprNodes.
+	virtual std::vector<TensorPtr> tensor_parameters()
+	{
+		return {};
+	}
 };
 
 // The Neuron class represents a single neuron in a neural network.
@@ -312,6 +481,13 @@ public:
 		bias = ExprNode::Create(0.0);
 	}
 
+	// Takes ready-made weight nodes, e.g. from Layer's parallel initialization; the bias is 0
+	Neuron(std::vector<ValuePtr>&& initialWeights, bool nonlin = true) :
+		weights(std::move(initialWeights)), nonlin(nonlin)
+	{
+		bias = ExprNode::Create(0.0);
+	}
+
 	// The function call operator is overloaded to compute the output of the neuron given its inputs.
 	// It computes the weighted sum of the inputs and bias,
 	// and then applies the tanH activation function if 'nonlin' is true.
@@ -330,6 +506,22 @@ public:
 		return nonlin ? activation->tanH() : activation;
 	}
 
+	// The same computation on lane vectors, evaluating LaneNode<T>::Width samples at once.
+	// The weights and bias enter the graph as mirrored parameters, so the graph can be kept
+	// and re-run with forward() after the weights are updated.
+	template <typename T>
+	std::shared_ptr<LaneNode<T>> operator() (const std::vector<std::shared_ptr<LaneNode<T>>>& inputs)
+	{
+		assert(inputs.size() == weights.size());
+
+		std::shared_ptr<LaneNode<T>> activation = LaneNode<T>::FromParameter(bias);
+		for (size_t i = 0; i < weights.size(); ++i)
+		{
+			activation = *activation + (*LaneNode<T>::FromParameter(weights[i]) * inputs[i]);
+		}
+		return nonlin ? activation->tanH() : activation;
+	}
+
 	// The 'parameters' member function returns a vector containing all the parameters (weights and bias) of the neuron.
 	std::vector<ValuePtr> parameters() override
 	{
@@ -337,6 +529,10 @@ public:
 		params.push_back(bias);
 		return params;
 	}
+
+	const std::vector<ValuePtr>& getWeights() const { return weights; }
+	const ValuePtr& getBias() const { return bias; }
+	bool isNonlinear() const { return nonlin; }
 };
 
 // The Layer class represents a layer in a neural network. It is a subclass of the Module class.
@@ -359,6 +555,40 @@ public:
 		}
 	}
 
+	// Initializes the weights for the scheme from stream kernels::weightStream(id) of the key
+	// splitMix64(seed), on the pool: the matrix is filled by kernels::initWeightsParallel and
+	// each task creates the weight nodes of a range of neurons. The weights do not depend on
+	// the pool size, and match a DenseLayer or TensorLayer with the same seed and index id.
+	Layer(int neuronsIn, int neuronsOut, uint32_t id, WeightInit scheme, uint64_t seed, BS::thread_pool& pool)
+	{
+		this->id = id;
+		const size_t in = neuronsIn, out = neuronsOut;
+		std::vector<double> W(out * in);
+		kernels::initWeightsParallel<double>(pool, scheme, out, in, W.data(), in, splitMix64(seed), kernels::weightStream(id));
+
+		std::vector<std::vector<ValuePtr>> nodes(out);
+		if (out)
+		{
+			pool.parallelize_loop(size_t(0), out, [&](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; ++i)
+				{
+					nodes[i].reserve(in);
+					for (size_t j = 0; j < in; ++j)
+					{
+						nodes[i].push_back(ExprNode::Create(W[i * in + j]));
+					}
+				}
+			}).wait();
+		}
+
+		neurons.reserve(out);
+		for (auto& w : nodes)
+		{
+			neurons.emplace_back(std::move(w));
+		}
+	}
+
 	// The function call operator is overloaded to compute the output of the layer given its inputs.
 	// It applies each neuron in the layer to the input, and collects the results into a vector.
 	std::vector<ValuePtr> operator() (const std::vector<ValuePtr>& inputs)
@@ -374,6 +604,65 @@ public:
 
 	}
 
+	// Batched forward pass for an N x in block of inputs, producing N x out.
+	// The neurons' weights and biases are gathered into a matrix and a vector for a single
+	// fused dense node (a GEMM instead of N * out dot products). Their backward scatters the
+	// batch gradient into the weight and bias ExprNodes, so parameters() and the usual
+	// update rules work unchanged after loss->backward() on the Tensor graph.
+	TensorPtr operator() (const TensorPtr& X)
+	{
+		const size_t out = neurons.size();
+		const size_t in = out ? neurons[0].getWeights().size() : 0;
+		auto weights = std::make_shared<std::vector<ValuePtr>>();
+		auto biases = std::make_shared<std::vector<ValuePtr>>();
+		weights->reserve(out * in);
+		biases->reserve(out);
+
+		TensorPtr W = Tensor::Create({ out, in });
+		TensorPtr b = Tensor::Create({ out });
+		for (size_t i = 0; i < out; ++i)
+		{
+			const auto& w = neurons[i].getWeights();
+			for (size_t j = 0; j < in; ++j)
+			{
+				W->at(i, j) = w[j]->get_val();
+				weights->push_back(w[j]);
+			}
+			b->at(i) = neurons[i].getBias()->get_val();
+			biases->push_back(neurons[i].getBias());
+		}
+
+		auto scatter = [](Tensor* t, const std::shared_ptr<std::vector<ValuePtr>>& nodes)
+		{
+			return [t, nodes]()
+			{
+				const double* g = t->grad();
+				for (size_t k = 0; k < nodes->size(); ++k)
+				{
+					(*nodes)[k]->set_grad((*nodes)[k]->get_grad() + g[k]);
+				}
+			};
+		};
+		W->set_backward(scatter(W.get(), weights));
+		b->set_backward(scatter(b.get(), biases));
+
+		const Activation act = (out && neurons[0].isNonlinear()) ? Activation::TanH : Activation::None;
+		return Tensor::dense(X, W, b, act);
+	}
+
+	// Lane-vector forward pass (see Neuron)
+	template <typename T>
+	std::vector<std::shared_ptr<LaneNode<T>>> operator() (const std::vector<std::shared_ptr<LaneNode<T>>>& inputs)
+	{
+		std::vector<std::shared_ptr<LaneNode<T>>> out;
+		out.reserve(neurons.size());
+		for (auto& n : neurons)
+		{
+			out.push_back(n(inputs));
+		}
+		return out;
+	}
+
 	int size() const {
 		return neurons.size();
 	}
@@ -419,6 +708,22 @@ public:
 		}
 	}
 
+	// Initializes the weights for the scheme from the seed instead of generateRandomDouble(),
+	// filling and building each layer in parallel on the network's thread pool. Layer i reads
+	// stream kernels::weightStream(i) of the key splitMix64(seed), so a seed gives bitwise
+	// identical weights for any number of threads.
+	MLP(int inputNeuronCount, std::vector<int> neuronsPerLayer, WeightInit scheme, uint64_t seed, bool multiThreaded = true)
+	{
+		this->multiThreaded = multiThreaded;
+
+		int sz_in = inputNeuronCount;
+		for (size_t i = 0; i < neuronsPerLayer.size(); ++i)
+		{
+			layers.push_back(Layer(sz_in, neuronsPerLayer[i], layers.size(), scheme, seed, pool));
+			sz_in = neuronsPerLayer[i];
+		}
+	}
+
 	std::vector<ValuePtr> operator() (const std::vector<ValuePtr>& inputs)
 	{
 		if (multiThreaded)
@@ -462,6 +767,36 @@ public:
 		}
 	}
 
+	// Batched forward pass: X is an N x inputs block with one sample per row, and the
+	// result is N x outputs. Each layer runs as one GEMM over the whole batch, so a training
+	// step is a single forward, a batched loss such as Tensor::mseLoss, one backward and
+	// one update of parameters().
+	TensorPtr operator() (const TensorPtr& X)
+	{
+		TensorPtr out = X;
+		for (auto& layer : layers)
+		{
+			out = layer(out);
+		}
+		return out;
+	}
+
+	// Lane-vector forward pass: builds a graph that evaluates LaneNode<T>::Width samples in
+	// lockstep. Build it once, then per step set the input lanes, call forward() and
+	// backward() on the loss, and update parameters() as usual.
+	template <typename T>
+	std::vector<std::shared_ptr<LaneNode<T>>> operator() (const std::vector<std::shared_ptr<LaneNode<T>>>& inputs)
+	{
+		std::vector<std::shared_ptr<LaneNode<T>>> out = inputs;
+		for (auto& layer : layers)
+		{
+			out = layer(out);
+		}
+		return out;
+	}
+
+	std::vector<Layer>& getLayers() { return layers; }
+
 	// The 'parameters' member function returns a vector containing all the parameters (weights and biases)
 	// of the neurons in the network. It does this by concatenating the parameters from each layer.
 	std::vector<ValuePtr> parameters() override
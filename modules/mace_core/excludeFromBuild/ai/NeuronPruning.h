@@ -0,0 +1,150 @@
+#pragma once
+
+// Structured pruning: whole hidden neurons are removed and the network is repacked into a
+// smaller dense MLP, which runs faster on every kernel without any sparse bookkeeping.
+//
+// A neuron is unimportant when its output barely varies over a sample set (a dead or
+// saturated tanh) or when the next layer barely listens to it (near-zero outgoing weights).
+// Both are captured by one score: if the neuron's output h is replaced by its mean over the
+// samples, the next layer's pre-activation vector changes by (h - mean) * w, where w is
+// the neuron's column of outgoing weights, whose RMS over the samples is
+//
+//     importance = stddev(h) * ||w||
+//
+// The replacement is exact for the mean, so removing a neuron folds mean * w into the next
+// layer's biases and the remaining error is bounded by the importance. tanh is 1-Lipschitz,
+// so the change propagated to the outputs is at most the sum of the removed importances
+// scaled by the norms of the later layers.
+
+struct NeuronImportance
+{
+	// Indexed [layer][neuron] for every layer but the last, whose neurons are the outputs
+	std::vector<std::vector<double>> mean;       // mean output over the samples
+	std::vector<std::vector<double>> importance; // stddev(output) * ||outgoing weights||
+};
+
+// Runs the samples through the network and scores every hidden neuron
+inline NeuronImportance neuronImportance(MLP& mlp, const std::vector<std::vector<double>>& samples)
+{
+	NeuronImportance result;
+	auto& layers = mlp.getLayers();
+	const size_t N = samples.size();
+	if (layers.empty() || N == 0) return result;
+
+	size_t in = layers.front().getNeurons().empty() ? 0 : layers.front().getNeurons()[0].getWeights().size();
+	std::vector<double> x(N * in);
+	for (size_t n = 0; n < N; ++n)
+	{
+		assert(samples[n].size() == in);
+		std::copy(samples[n].begin(), samples[n].end(), x.begin() + n * in);
+	}
+
+	for (size_t l = 0; l + 1 < layers.size(); ++l)
+	{
+		auto& neurons = layers[l].getNeurons();
+		const size_t out = neurons.size();
+		std::vector<double> W(out * in), b(out), y(N * out);
+		for (size_t i = 0; i < out; ++i)
+		{
+			const auto& w = neurons[i].getWeights();
+			for (size_t j = 0; j < in; ++j) W[i * in + j] = w[j]->get_val();
+			b[i] = neurons[i].getBias()->get_val();
+		}
+		const Activation act = (out && neurons[0].isNonlinear()) ? Activation::TanH : Activation::None;
+		kernels::denseForward<double>(N, in, out, act, x.data(), in, W.data(), in, b.data(), y.data(), out);
+
+		// Squared norm of each neuron's column in the next layer
+		std::vector<double> norm2(out, 0.0);
+		for (Neuron& next : layers[l + 1].getNeurons())
+		{
+			const auto& w = next.getWeights();
+			for (size_t j = 0; j < out; ++j) norm2[j] += w[j]->get_val() * w[j]->get_val();
+		}
+
+		std::vector<double> mean(out, 0.0), importance(out, 0.0);
+		for (size_t n = 0; n < N; ++n)
+		{
+			for (size_t j = 0; j < out; ++j) mean[j] += y[n * out + j] / N;
+		}
+		for (size_t n = 0; n < N; ++n)
+		{
+			for (size_t j = 0; j < out; ++j)
+			{
+				const double d = y[n * out + j] - mean[j];
+				importance[j] += d * d / N;
+			}
+		}
+		for (size_t j = 0; j < out; ++j) importance[j] = std::sqrt(importance[j] * norm2[j]);
+
+		result.mean.push_back(std::move(mean));
+		result.importance.push_back(std::move(importance));
+		x = std::move(y);
+		in = out;
+	}
+	return result;
+}
+
+// Returns a copy of the network without the hidden neurons whose importance over the samples
+// is at most tolerance. Their mean contribution is folded into the next layer's biases, and
+// every layer keeps at least its most important neuron. The original network is not modified.
+inline std::unique_ptr<MLP> pruneNeurons(MLP& mlp, const std::vector<std::vector<double>>& samples, double tolerance, bool multiThreaded = true)
+{
+	auto& layers = mlp.getLayers();
+	if (layers.empty()) return std::make_unique<MLP>(0, std::vector<int>{}, multiThreaded);
+
+	const NeuronImportance scores = neuronImportance(mlp, samples);
+
+	// The neurons kept in each layer; all outputs are kept
+	std::vector<std::vector<size_t>> keep(layers.size());
+	for (size_t l = 0; l < layers.size(); ++l)
+	{
+		const size_t out = layers[l].getNeurons().size();
+		for (size_t j = 0; j < out; ++j)
+		{
+			if (l >= scores.importance.size() || scores.importance[l][j] > tolerance) keep[l].push_back(j);
+		}
+		if (keep[l].empty() && out > 0)
+		{
+			const auto& s = scores.importance[l];
+			keep[l].push_back(static_cast<size_t>(std::max_element(s.begin(), s.end()) - s.begin()));
+		}
+	}
+
+	const size_t inputs = layers.front().getNeurons().empty() ? 0 : layers.front().getNeurons()[0].getWeights().size();
+	std::vector<int> sizes;
+	for (const auto& k : keep) sizes.push_back(static_cast<int>(k.size()));
+	// Every weight is overwritten below; the seeded constructor leaves the
+	// generateRandomDouble() stream alone, so pruning does not shift later initialization
+	auto pruned = std::make_unique<MLP>(static_cast<int>(inputs), sizes, WeightInit::Uniform, 0, multiThreaded);
+
+	for (size_t l = 0; l < layers.size(); ++l)
+	{
+		auto& source = layers[l].getNeurons();
+		auto& target = pruned->getLayers()[l].getNeurons();
+		const size_t in = source.empty() ? 0 : source[0].getWeights().size();
+
+		// Inputs from the previous layer that survive, and which were removed
+		std::vector<bool> kept(in, l == 0);
+		if (l > 0)
+		{
+			for (size_t j : keep[l - 1]) kept[j] = true;
+		}
+
+		for (size_t i = 0; i < keep[l].size(); ++i)
+		{
+			const Neuron& from = source[keep[l][i]];
+			const Neuron& to = target[i];
+			const auto& w = from.getWeights();
+
+			double bias = from.getBias()->get_val();
+			size_t t = 0;
+			for (size_t j = 0; j < in; ++j)
+			{
+				if (kept[j]) to.getWeights()[t++]->set_val(w[j]->get_val());
+				else bias += w[j]->get_val() * scores.mean[l - 1][j];
+			}
+			to.getBias()->set_val(bias);
+		}
+	}
+	return pruned;
+}
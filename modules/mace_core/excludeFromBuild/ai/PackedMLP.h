@@ -0,0 +1,113 @@
+#pragma once
+
+// A trained MLP exported to a compact inference format, with the weights of each layer
+// stored as one row-major matrix of T: double, float, or one of the 16-bit formats
+// kernels::bf16 and kernels::fp16.
+//
+// Wide layers at small batch sizes are bound by how fast the weights stream from memory,
+// so halving the bytes per weight roughly halves the latency. The 16-bit formats are
+// widened on the fly and accumulate in float; float and double run the regular dense
+// kernels in their own precision. Biases and activations are kept in the compute precision.
+// Like QuantizedMLP, the export is a snapshot of the weights at construction time.
+template <typename T>
+class PackedMLP
+{
+public:
+	// double weights compute in double, everything else in float
+	using Compute = std::conditional_t<std::is_same_v<T, double>, double, float>;
+
+	PackedMLP(MLP& mlp)
+	{
+		for (Layer& layer : mlp.getLayers())
+		{
+			auto& neurons = layer.getNeurons();
+			PackedLayer p;
+			p.out = neurons.size();
+			p.in = p.out ? neurons[0].getWeights().size() : 0;
+			p.ld = (p.in + 31) & ~size_t(31); // rows start on 64-byte boundaries for every T
+			p.act = (p.out && neurons[0].isNonlinear()) ? Activation::TanH : Activation::None;
+			p.W.resize(p.out * p.ld);
+			p.b.resize(p.out);
+
+			std::vector<float> row(p.in);
+			for (size_t i = 0; i < p.out; ++i)
+			{
+				const auto& w = neurons[i].getWeights();
+				if constexpr (std::is_same_v<T, double> || std::is_same_v<T, float>)
+				{
+					for (size_t j = 0; j < p.in; ++j) p.W[i * p.ld + j] = static_cast<T>(w[j]->get_val());
+				}
+				else
+				{
+					for (size_t j = 0; j < p.in; ++j) row[j] = static_cast<float>(w[j]->get_val());
+					kernels::convert(p.in, row.data(), p.W.data() + i * p.ld);
+				}
+				p.b[i] = static_cast<Compute>(neurons[i].getBias()->get_val());
+			}
+			layers.push_back(std::move(p));
+		}
+	}
+
+	// Prediction for one sample
+	std::vector<double> operator() (const std::vector<double>& x) const
+	{
+		assert(x.size() == inputs());
+		std::vector<double> y(outputs());
+		forward(x.data(), 1, y.data());
+		return y;
+	}
+
+	// Predictions for N samples: X is N x inputs() and Y is N x outputs(), both row-major
+	void forward(const double* X, size_t N, double* Y) const
+	{
+		if (layers.empty()) return;
+
+		thread_local AlignedVector<Compute> a;
+		thread_local AlignedVector<Compute> y;
+		a.assign(X, X + N * inputs());
+
+		for (const PackedLayer& L : layers)
+		{
+			y.resize(N * L.out);
+			if constexpr (std::is_same_v<T, Compute>)
+			{
+				kernels::denseForward<Compute>(N, L.in, L.out, L.act, a.data(), L.in, L.W.data(), L.ld, L.b.data(), y.data(), L.out);
+			}
+			else
+			{
+				kernels::denseForwardHalf<T>(N, L.in, L.out, L.act, a.data(), L.in, L.W.data(), L.ld, L.b.data(), y.data(), L.out);
+			}
+			std::swap(a, y);
+		}
+		std::copy(a.begin(), a.begin() + N * outputs(), Y);
+	}
+
+	size_t inputs() const { return layers.empty() ? 0 : layers.front().in; }
+	size_t outputs() const { return layers.empty() ? 0 : layers.back().out; }
+
+	// Bytes of weights and biases one forward pass reads; every weight is read once per
+	// pass regardless of the batch size
+	size_t weightBytes() const
+	{
+		size_t bytes = 0;
+		for (const PackedLayer& L : layers) bytes += L.out * L.in * sizeof(T) + L.out * sizeof(Compute);
+		return bytes;
+	}
+
+private:
+	struct PackedLayer
+	{
+		size_t in = 0;
+		size_t out = 0;
+		size_t ld = 0;
+		Activation act = Activation::TanH;
+
+		AlignedVector<T> W;
+		AlignedVector<Compute> b;
+	};
+
+	std::vector<PackedLayer> layers;
+};
+
+using Bf16MLP = PackedMLP<kernels::bf16>;
+using Fp16MLP = PackedMLP<kernels::fp16>;
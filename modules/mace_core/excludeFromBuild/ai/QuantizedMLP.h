@@ -0,0 +1,178 @@
+#pragma once
+
+// Post-training int8 quantization of a trained MLP, for serving predictions.
+//
+// The weights are quantized per output channel: each neuron's row gets its own scale,
+// max |w| / 127. The activations entering each layer share one scale per layer, calibrated
+// from a sample set: the samples are run through the network in double precision and the
+// scale is max |x| / 127 over all of them. Inputs outside the calibrated range saturate.
+//
+// Each layer then runs as: quantize the input, int8 x int8 GEMM with int32 accumulation
+// (kernels::gemmS8), rescale by inputScale * weightScale in float, add the bias and apply
+// the activation. The engine is a snapshot of the weights at construction time.
+class QuantizedMLP
+{
+public:
+	QuantizedMLP(MLP& mlp, const std::vector<std::vector<double>>& calibration)
+	{
+		// Double-precision copies of the weights, used for calibration
+		std::vector<std::vector<double>> weights;
+		std::vector<std::vector<double>> biases;
+
+		for (Layer& layer : mlp.getLayers())
+		{
+			auto& neurons = layer.getNeurons();
+			QuantizedLayer q;
+			q.out = neurons.size();
+			q.in = q.out ? neurons[0].getWeights().size() : 0;
+			if (q.in > kernels::Int8MaxDepth)
+			{
+				throw std::invalid_argument("QuantizedMLP: a layer has more inputs than the int32 accumulators of kernels::gemmS8 allow");
+			}
+			q.ld = (q.in + 63) & ~size_t(63);
+			q.act = (q.out && neurons[0].isNonlinear()) ? Activation::TanH : Activation::None;
+			q.W.assign(q.out * q.ld, 0);
+			q.rowSums.assign(q.out, 0);
+			q.scale.assign(q.out, 0.0f);
+			q.bias.assign(q.out, 0.0f);
+
+			std::vector<double> w(q.out * q.in);
+			std::vector<double> b(q.out);
+			for (size_t i = 0; i < q.out; ++i)
+			{
+				const auto& nw = neurons[i].getWeights();
+				double maxAbs = 0.0;
+				for (size_t j = 0; j < q.in; ++j)
+				{
+					w[i * q.in + j] = nw[j]->get_val();
+					maxAbs = std::max(maxAbs, std::abs(w[i * q.in + j]));
+				}
+				b[i] = neurons[i].getBias()->get_val();
+
+				const double scale = maxAbs / 127.0;
+				kernels::quantizeS8<double>(q.in, w.data() + i * q.in, scale, q.W.data() + i * q.ld);
+				q.scale[i] = static_cast<float>(scale);
+				q.bias[i] = static_cast<float>(b[i]);
+			}
+			kernels::rowSumsS8(q.out, q.in, q.W.data(), q.ld, q.rowSums.data());
+
+			layers.push_back(std::move(q));
+			weights.push_back(std::move(w));
+			biases.push_back(std::move(b));
+		}
+
+		calibrate(calibration, weights, biases);
+	}
+
+	// Prediction for one sample
+	std::vector<double> operator() (const std::vector<double>& x) const
+	{
+		assert(x.size() == inputs());
+		std::vector<double> y(outputs());
+		forward(x.data(), 1, y.data());
+		return y;
+	}
+
+	// Predictions for N samples: X is N x inputs() and Y is N x outputs(), both row-major
+	void forward(const double* X, size_t N, double* Y) const
+	{
+		if (layers.empty()) return;
+
+		// Samples are processed in blocks so the scratch buffers stay small
+		constexpr size_t Block = 256;
+		thread_local AlignedVector<float> a;
+		thread_local AlignedVector<int8_t> q;
+		thread_local AlignedVector<int32_t> acc;
+
+		for (size_t n0 = 0; n0 < N; n0 += Block)
+		{
+			const size_t nb = std::min(Block, N - n0);
+			const size_t in0 = layers.front().in;
+			a.resize(nb * in0);
+			for (size_t k = 0; k < nb * in0; ++k) a[k] = static_cast<float>(X[n0 * in0 + k]);
+
+			for (const QuantizedLayer& L : layers)
+			{
+				// The padding between rows stays zero, so it adds nothing to the dot products
+				q.assign(nb * L.ld, 0);
+				for (size_t n = 0; n < nb; ++n)
+				{
+					kernels::quantizeS8(L.in, a.data() + n * L.in, L.inputScale, q.data() + n * L.ld);
+				}
+
+				acc.resize(nb * L.out);
+				kernels::gemmS8(nb, L.out, L.in, q.data(), L.ld, L.W.data(), L.ld, L.rowSums.data(), acc.data(), L.out);
+
+				a.resize(nb * L.out);
+				for (size_t n = 0; n < nb; ++n)
+				{
+					float* y = a.data() + n * L.out;
+					const int32_t* s = acc.data() + n * L.out;
+					for (size_t i = 0; i < L.out; ++i)
+					{
+						y[i] = static_cast<float>(s[i]) * (L.inputScale * L.scale[i]) + L.bias[i];
+					}
+					kernels::applyActivation(L.act, y, L.out);
+				}
+			}
+
+			const size_t out = layers.back().out;
+			for (size_t k = 0; k < nb * out; ++k) Y[n0 * out + k] = a[k];
+		}
+	}
+
+	size_t inputs() const { return layers.empty() ? 0 : layers.front().in; }
+	size_t outputs() const { return layers.empty() ? 0 : layers.back().out; }
+
+	// The calibrated scale of each layer's input
+	std::vector<float> inputScales() const
+	{
+		std::vector<float> scales;
+		for (const QuantizedLayer& L : layers) scales.push_back(L.inputScale);
+		return scales;
+	}
+
+private:
+	struct QuantizedLayer
+	{
+		size_t in = 0;
+		size_t out = 0;
+		size_t ld = 0; // row stride in bytes, a multiple of 64
+		Activation act = Activation::TanH;
+		float inputScale = 1.0f;
+
+		AlignedVector<int8_t> W;
+		AlignedVector<int32_t> rowSums;
+		AlignedVector<float> scale; // per output channel
+		AlignedVector<float> bias;
+	};
+
+	std::vector<QuantizedLayer> layers;
+
+	// Runs the calibration samples through the double-precision layers and records the
+	// largest magnitude entering each layer
+	void calibrate(const std::vector<std::vector<double>>& samples, const std::vector<std::vector<double>>& weights, const std::vector<std::vector<double>>& biases)
+	{
+		const size_t N = samples.size();
+		if (N == 0 || layers.empty()) return;
+
+		std::vector<double> x(N * layers.front().in);
+		for (size_t n = 0; n < N; ++n)
+		{
+			assert(samples[n].size() == layers.front().in);
+			std::copy(samples[n].begin(), samples[n].end(), x.begin() + n * layers.front().in);
+		}
+
+		for (size_t l = 0; l < layers.size(); ++l)
+		{
+			QuantizedLayer& L = layers[l];
+			double maxAbs = 0.0;
+			for (double v : x) maxAbs = std::max(maxAbs, std::abs(v));
+			L.inputScale = maxAbs > 0.0 ? static_cast<float>(maxAbs / 127.0) : 1.0f;
+
+			std::vector<double> y(N * L.out);
+			kernels::denseForward<double>(N, L.in, L.out, L.act, x.data(), L.in, weights[l].data(), L.in, biases[l].data(), y.data(), L.out);
+			x = std::move(y);
+		}
+	}
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+// Recurrent layers built on the fused kernels in kernels/Recurrent.h. Each call runs a whole
+// window of timesteps as one Tensor node, instead of a graph of gates per step.
+//
+// Long sequences are trained with truncated backpropagation through time: feed the sequence
+// one window at a time (at most window() steps each), with a loss, backward and update per
+// window. The layer carries its hidden state from one window to the next, but gradients
+// stop at the window boundary, so a window's node keeps only that window's activations and
+// they are freed when its graph goes away. resetState() starts a new sequence.
+//
+// Inputs are time-major Tensors of shape steps x N x inputs; outputs are steps x N x hidden.
+
+// Shared state handling of LSTM and GRU
+class RecurrentLayer : public Module
+{
+public:
+	size_t inputs() const { return in; }
+	size_t hidden() const { return H; }
+	size_t window() const { return windowLength; }
+
+	// Forgets the carried state; the next window starts from zeros
+	void resetState()
+	{
+		h.clear();
+		c.clear();
+	}
+
+	// The hidden state after the last window, N x hidden
+	const AlignedVector<double>& state() const { return h; }
+
+protected:
+	size_t in = 0;
+	size_t H = 0;
+	size_t windowLength = 0;
+
+	AlignedVector<double> h; // carried hidden state
+	AlignedVector<double> c; // carried cell state (LSTM only)
+
+	RecurrentLayer(size_t inputs, size_t hidden, size_t window) :
+		in(inputs), H(hidden), windowLength(window) {}
+
+	// Checks the window's shape and makes sure the carried state matches its batch size
+	void prepare(const TensorPtr& x, const char* name, bool cell)
+	{
+		if (x->dim() != 3 || x->size(2) != in)
+		{
+			throw std::invalid_argument(std::string(name) + ": input must be steps x N x inputs");
+		}
+		if (x->size(0) > windowLength)
+		{
+			throw std::invalid_argument(std::string(name) + ": more steps than the truncation window");
+		}
+		const size_t N = x->size(1);
+		if (h.size() != N * H) h.assign(N * H, 0.0);
+		if (cell && c.size() != N * H) c.assign(N * H, 0.0);
+	}
+};
+
+// Long short-term memory layer
+class LSTM : public RecurrentLayer
+{
+private:
+	TensorPtr Wx; // 4H x inputs, gate order i, f, g, o
+	TensorPtr Wh; // 4H x hidden
+	TensorPtr b;  // 4H
+
+public:
+	// The weights are initialized from generateRandomDouble() scaled by 1 / sqrt(hidden),
+	// the biases to 0 except the forget gate's, which start at 1 so early training remembers.
+	LSTM(size_t inputs, size_t hidden, size_t window) :
+		RecurrentLayer(inputs, hidden, window)
+	{
+		const double scale = 1.0 / std::sqrt(static_cast<double>(hidden));
+		Wx = Tensor::Random({ 4 * hidden, inputs });
+		Wh = Tensor::Random({ 4 * hidden, hidden });
+		for (size_t i = 0; i < Wx->numel(); ++i) Wx->data()[i] *= scale;
+		for (size_t i = 0; i < Wh->numel(); ++i) Wh->data()[i] *= scale;
+		b = Tensor::Create({ 4 * hidden });
+		std::fill(b->data() + hidden, b->data() + 2 * hidden, 1.0);
+	}
+
+	// Runs the next window of the sequence, steps x N x inputs, from the carried state
+	TensorPtr operator() (const TensorPtr& x)
+	{
+		prepare(x, "LSTM", true);
+		const size_t steps = x->size(0), N = x->size(1);
+
+		// Everything backward needs for the window; the initial state is a constant
+		struct Saved
+		{
+			AlignedVector<double> h0, c0, gates, C;
+		};
+		auto saved = std::make_shared<Saved>();
+		saved->h0 = h;
+		saved->c0 = c;
+		saved->gates.resize(steps * N * 4 * H);
+		saved->C.resize(steps * N * H);
+
+		TensorPtr xc = x->contiguous();
+		TensorPtr out = Tensor::Create({ steps, N, H }, { xc, Wx, Wh, b }, "LSTM");
+		kernels::lstmForward<double>(steps, N, in, H, xc->data(), Wx->data(), Wh->data(), b->data(),
+			saved->h0.data(), saved->c0.data(), out->data(), saved->gates.data(), saved->C.data());
+
+		if (steps > 0)
+		{
+			std::copy(out->data() + (steps - 1) * N * H, out->data() + steps * N * H, h.begin());
+			std::copy(saved->C.end() - N * H, saved->C.end(), c.begin());
+		}
+
+		out->set_backward([xc, Wx = Wx, Wh = Wh, b = b, out = out.get(), saved, steps, N, in = in, H = H]()
+		{
+			kernels::lstmBackward<double>(steps, N, in, H, xc->data(), Wx->data(), Wh->data(),
+				saved->h0.data(), saved->c0.data(), out->data(), saved->gates.data(), saved->C.data(), out->grad(),
+				Wx->grad(), Wh->grad(), b->grad(), xc->requires_grad() ? xc->grad() : nullptr);
+		});
+		return out;
+	}
+
+	std::vector<TensorPtr> tensor_parameters() override
+	{
+		return { Wx, Wh, b };
+	}
+};
+
+// Gated recurrent unit layer
+class GRU : public RecurrentLayer
+{
+private:
+	TensorPtr Wx; // 3H x inputs, gate order r, z, n
+	TensorPtr Wh; // 3H x hidden
+	TensorPtr bx; // 3H
+	TensorPtr bh; // 3H
+
+public:
+	// The weights are initialized from generateRandomDouble() scaled by 1 / sqrt(hidden)
+	// and the biases to 0
+	GRU(size_t inputs, size_t hidden, size_t window) :
+		RecurrentLayer(inputs, hidden, window)
+	{
+		const double scale = 1.0 / std::sqrt(static_cast<double>(hidden));
+		Wx = Tensor::Random({ 3 * hidden, inputs });
+		Wh = Tensor::Random({ 3 * hidden, hidden });
+		for (size_t i = 0; i < Wx->numel(); ++i) Wx->data()[i] *= scale;
+		for (size_t i = 0; i < Wh->numel(); ++i) Wh->data()[i] *= scale;
+		bx = Tensor::Create({ 3 * hidden });
+		bh = Tensor::Create({ 3 * hidden });
+	}
+
+	// Runs the next window of the sequence, steps x N x inputs, from the carried state
+	TensorPtr operator() (const TensorPtr& x)
+	{
+		prepare(x, "GRU", false);
+		const size_t steps = x->size(0), N = x->size(1);
+
+		struct Saved
+		{
+			AlignedVector<double> h0, gates, hn;
+		};
+		auto saved = std::make_shared<Saved>();
+		saved->h0 = h;
+		saved->gates.resize(steps * N * 3 * H);
+		saved->hn.resize(steps * N * H);
+
+		TensorPtr xc = x->contiguous();
+		TensorPtr out = Tensor::Create({ steps, N, H }, { xc, Wx, Wh, bx, bh }, "GRU");
+		kernels::gruForward<double>(steps, N, in, H, xc->data(), Wx->data(), Wh->data(), bx->data(), bh->data(),
+			saved->h0.data(), out->data(), saved->gates.data(), saved->hn.data());
+
+		if (steps > 0)
+		{
+			std::copy(out->data() + (steps - 1) * N * H, out->data() + steps * N * H, h.begin());
+		}
+
+		out->set_backward([xc, Wx = Wx, Wh = Wh, bx = bx, bh = bh, out = out.get(), saved, steps, N, in = in, H = H]()
+		{
+			kernels::gruBackward<double>(steps, N, in, H, xc->data(), Wx->data(), Wh->data(), saved->h0.data(),
+				out->data(), saved->gates.data(), saved->hn.data(), out->grad(),
+				Wx->grad(), Wh->grad(), bx->grad(), bh->grad(), xc->requires_grad() ? xc->grad() : nullptr);
+		});
+		return out;
+	}
+
+	std::vector<TensorPtr> tensor_parameters() override
+	{
+		return { Wx, Wh, bx, bh };
+	}
+};
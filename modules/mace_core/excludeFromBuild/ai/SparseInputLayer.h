@@ -0,0 +1,247 @@
+#pragma once
+
+// The SparseInputLayer class is a first layer for high-dimensional, mostly-zero inputs such
+// as one-hot encoded features. A sample is a list of (index, value) pairs for its nonzero
+// inputs; the zeros are never materialized.
+//
+// The weights are stored transposed, one row per input column holding that column's weight
+// for every neuron, so an active input is one contiguous axpy into the outputs in forward and
+// one into its gradient row in backward. Only the rows of active columns are read or written.
+// Backward records which columns it touched, and sgd_step and zero_grad visit only those,
+// so a training step costs O(active inputs * neurons) however wide the input is.
+//
+// Like DenseLayer, the layer can stand in for the first Layer of a network: operator()
+// returns ExprNodes for a single sample, or an N x out Tensor for a batch, which the rest
+// of the network consumes as usual.
+
+// One nonzero input of a sparse sample
+struct SparseFeature
+{
+	uint32_t index = 0;
+	double value = 1.0;
+};
+
+using SparseSample = std::vector<SparseFeature>;
+
+class SparseInputLayer : public Module
+{
+public:
+	// The weights are initialized like Neuron's, with generateRandomDouble() in [-1, 1],
+	// neuron by neuron, and the biases are initialized to 0.
+	SparseInputLayer(int neuronsIn, int neuronsOut, Activation act = Activation::TanH) :
+		in(neuronsIn), out(neuronsOut), act(act)
+	{
+		allocate();
+		for (size_t i = 0; i < out; ++i)
+		{
+			for (size_t j = 0; j < in; ++j)
+			{
+				storage->W[j * ld + i] = generateRandomDouble();
+			}
+		}
+	}
+
+	// Copies the weights and biases of a scalar Layer, so both compute the same function
+	SparseInputLayer(Layer& layer)
+	{
+		auto& neurons = layer.getNeurons();
+		out = neurons.size();
+		in = out ? neurons[0].getWeights().size() : 0;
+		act = (out && neurons[0].isNonlinear()) ? Activation::TanH : Activation::None;
+		allocate();
+
+		for (size_t i = 0; i < out; ++i)
+		{
+			const auto& w = neurons[i].getWeights();
+			for (size_t j = 0; j < in; ++j)
+			{
+				storage->W[j * ld + i] = w[j]->get_val();
+			}
+			storage->b[i] = neurons[i].getBias()->get_val();
+		}
+	}
+
+	SparseInputLayer(const SparseInputLayer& other) :
+		Module(other), in(other.in), out(other.out), ld(other.ld), act(other.act),
+		storage(std::make_shared<Storage>(*other.storage))
+	{
+	}
+
+	SparseInputLayer& operator= (const SparseInputLayer& other)
+	{
+		if (this != &other)
+		{
+			Module::operator= (other);
+			in = other.in;
+			out = other.out;
+			ld = other.ld;
+			act = other.act;
+			storage = std::make_shared<Storage>(*other.storage);
+		}
+		return *this;
+	}
+
+	SparseInputLayer(SparseInputLayer&&) = default;
+	SparseInputLayer& operator= (SparseInputLayer&&) = default;
+
+	// Forward pass for one sample: y = act(b + sum over the active inputs of value * W column)
+	void forward(const SparseSample& x, double* y) const
+	{
+		std::copy(storage->b.begin(), storage->b.end(), y);
+		for (const SparseFeature& f : x)
+		{
+			assert(f.index < in);
+			kernels::axpy(out, f.value, storage->W.data() + f.index * ld, y);
+		}
+		kernels::applyActivation(act, y, out);
+	}
+
+	// Batched forward pass: Y is N x out, one row per sample
+	void forward(const std::vector<SparseSample>& X, double* Y) const
+	{
+		for (size_t n = 0; n < X.size(); ++n)
+		{
+			forward(X[n], Y + n * out);
+		}
+	}
+
+	// Batched backward pass for the output of forward(X, Y) and its gradient dY. Accumulates
+	// into the bias gradients and the gradient rows of the active columns only. The inputs
+	// are data, so there is no input gradient.
+	void backward(const std::vector<SparseSample>& X, const double* Y, const double* dY)
+	{
+		accumulate(*storage, out, ld, act, X, Y, dY);
+	}
+
+	// Computes the layer's outputs for one sample as ExprNodes, so the layer can feed a
+	// scalar graph. The outputs share one hub node whose backward runs the sparse backward.
+	std::vector<ValuePtr> operator() (const SparseSample& x)
+	{
+		auto sample = std::make_shared<std::vector<SparseSample>>(1, x);
+		auto y = std::make_shared<AlignedVector<double>>(out);
+		auto dy = std::make_shared<AlignedVector<double>>(out, 0.0);
+		forward(x, y->data());
+
+		ValuePtr hub = ExprNode::Create(0.0, {}, "SparseInput");
+		hub->set_backward([storage = storage, out = out, ld = ld, act = act, sample, y, dy]()
+		{
+			accumulate(*storage, out, ld, act, *sample, y->data(), dy->data());
+		});
+
+		std::vector<ValuePtr> outputs(out);
+		for (size_t i = 0; i < out; ++i)
+		{
+			ValuePtr o = ExprNode::Create((*y)[i], { hub }, "SparseInputOut");
+			o->set_backward([o = o.get(), dy, i]()
+			{
+				(*dy)[i] += o->get_grad();
+			});
+			outputs[i] = o;
+		}
+		return outputs;
+	}
+
+	// Forward pass for a batch, producing an N x out Tensor whose backward runs the sparse
+	// backward, so an MLP over the remaining layers can be trained on the result
+	TensorPtr operator() (const std::vector<SparseSample>& X)
+	{
+		auto samples = std::make_shared<std::vector<SparseSample>>(X);
+		TensorPtr y = Tensor::Create({ X.size(), out }, {}, "SparseInput");
+		forward(X, y->data());
+		y->set_backward([storage = storage, out = out, ld = ld, act = act, samples, y = y.get()]()
+		{
+			accumulate(*storage, out, ld, act, *samples, y->data(), y->grad());
+		});
+		return y;
+	}
+
+	size_t inputs() const { return in; }
+	size_t size() const { return out; }
+
+	// Weight of input j for neuron i, and its gradient
+	double& weight(size_t i, size_t j) { return storage->W[j * ld + i]; }
+	double weight_grad(size_t i, size_t j) const { return storage->gW[j * ld + i]; }
+	double* biases() { return storage->b.data(); }
+	double* bias_grads() { return storage->gb.data(); }
+
+	// Input columns with a nonzero gradient since the last zero_grad
+	const std::vector<uint32_t>& touched_columns() const { return storage->touchedColumns; }
+
+	void zero_grad() override
+	{
+		for (uint32_t j : storage->touchedColumns)
+		{
+			std::fill(storage->gW.begin() + j * ld, storage->gW.begin() + j * ld + out, 0.0);
+			storage->touched[j] = 0;
+		}
+		storage->touchedColumns.clear();
+		std::fill(storage->gb.begin(), storage->gb.end(), 0.0);
+	}
+
+	void sgd_step(double learningRate) override
+	{
+		for (uint32_t j : storage->touchedColumns)
+		{
+			kernels::axpy(out, -learningRate, storage->gW.data() + j * ld, storage->W.data() + j * ld);
+		}
+		for (size_t i = 0; i < out; ++i) storage->b[i] -= learningRate * storage->gb[i];
+	}
+
+private:
+	size_t in = 0;
+	size_t out = 0;
+	size_t ld = 0; // row stride in doubles, a multiple of 8 so rows stay 64-byte aligned
+	Activation act = Activation::TanH;
+
+	// Weights, gradients and the touched-column bookkeeping sit behind a shared_ptr so graph
+	// closures keep them alive without pointing at the layer, as in DenseLayer
+	struct Storage
+	{
+		AlignedVector<double> W;  // in x ld, row j holds input j's weight for every neuron
+		AlignedVector<double> b;
+		AlignedVector<double> gW;
+		AlignedVector<double> gb;
+
+		std::vector<uint8_t> touched; // per input column
+		std::vector<uint32_t> touchedColumns;
+	};
+	std::shared_ptr<Storage> storage = std::make_shared<Storage>();
+
+	// The sparse backward on a layer's storage, shared by backward() and the graph closures
+	static void accumulate(Storage& s, size_t out, size_t ld, Activation act,
+		const std::vector<SparseSample>& X, const double* Y, const double* dY)
+	{
+		thread_local AlignedVector<double> delta;
+		delta.resize(out);
+
+		for (size_t n = 0; n < X.size(); ++n)
+		{
+			const double* y = Y + n * out;
+			const double* dy = dY + n * out;
+			for (size_t i = 0; i < out; ++i)
+			{
+				delta[i] = dy[i] * kernels::activationDerivative(act, y[i]);
+				s.gb[i] += delta[i];
+			}
+			for (const SparseFeature& f : X[n])
+			{
+				if (!s.touched[f.index])
+				{
+					s.touched[f.index] = 1;
+					s.touchedColumns.push_back(f.index);
+				}
+				kernels::axpy(out, f.value, delta.data(), s.gW.data() + f.index * ld);
+			}
+		}
+	}
+
+	void allocate()
+	{
+		ld = (out + 7) & ~size_t(7);
+		storage->W.assign(in * ld, 0.0);
+		storage->gW.assign(in * ld, 0.0);
+		storage->b.assign(out, 0.0);
+		storage->gb.assign(out, 0.0);
+		storage->touched.assign(in, 0);
+	}
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+// Magnitude pruning of a trained MLP and a sparse (CSR) form of it for fast inference and
+// fine-tuning.
+//
+// magnitudePrune zeroes the weights with the smallest magnitudes, either over the whole
+// network at once (one global threshold) or separately in each layer. Biases are never
+// pruned. SparseMLP then snapshots the network, keeping only the nonzero weights, so the
+// cost of a forward or backward pass scales with the number of surviving weights.
+
+enum class PruneScope
+{
+	Global,   // one magnitude threshold over all the weights of the network
+	PerLayer  // the same fraction of weights removed from every layer
+};
+
+// Sets the given fraction of the MLP's weights to zero, smallest magnitudes first, and
+// returns how many weights were pruned. Weights that are already zero count towards the fraction.
+inline size_t magnitudePrune(MLP& mlp, double fraction, PruneScope scope = PruneScope::Global)
+{
+	fraction = std::clamp(fraction, 0.0, 1.0);
+
+	// Zeroes the smallest fraction of the given weights
+	auto prune = [fraction](std::vector<ValuePtr>& weights) -> size_t
+	{
+		const size_t count = static_cast<size_t>(fraction * weights.size());
+		if (count == 0) return 0;
+
+		std::nth_element(weights.begin(), weights.begin() + (count - 1), weights.end(),
+			[](const ValuePtr& a, const ValuePtr& b) { return std::abs(a->get_val()) < std::abs(b->get_val()); });
+		for (size_t i = 0; i < count; ++i)
+		{
+			weights[i]->set_val(0.0);
+		}
+		return count;
+	};
+
+	size_t pruned = 0;
+	std::vector<ValuePtr> weights;
+	for (Layer& layer : mlp.getLayers())
+	{
+		for (Neuron& neuron : layer.getNeurons())
+		{
+			const auto& w = neuron.getWeights();
+			weights.insert(weights.end(), w.begin(), w.end());
+		}
+		if (scope == PruneScope::PerLayer)
+		{
+			pruned += prune(weights);
+			weights.clear();
+		}
+	}
+	if (scope == PruneScope::Global)
+	{
+		pruned += prune(weights);
+	}
+	return pruned;
+}
+
+// One layer with its weight matrix in CSR form. Training updates only the stored weights,
+// so the sparsity pattern found by pruning is kept.
+class SparseLayer : public Module
+{
+public:
+	// Copies the weights and biases of a scalar Layer, dropping the weights that are zero
+	SparseLayer(Layer& layer)
+	{
+		auto& neurons = layer.getNeurons();
+		const size_t out = neurons.size();
+		const size_t in = out ? neurons[0].getWeights().size() : 0;
+		act = (out && neurons[0].isNonlinear()) ? Activation::TanH : Activation::None;
+
+		std::vector<double> dense(out * in);
+		b.assign(out, 0.0);
+		for (size_t i = 0; i < out; ++i)
+		{
+			const auto& w = neurons[i].getWeights();
+			for (size_t j = 0; j < in; ++j)
+			{
+				dense[i * in + j] = w[j]->get_val();
+			}
+			b[i] = neurons[i].getBias()->get_val();
+		}
+
+		W = kernels::toCsr(out, in, dense.data(), in);
+		gW.assign(W.nonZeros(), 0.0);
+		gb.assign(out, 0.0);
+	}
+
+	// Batched forward pass: Y (N x out) = act(X (N x in) * W^T + b)
+	void forward(const double* X, size_t N, double* Y) const
+	{
+		kernels::sparseForward<double>(N, act, W, X, W.cols, b.data(), Y, W.rows);
+	}
+
+	// Batched backward pass for the output of forward(X, N, Y) and its gradient dY.
+	// Accumulates into the weight and bias gradients and, if dX is not null, into dX.
+	void backward(const double* X, size_t N, const double* Y, const double* dY, double* dX)
+	{
+		kernels::sparseBackward<double>(N, act, W, X, W.cols, Y, dY, W.rows, gW.data(), gb.data(), dX);
+	}
+
+	size_t inputs() const { return W.cols; }
+	size_t size() const { return W.rows; }
+	size_t nonZeros() const { return W.nonZeros(); }
+	double density() const { return W.density(); }
+
+	const kernels::CsrMatrix<double>& weights() const { return W; }
+	double* biases() { return b.data(); }
+	double* weight_grads() { return gW.data(); } // one per stored weight, in CSR order
+	double* bias_grads() { return gb.data(); }
+
+	void zero_grad() override
+	{
+		std::fill(gW.begin(), gW.end(), 0.0);
+		std::fill(gb.begin(), gb.end(), 0.0);
+	}
+
+	void sgd_step(double learningRate) override
+	{
+		for (size_t k = 0; k < W.values.size(); ++k) W.values[k] -= learningRate * gW[k];
+		for (size_t i = 0; i < b.size(); ++i) b[i] -= learningRate * gb[i];
+	}
+
+private:
+	kernels::CsrMatrix<double> W;
+	AlignedVector<double> b;
+	AlignedVector<double> gW;
+	AlignedVector<double> gb;
+	Activation act = Activation::TanH;
+};
+
+// A pruned MLP as a stack of SparseLayers
+class SparseMLP : public Module
+{
+public:
+	SparseMLP(MLP& mlp)
+	{
+		for (Layer& layer : mlp.getLayers())
+		{
+			layers.emplace_back(layer);
+		}
+	}
+
+	// Prediction for one sample
+	std::vector<double> operator() (const std::vector<double>& x) const
+	{
+		assert(x.size() == inputs());
+		std::vector<double> y(outputs());
+		forward(x.data(), 1, y.data());
+		return y;
+	}
+
+	// Predictions for N samples: X is N x inputs() and Y is N x outputs(), both row-major
+	void forward(const double* X, size_t N, double* Y) const
+	{
+		if (layers.empty()) return;
+
+		thread_local AlignedVector<double> a;
+		thread_local AlignedVector<double> y;
+		a.assign(X, X + N * inputs());
+
+		for (const SparseLayer& L : layers)
+		{
+			y.resize(N * L.size());
+			L.forward(a.data(), N, y.data());
+			std::swap(a, y);
+		}
+		std::copy(a.begin(), a.begin() + N * outputs(), Y);
+	}
+
+	size_t inputs() const { return layers.empty() ? 0 : layers.front().inputs(); }
+	size_t outputs() const { return layers.empty() ? 0 : layers.back().size(); }
+
+	size_t nonZeros() const
+	{
+		size_t n = 0;
+		for (const SparseLayer& L : layers) n += L.nonZeros();
+		return n;
+	}
+
+	// Fraction of the weights that survived pruning
+	double density() const
+	{
+		size_t total = 0;
+		for (const SparseLayer& L : layers) total += L.inputs() * L.size();
+		return total ? static_cast<double>(nonZeros()) / total : 0.0;
+	}
+
+	std::vector<SparseLayer>& getLayers() { return layers; }
+
+	void zero_grad() override
+	{
+		for (SparseLayer& L : layers) L.zero_grad();
+	}
+
+	void sgd_step(double learningRate) override
+	{
+		for (SparseLayer& L : layers) L.sgd_step(learningRate);
+	}
+
+private:
+	std::vector<SparseLayer> layers;
+};
@@ -0,0 +1,953 @@
+#pragma once
+
+// Tensor-granularity autograd.
+// Where ExprNode builds one graph node per scalar, a Tensor node owns a whole
+// block of values, so an MxN dense layer is a single node instead of MxN
+// multiply nodes. The API mirrors ExprNode: tensors are created through factory
+// methods, every op records its children and a backward closure, and
+// backward() runs the closures in reverse topological order.
+//
+// Storage is contiguous, 64-byte aligned and shared between a tensor and its
+// views. Shapes are row-major with per-axis strides, so a transposed or
+// reshaped view never copies. Gradients are always stored contiguously in the
+// logical (row-major) order of the tensor's shape.
+//
+// Like ExprNode, every tensor created by a factory method requires a gradient
+// by default, so weights need no extra call. Inputs and targets that need no
+// gradient should call set_requires_grad(false) to skip their backward work.
+// Results of ops require a gradient exactly when one of their inputs does.
+
+using TensorPtr = std::shared_ptr<class Tensor>;
+using TensorBuffer = AlignedVector<double, 64>;
+
+class Tensor : public std::enable_shared_from_this<class Tensor>
+{
+public:
+	using Shape = std::vector<size_t>;
+	using Strides = std::vector<ptrdiff_t>;
+
+	// Factory method for a zero-filled contiguous tensor. A tensor without children is a
+	// leaf and requires a gradient until set_requires_grad(false) is called.
+	static TensorPtr Create(const Shape& shape, std::initializer_list<TensorPtr> children = {}, std::string op = "")
+	{
+		return link(std::make_shared<Tensor>(shape), children, op);
+	}
+
+	// Factory method for a tensor filled with a single value
+	static TensorPtr Full(const Shape& shape, double value)
+	{
+		TensorPtr t = Create(shape);
+		std::fill(t->data(), t->data() + t->numel(), value);
+		return t;
+	}
+
+	// Factory method copying row-major values into a new tensor
+	static TensorPtr FromData(const Shape& shape, const std::vector<double>& values)
+	{
+		TensorPtr t = Create(shape);
+		if (values.size() != t->numel())
+		{
+			throw std::invalid_argument("Tensor::FromData: value count does not match shape");
+		}
+		std::copy(values.begin(), values.end(), t->data());
+		return t;
+	}
+
+	// Factory method for a tensor filled from generateRandomDouble() in [-1, 1]
+	static TensorPtr Random(const Shape& shape)
+	{
+		TensorPtr t = Create(shape);
+		double* p = t->data();
+		for (size_t i = 0; i < t->numel(); ++i)
+		{
+			p[i] = generateRandomDouble();
+		}
+		return t;
+	}
+
+	// Factory method for a weight tensor initialized for the scheme on the pool, treating
+	// shape[0] as the outputs and the remaining axes as the inputs of each output (fanIn).
+	// The values are stream kernels::weightStream(index) of the key splitMix64(seed), so they
+	// match the MLP and DenseLayer initializations with the same seed and index.
+	static TensorPtr Initialized(const Shape& shape, WeightInit scheme, uint64_t seed, uint64_t index, BS::thread_pool& pool)
+	{
+		TensorPtr t = Create(shape);
+		const size_t rows = shape.empty() ? 1 : shape[0];
+		const size_t cols = rows ? t->numel() / rows : 0;
+		kernels::initWeightsParallel<double>(pool, scheme, rows, cols, t->data(), cols, splitMix64(seed), kernels::weightStream(index));
+		return t;
+	}
+
+	// Constructor allocating contiguous zero-filled storage
+	Tensor(const Shape& shape) :
+		_shape(shape)
+	{
+		_strides = contiguousStrides(shape);
+		storage = std::make_shared<TensorBuffer>(countElements(shape), 0.0);
+	}
+
+	// Constructor for a view: shares the storage of another tensor and allocates none
+	Tensor(const Shape& shape, const Strides& strides, std::shared_ptr<TensorBuffer> sharedStorage, size_t storageOffset) :
+		_shape(shape),
+		_strides(strides),
+		offset(storageOffset),
+		storage(std::move(sharedStorage))
+	{
+	}
+
+	// ---------------------------------------------------------------------------------
+	// Shape and storage
+	// ---------------------------------------------------------------------------------
+
+	const Shape& shape() const { return _shape; }
+	const Strides& strides() const { return _strides; }
+	size_t dim() const { return _shape.size(); }
+	size_t size(size_t axis) const { return _shape[axis]; }
+	size_t numel() const { return countElements(_shape); }
+
+	// Convenience accessors for 2D tensors
+	size_t rows() const { return _shape.size() > 1 ? _shape[_shape.size() - 2] : 1; }
+	size_t cols() const { return _shape.empty() ? 1 : _shape.back(); }
+
+	bool is_contiguous() const { return _strides == contiguousStrides(_shape); }
+
+	// Pointer to the first element. For non-contiguous views, index with strides().
+	double* data() { return storage->data() + offset; }
+	const double* data() const { return storage->data() + offset; }
+
+	// Element access for 1D and 2D tensors
+	double& at(size_t i) { return data()[i * _strides[0]]; }
+	double& at(size_t i, size_t j) { return data()[i * _strides[0] + j * _strides[1]]; }
+
+	// Value of a single-element tensor
+	double item() const { return *data(); }
+
+	// Gradient buffer, allocated (zero-filled) on first access
+	double* grad()
+	{
+		if (!gradData)
+		{
+			gradStorage = std::make_shared<TensorBuffer>(numel(), 0.0);
+			gradData = gradStorage->data();
+		}
+		return gradData;
+	}
+	bool has_grad() const { return gradData != nullptr; }
+
+	// Places the gradient at element 'start' of a shared buffer instead of in storage of its
+	// own, e.g. in a slab of MemoryPlanner. The region is not cleared.
+	void bind_grad(const std::shared_ptr<TensorBuffer>& buffer, size_t start)
+	{
+		gradStorage = buffer;
+		gradData = buffer->data() + start;
+	}
+
+	// Identity of the value storage, shared by a tensor and its views
+	const void* storage_id() const { return storage.get(); }
+
+	bool requires_grad() const { return requiresGrad; }
+	void set_requires_grad(bool state) { requiresGrad = state; }
+
+	// Copies the values out in row-major order
+	std::vector<double> to_vector() const
+	{
+		std::vector<double> out(numel());
+		gather(out.data());
+		return out;
+	}
+
+	// Copies the gradient out in row-major order
+	std::vector<double> grad_vector()
+	{
+		return std::vector<double>(grad(), grad() + numel());
+	}
+
+	// Copies the values in row-major order into a contiguous destination
+	void gather(double* dst) const
+	{
+		if (is_contiguous())
+		{
+			std::copy(data(), data() + numel(), dst);
+			return;
+		}
+		forEachOffset(_shape, _strides, [&](size_t i, ptrdiff_t off) { dst[i] = data()[off]; });
+	}
+
+	// ---------------------------------------------------------------------------------
+	// Views and layout
+	// ---------------------------------------------------------------------------------
+
+	// Transposed view of a 2D tensor sharing the same storage
+	TensorPtr transpose()
+	{
+		if (dim() != 2) throw std::invalid_argument("Tensor::transpose: tensor must be 2D");
+
+		TensorPtr out = makeView({ _shape[1], _shape[0] }, { _strides[1], _strides[0] }, "T");
+		size_t r = _shape[0], c = _shape[1];
+		TensorPtr self = shared_from_this();
+		out->set_backward([self, out = out.get(), r, c]()
+		{
+			double* g = self->grad();
+			const double* og = out->grad();
+			for (size_t i = 0; i < r; ++i)
+				for (size_t j = 0; j < c; ++j)
+					g[i * c + j] += og[j * r + i];
+		});
+		return out;
+	}
+
+	// Reshaped view of a contiguous tensor
+	TensorPtr reshape(const Shape& newShape)
+	{
+		if (countElements(newShape) != numel()) throw std::invalid_argument("Tensor::reshape: element count mismatch");
+		if (!is_contiguous()) return contiguous()->reshape(newShape);
+
+		TensorPtr out = makeView(newShape, contiguousStrides(newShape), "Reshape");
+		TensorPtr self = shared_from_this();
+		out->set_backward([self, out = out.get()]()
+		{
+			double* g = self->grad();
+			const double* og = out->grad();
+			for (size_t i = 0; i < self->numel(); ++i) g[i] += og[i];
+		});
+		return out;
+	}
+
+	// Contiguous copy of a strided view. Returns this tensor if it is already contiguous.
+	TensorPtr contiguous()
+	{
+		if (is_contiguous()) return shared_from_this();
+
+		TensorPtr self = shared_from_this();
+		TensorPtr out = Create(_shape, { self }, "Contiguous");
+		gather(out->data());
+		out->set_backward([self, out = out.get()]()
+		{
+			double* g = self->grad();
+			const double* og = out->grad();
+			for (size_t i = 0; i < self->numel(); ++i) g[i] += og[i];
+		});
+		return out;
+	}
+
+	// ---------------------------------------------------------------------------------
+	// Autograd
+	// ---------------------------------------------------------------------------------
+
+	// Assigns the closure that propagates this tensor's gradient to its children.
+	// Closures capture the output tensor by raw pointer; capturing its shared_ptr
+	// would make the tensor own itself and it would never be freed.
+	template <typename F>
+	void set_backward(F&& fn)
+	{
+		_backward = std::forward<F>(fn);
+	}
+
+	const std::string& get_op() const { return _op; }
+	const std::vector<TensorPtr>& get_prev() const { return _prev; }
+
+	// Sets the gradient to zero
+	void zero_grad()
+	{
+		if (gradData) std::fill(gradData, gradData + numel(), 0.0);
+	}
+
+	// Backward propagation. The gradient of this tensor is seeded with ones,
+	// which for a single-element loss is the usual dL/dL = 1.
+	void backward()
+	{
+		std::vector<Tensor*> topo = topological_order();
+
+		double* g = grad();
+		std::fill(g, g + numel(), 1.0);
+
+		for (auto it = topo.rbegin(); it != topo.rend(); ++it)
+		{
+			(*it)->propagate();
+		}
+	}
+
+	// The tensors this one depends on, itself included, each after all of its children
+	std::vector<Tensor*> topological_order()
+	{
+		std::vector<Tensor*> topo;
+		std::unordered_set<Tensor*> visited;
+
+		// Iterative post-order DFS so long graphs don't overflow the stack
+		std::vector<std::pair<Tensor*, size_t>> stack;
+		stack.push_back({ this, 0 });
+		visited.insert(this);
+		while (!stack.empty())
+		{
+			auto& [node, next] = stack.back();
+			if (next < node->_prev.size())
+			{
+				Tensor* child = node->_prev[next++].get();
+				if (visited.insert(child).second) stack.push_back({ child, 0 });
+				continue;
+			}
+			topo.push_back(node);
+			stack.pop_back();
+		}
+		return topo;
+	}
+
+	// Runs this tensor's backward closure, adding its gradient into its children's
+	void propagate()
+	{
+		if (requiresGrad) _backward();
+	}
+
+	// ---------------------------------------------------------------------------------
+	// Ops
+	// ---------------------------------------------------------------------------------
+
+	// Matrix product of two 2D tensors: (M x K) * (K x N) -> (M x N)
+	// Either input may be a strided view, e.g. a transpose.
+	static TensorPtr matmul(const TensorPtr& a, const TensorPtr& b)
+	{
+		if (a->dim() != 2 || b->dim() != 2 || a->_shape[1] != b->_shape[0])
+		{
+			throw std::invalid_argument("Tensor::matmul: shapes are not compatible");
+		}
+
+		const size_t M = a->_shape[0], K = a->_shape[1], N = b->_shape[1];
+		TensorPtr out = Create({ M, N }, { a, b }, "MatMul");
+
+		// C = A * B
+		matmulStrided(M, N, K, a->data(), a->_strides[0], a->_strides[1],
+			b->data(), b->_strides[0], b->_strides[1], out->data(), N);
+
+		out->set_backward([a, b, out = out.get(), M, N, K]()
+		{
+			const double* dC = out->grad();
+			if (a->requiresGrad)
+			{
+				// dA += dC * B^T
+				matmulStrided(M, K, N, dC, N, 1, b->data(), b->_strides[1], b->_strides[0], a->grad(), K);
+			}
+			if (b->requiresGrad)
+			{
+				// dB += A^T * dC
+				matmulStrided(K, N, M, a->data(), a->_strides[1], a->_strides[0], dC, N, 1, b->grad(), N);
+			}
+		});
+		return out;
+	}
+
+	// Elementwise a + b with numpy-style broadcasting
+	static TensorPtr add(const TensorPtr& a, const TensorPtr& b)
+	{
+		return broadcastBinary(a, b, "+",
+			[](double x, double y) { return x + y; },
+			[](double, double, double g) { return g; },
+			[](double, double, double g) { return g; });
+	}
+
+	// Elementwise a - b with numpy-style broadcasting
+	static TensorPtr sub(const TensorPtr& a, const TensorPtr& b)
+	{
+		return broadcastBinary(a, b, "-",
+			[](double x, double y) { return x - y; },
+			[](double, double, double g) { return g; },
+			[](double, double, double g) { return -g; });
+	}
+
+	// Elementwise a * b with numpy-style broadcasting
+	static TensorPtr mul(const TensorPtr& a, const TensorPtr& b)
+	{
+		return broadcastBinary(a, b, "*",
+			[](double x, double y) { return x * y; },
+			[](double, double y, double g) { return y * g; },
+			[](double x, double, double g) { return x * g; });
+	}
+
+	// Multiplication by a constant
+	static TensorPtr scale(const TensorPtr& a, double s)
+	{
+		return unary(a, "Scale",
+			[s](double x) { return x * s; },
+			[s](double, double) { return s; });
+	}
+
+	static TensorPtr tanH(const TensorPtr& a)
+	{
+		// The derivative is written in terms of the output: 1 - tanh^2
+		return unary(a, "TanH",
+			[](size_t n, const double* x, double* y) { kernels::vtanh(n, x, y); },
+			[](double, double y) { return 1.0 - y * y; });
+	}
+
+	static TensorPtr sigmoid(const TensorPtr& a)
+	{
+		return unary(a, "Sigmoid",
+			[](size_t n, const double* x, double* y) { kernels::vsigmoid(n, x, y); },
+			[](double, double y) { return y * (1.0 - y); });
+	}
+
+	static TensorPtr relu(const TensorPtr& a)
+	{
+		return unary(a, "ReLU",
+			[](double x) { return x > 0.0 ? x : 0.0; },
+			[](double x, double) { return x > 0.0 ? 1.0 : 0.0; });
+	}
+
+	static TensorPtr exp(const TensorPtr& a)
+	{
+		return unary(a, "Exp",
+			[](size_t n, const double* x, double* y) { kernels::vexp(n, x, y); },
+			[](double, double y) { return y; });
+	}
+
+	// Applies one of the supported activations
+	static TensorPtr activate(const TensorPtr& a, Activation act)
+	{
+		switch (act)
+		{
+			case Activation::TanH: return tanH(a);
+			case Activation::Sigmoid: return sigmoid(a);
+			case Activation::ReLU: return relu(a);
+			default: return a;
+		}
+	}
+
+	// Sum of all elements, returned as a single-element tensor
+	static TensorPtr sum(const TensorPtr& a)
+	{
+		TensorPtr out = Create({ 1 }, { a }, "Sum");
+		double total = 0.0;
+		a->forEachValue([&](size_t, double v) { total += v; });
+		out->data()[0] = total;
+
+		out->set_backward([a, out = out.get()]()
+		{
+			double g = out->grad()[0];
+			double* ag = a->grad();
+			for (size_t i = 0; i < a->numel(); ++i) ag[i] += g;
+		});
+		return out;
+	}
+
+	// Sum along one axis. The reduced axis is kept with size 1 so the result
+	// broadcasts back against the input.
+	static TensorPtr sum(const TensorPtr& a, size_t axis)
+	{
+		if (axis >= a->dim()) throw std::invalid_argument("Tensor::sum: axis out of range");
+
+		Shape outShape = a->_shape;
+		outShape[axis] = 1;
+		TensorPtr out = Create(outShape, { a }, "SumAxis");
+
+		// outer x axis x inner decomposition of the row-major index
+		size_t outer = 1, inner = 1, n = a->_shape[axis];
+		for (size_t i = 0; i < axis; ++i) outer *= a->_shape[i];
+		for (size_t i = axis + 1; i < a->dim(); ++i) inner *= a->_shape[i];
+
+		double* o = out->data();
+		a->forEachValue([&](size_t i, double v)
+		{
+			size_t in = i % inner;
+			size_t ou = i / (inner * n);
+			o[ou * inner + in] += v;
+		});
+
+		out->set_backward([a, out = out.get(), inner, n]()
+		{
+			const double* og = out->grad();
+			double* ag = a->grad();
+			for (size_t i = 0; i < a->numel(); ++i)
+			{
+				ag[i] += og[(i / (inner * n)) * inner + i % inner];
+			}
+		});
+		return out;
+	}
+
+	// Mean of all elements
+	static TensorPtr mean(const TensorPtr& a)
+	{
+		return scale(sum(a), 1.0 / static_cast<double>(a->numel()));
+	}
+
+	// Mean squared error between two tensors of the same shape
+	static TensorPtr mseLoss(const TensorPtr& prediction, const TensorPtr& target)
+	{
+		if (prediction->_shape != target->_shape) throw std::invalid_argument("Tensor::mseLoss: shape mismatch");
+
+		const size_t n = prediction->numel();
+		TensorPtr p = prediction->contiguous();
+		TensorPtr t = target->contiguous();
+		TensorPtr out = Create({ 1 }, { p, t }, "MSE");
+
+		double total = 0.0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			double d = p->data()[i] - t->data()[i];
+			total += d * d;
+		}
+		out->data()[0] = total / static_cast<double>(n);
+
+		out->set_backward([p, t, out = out.get(), n]()
+		{
+			double g = out->grad()[0] * 2.0 / static_cast<double>(n);
+			const double* pd = p->data();
+			const double* td = t->data();
+			if (p->requiresGrad)
+			{
+				double* pg = p->grad();
+				for (size_t i = 0; i < n; ++i) pg[i] += g * (pd[i] - td[i]);
+			}
+			if (t->requiresGrad)
+			{
+				double* tg = t->grad();
+				for (size_t i = 0; i < n; ++i) tg[i] -= g * (pd[i] - td[i]);
+			}
+		});
+		return out;
+	}
+
+	// Mean softmax cross-entropy of N x K logits against N class labels.
+	// The softmax is folded into the loss so the backward is simply softmax - onehot.
+	static TensorPtr softmaxCrossEntropy(const TensorPtr& logits, const std::vector<int>& labels)
+	{
+		if (logits->dim() != 2 || logits->_shape[0] != labels.size())
+		{
+			throw std::invalid_argument("Tensor::softmaxCrossEntropy: logits must be N x K with N labels");
+		}
+
+		const size_t N = logits->_shape[0], K = logits->_shape[1];
+		TensorPtr x = logits->contiguous();
+		TensorPtr out = Create({ 1 }, { x }, "SoftmaxCE");
+
+		auto probs = std::make_shared<TensorBuffer>(N * K);
+		double total = 0.0;
+		for (size_t i = 0; i < N; ++i)
+		{
+			const double* row = x->data() + i * K;
+			double* p = probs->data() + i * K;
+			double m = *std::max_element(row, row + K);
+			for (size_t j = 0; j < K; ++j) p[j] = row[j] - m;
+			kernels::vexp(K, p, p);
+			double s = 0.0;
+			for (size_t j = 0; j < K; ++j) s += p[j];
+			for (size_t j = 0; j < K; ++j) p[j] /= s;
+			total -= std::log(std::max(p[labels[i]], 1e-300));
+		}
+		out->data()[0] = total / static_cast<double>(N);
+
+		out->set_backward([x, out = out.get(), probs, labels, N, K]()
+		{
+			double g = out->grad()[0] / static_cast<double>(N);
+			double* xg = x->grad();
+			for (size_t i = 0; i < N; ++i)
+			{
+				for (size_t j = 0; j < K; ++j)
+				{
+					double onehot = (static_cast<int>(j) == labels[i]) ? 1.0 : 0.0;
+					xg[i * K + j] += g * ((*probs)[i * K + j] - onehot);
+				}
+			}
+		});
+		return out;
+	}
+
+	// Fused dense layer: act(x * W^T + b) as a single node.
+	// x is N x in, W is out x in (one row per neuron, like Neuron's weights), b has out elements.
+	static TensorPtr dense(const TensorPtr& x, const TensorPtr& W, const TensorPtr& b, Activation act = Activation::TanH)
+	{
+		if (x->dim() != 2 || W->dim() != 2 || x->_shape[1] != W->_shape[1] || b->numel() != W->_shape[0])
+		{
+			throw std::invalid_argument("Tensor::dense: shapes are not compatible");
+		}
+
+		const size_t N = x->_shape[0], in = x->_shape[1], outCount = W->_shape[0];
+		TensorPtr xc = x->contiguous();
+		TensorPtr Wc = W->contiguous();
+		TensorPtr bc = b->contiguous();
+		TensorPtr out = Create({ N, outCount }, { xc, Wc, bc }, "Dense");
+
+		// Y = act(X * W^T + b)
+		kernels::denseForward<double>(N, in, outCount, act, xc->data(), in, Wc->data(), in, bc->data(), out->data(), outCount);
+
+		out->set_backward([xc, Wc, bc, out = out.get(), act, N, in, outCount]()
+		{
+			// dW, db and dX in one blocked pass with the activation derivative fused in
+			kernels::denseBackward<double>(N, in, outCount, act, xc->data(), in, Wc->data(), in,
+				out->data(), out->grad(), outCount, Wc->requiresGrad ? Wc->grad() : nullptr,
+				bc->requiresGrad ? bc->grad() : nullptr, xc->requiresGrad ? xc->grad() : nullptr);
+		});
+		return out;
+	}
+
+	// 2D convolution of an N x C x H x W batch with F x C x KH x KW filters and F biases,
+	// producing N x F x OH x OW. stride and padding are given as { vertical, horizontal }.
+	// Lowered to im2col and the blocked GEMM; backward runs col2im.
+	static TensorPtr conv2d(const TensorPtr& x, const TensorPtr& W, const TensorPtr& b,
+		std::array<size_t, 2> stride = { 1, 1 }, std::array<size_t, 2> padding = { 0, 0 }, Activation act = Activation::None)
+	{
+		if (x->dim() != 4 || W->dim() != 4 || x->_shape[1] != W->_shape[1] || b->numel() != W->_shape[0] ||
+			stride[0] == 0 || stride[1] == 0 ||
+			x->_shape[2] + 2 * padding[0] < W->_shape[2] || x->_shape[3] + 2 * padding[1] < W->_shape[3])
+		{
+			throw std::invalid_argument("Tensor::conv2d: shapes are not compatible");
+		}
+
+		kernels::ConvGeometry g;
+		g.channels = x->_shape[1];
+		g.height = x->_shape[2];
+		g.width = x->_shape[3];
+		g.kernelH = W->_shape[2];
+		g.kernelW = W->_shape[3];
+		g.strideH = stride[0];
+		g.strideW = stride[1];
+		g.padH = padding[0];
+		g.padW = padding[1];
+
+		const size_t N = x->_shape[0], filters = W->_shape[0];
+		TensorPtr xc = x->contiguous();
+		TensorPtr Wc = W->contiguous();
+		TensorPtr bc = b->contiguous();
+		TensorPtr out = Create({ N, filters, g.outH(), g.outW() }, { xc, Wc, bc }, "Conv2D");
+
+		kernels::convForward<double>(N, g, filters, act, xc->data(), Wc->data(), bc->data(), out->data());
+
+		out->set_backward([xc, Wc, bc, out = out.get(), g, N, filters, act]()
+		{
+			kernels::convBackward<double>(N, g, filters, act, xc->data(), Wc->data(), out->data(), out->grad(),
+				Wc->requiresGrad ? Wc->grad() : nullptr, bc->requiresGrad ? bc->grad() : nullptr,
+				xc->requiresGrad ? xc->grad() : nullptr);
+		});
+		return out;
+	}
+
+	// Dropout fused with an activation: act(x) with each element zeroed with probability p
+	// and the rest scaled by 1 / (1 - p). The mask comes from the counter-based generator
+	// keyed by (seed, step), so it is regenerated in backward instead of stored; calls with
+	// the same seed and step drop the same elements.
+	static TensorPtr dropout(const TensorPtr& x, double p, uint64_t seed, uint64_t step, Activation act = Activation::None)
+	{
+		if (p < 0.0 || p >= 1.0)
+		{
+			throw std::invalid_argument("Tensor::dropout: p must be in [0, 1)");
+		}
+
+		const uint64_t key = splitMix64(seed);
+		TensorPtr xc = x->contiguous();
+		TensorPtr out = Create(x->_shape, { xc }, "Dropout");
+		kernels::dropoutForward<double>(xc->numel(), act, p, key, step, 0, xc->data(), out->data());
+
+		out->set_backward([xc, out = out.get(), p, key, step, act]()
+		{
+			kernels::dropoutBackward<double>(xc->numel(), act, p, key, step, 0, out->data(), out->grad(), xc->grad());
+		});
+		return out;
+	}
+
+	// Layer normalization over the last axis: each row of D features is normalized to zero
+	// mean and unit variance, then scaled by gamma and shifted by beta (D elements each).
+	// The node keeps the per-row mean and rstd for its fused backward.
+	static TensorPtr layerNorm(const TensorPtr& x, const TensorPtr& gamma, const TensorPtr& beta, double eps = 1e-5)
+	{
+		if (x->dim() == 0 || gamma->numel() != x->_shape.back() || beta->numel() != x->_shape.back())
+		{
+			throw std::invalid_argument("Tensor::layerNorm: gamma and beta must match the last axis");
+		}
+
+		const size_t D = x->_shape.back(), N = D ? x->numel() / D : 0;
+		TensorPtr xc = x->contiguous();
+		TensorPtr gc = gamma->contiguous();
+		TensorPtr bc = beta->contiguous();
+		TensorPtr out = Create(x->_shape, { xc, gc, bc }, "LayerNorm");
+		auto stats = std::make_shared<std::vector<double>>(2 * N); // mean, then rstd
+
+		kernels::layerNormForward<double>(N, D, eps, xc->data(), gc->data(), bc->data(), out->data(),
+			stats->data(), stats->data() + N);
+
+		out->set_backward([xc, gc, bc, out = out.get(), stats, N, D]()
+		{
+			kernels::layerNormBackward<double>(N, D, xc->data(), gc->data(), stats->data(), stats->data() + N,
+				out->grad(), xc->requiresGrad ? xc->grad() : nullptr, gc->grad(), bc->grad());
+		});
+		return out;
+	}
+
+	// Multi-head self-attention over a packed N x L x 3D tensor whose last axis holds each
+	// token's query, key and value (D each), producing the N x L x D attention output with
+	// head h in columns h * D / heads onward. Runs the tiled online-softmax kernels, so no
+	// L x L matrix is stored: the node keeps only one log-sum-exp per row and head, and
+	// backward recomputes the probability tiles.
+	static TensorPtr selfAttention(const TensorPtr& qkv, size_t heads, bool causal = false)
+	{
+		if (qkv->dim() != 3 || heads == 0 || qkv->_shape[2] % (3 * heads) != 0)
+		{
+			throw std::invalid_argument("Tensor::selfAttention: expected N x L x 3D with D divisible by heads");
+		}
+
+		const size_t N = qkv->_shape[0], L = qkv->_shape[1], D = qkv->_shape[2] / 3, dh = D / heads;
+		const double scale = 1.0 / std::sqrt(static_cast<double>(dh));
+		TensorPtr xc = qkv->contiguous();
+		TensorPtr out = Create({ N, L, D }, { xc }, "SelfAttention");
+		auto lse = std::make_shared<std::vector<double>>(N * heads * L);
+
+		for (size_t n = 0; n < N; ++n)
+		{
+			for (size_t h = 0; h < heads; ++h)
+			{
+				const double* q = xc->data() + n * L * 3 * D + h * dh;
+				kernels::attentionForward<double>(L, dh, causal, scale, q, q + D, q + 2 * D, 3 * D,
+					out->data() + n * L * D + h * dh, D, lse->data() + (n * heads + h) * L);
+			}
+		}
+
+		out->set_backward([xc, out = out.get(), lse, N, L, D, dh, heads, causal, scale]()
+		{
+			for (size_t n = 0; n < N; ++n)
+			{
+				for (size_t h = 0; h < heads; ++h)
+				{
+					const size_t in = n * L * 3 * D + h * dh, o = n * L * D + h * dh;
+					const double* q = xc->data() + in;
+					double* dq = xc->grad() + in;
+					kernels::attentionBackward<double>(L, dh, causal, scale, q, q + D, q + 2 * D, 3 * D,
+						out->data() + o, out->grad() + o, D, lse->data() + (n * heads + h) * L, dq, dq + D, dq + 2 * D);
+				}
+			}
+		});
+		return out;
+	}
+
+	// C (M x N, row stride ldc) += A (M x K) * B (K x N), with A and B addressed through
+	// arbitrary row/column strides so transposed operands need no copy.
+	static void matmulStrided(size_t M, size_t N, size_t K,
+		const double* A, ptrdiff_t rsA, ptrdiff_t csA,
+		const double* B, ptrdiff_t rsB, ptrdiff_t csB,
+		double* C, size_t ldc)
+	{
+		kernels::gemm<double>(M, N, K, 1.0, A, rsA, csA, B, rsB, csB, 1.0, C, static_cast<ptrdiff_t>(ldc), 1);
+	}
+
+	static size_t countElements(const Shape& shape)
+	{
+		size_t n = 1;
+		for (size_t s : shape) n *= s;
+		return n;
+	}
+
+	static Strides contiguousStrides(const Shape& shape)
+	{
+		Strides strides(shape.size(), 1);
+		for (size_t i = shape.size(); i-- > 1;)
+		{
+			strides[i - 1] = strides[i] * static_cast<ptrdiff_t>(shape[i]);
+		}
+		return strides;
+	}
+
+private:
+	// Records the children and op of a new tensor
+	static TensorPtr link(TensorPtr instance, std::initializer_list<TensorPtr> children, const std::string& op)
+	{
+		instance->_prev = children;
+		instance->_op = op;
+		instance->_backward = [] {};
+
+		// Results of ops need a gradient if any of their inputs do
+		if (!instance->_prev.empty())
+		{
+			instance->requiresGrad = false;
+			for (auto& c : instance->_prev)
+				instance->requiresGrad = instance->requiresGrad || c->requiresGrad;
+		}
+
+		return instance;
+	}
+
+	// Shares storage with this tensor under a new shape and strides
+	TensorPtr makeView(const Shape& shape, const Strides& strides, const std::string& op)
+	{
+		return link(std::make_shared<Tensor>(shape, strides, storage, offset), { shared_from_this() }, op);
+	}
+
+	// Calls fn(logicalIndex, storageOffset) for every element in row-major order
+	template <typename F>
+	static void forEachOffset(const Shape& shape, const Strides& strides, F&& fn)
+	{
+		const size_t n = countElements(shape);
+		const size_t d = shape.size();
+		std::vector<size_t> idx(d, 0);
+		ptrdiff_t off = 0;
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			fn(i, off);
+
+			// Increment the multi-index, carrying into the outer axes
+			for (size_t ax = d; ax-- > 0;)
+			{
+				off += strides[ax];
+				if (++idx[ax] < shape[ax]) break;
+				off -= strides[ax] * static_cast<ptrdiff_t>(shape[ax]);
+				idx[ax] = 0;
+			}
+		}
+	}
+
+	// Calls fn(logicalIndex, value) for every element in row-major order
+	template <typename F>
+	void forEachValue(F&& fn) const
+	{
+		const double* p = data();
+		if (is_contiguous())
+		{
+			for (size_t i = 0; i < numel(); ++i) fn(i, p[i]);
+			return;
+		}
+		forEachOffset(_shape, _strides, [&](size_t i, ptrdiff_t off) { fn(i, p[off]); });
+	}
+
+	// Elementwise unary op. f is either a scalar function or an array function
+	// f(n, x, y) such as the vectorized kernels; dfdx receives the input and output values.
+	template <typename F, typename DF>
+	static TensorPtr unary(const TensorPtr& a, const std::string& op, F f, DF dfdx)
+	{
+		TensorPtr out = Create(a->_shape, { a }, op);
+		double* y = out->data();
+		if constexpr (std::is_invocable_v<F, size_t, const double*, double*>)
+		{
+			// Gather into the output first, then run the array function in place
+			a->forEachValue([&](size_t i, double v) { y[i] = v; });
+			f(out->numel(), y, y);
+		}
+		else
+		{
+			a->forEachValue([&](size_t i, double v) { y[i] = f(v); });
+		}
+
+		out->set_backward([a, out = out.get(), dfdx]()
+		{
+			const double* y = out->data();
+			const double* og = out->grad();
+			double* ag = a->grad();
+			a->forEachValue([&](size_t i, double v) { ag[i] += dfdx(v, y[i]) * og[i]; });
+		});
+		return out;
+	}
+
+	// Elementwise binary op with numpy-style broadcasting.
+	// dfa/dfb receive both input values and the output gradient.
+	template <typename F, typename DFA, typename DFB>
+	static TensorPtr broadcastBinary(const TensorPtr& a, const TensorPtr& b, const std::string& op, F f, DFA dfa, DFB dfb)
+	{
+		// Align shapes from the right and compute the broadcast output shape
+		const size_t d = std::max(a->dim(), b->dim());
+		Shape shape(d), aShape(d, 1), bShape(d, 1);
+		std::copy(a->_shape.begin(), a->_shape.end(), aShape.begin() + (d - a->dim()));
+		std::copy(b->_shape.begin(), b->_shape.end(), bShape.begin() + (d - b->dim()));
+
+		for (size_t i = 0; i < d; ++i)
+		{
+			if (aShape[i] != bShape[i] && aShape[i] != 1 && bShape[i] != 1)
+			{
+				throw std::invalid_argument("Tensor: shapes cannot be broadcast together");
+			}
+			shape[i] = std::max(aShape[i], bShape[i]);
+		}
+
+		// Data strides address storage, grad strides address the contiguous gradient.
+		// Broadcast axes get a stride of 0.
+		auto broadcastStrides = [d](const Tensor& t, const Shape& aligned, bool forGrad)
+		{
+			Strides s(d, 0);
+			Strides src = forGrad ? contiguousStrides(t._shape) : t._strides;
+			for (size_t i = 0; i < t.dim(); ++i)
+			{
+				size_t ax = i + (d - t.dim());
+				s[ax] = aligned[ax] == 1 ? 0 : src[i];
+			}
+			return s;
+		};
+
+		Strides aData = broadcastStrides(*a, aShape, false), aGrad = broadcastStrides(*a, aShape, true);
+		Strides bData = broadcastStrides(*b, bShape, false), bGrad = broadcastStrides(*b, bShape, true);
+
+		TensorPtr out = Create(shape, { a, b }, op);
+		double* y = out->data();
+		const double* ad = a->data();
+		const double* bd = b->data();
+
+		if (aShape == bShape && a->is_contiguous() && b->is_contiguous())
+		{
+			for (size_t i = 0; i < out->numel(); ++i) y[i] = f(ad[i], bd[i]);
+		}
+		else
+		{
+			forEachBroadcast(shape, aData, bData, [&](size_t i, ptrdiff_t ao, ptrdiff_t bo) { y[i] = f(ad[ao], bd[bo]); });
+		}
+
+		out->set_backward([a, b, out = out.get(), shape, aData, aGrad, bData, bGrad, dfa, dfb]()
+		{
+			const double* og = out->grad();
+			const double* ad = a->data();
+			const double* bd = b->data();
+			double* ag = a->requiresGrad ? a->grad() : nullptr;
+			double* bg = b->requiresGrad ? b->grad() : nullptr;
+
+			// Walk data and grad offsets together
+			const size_t d = shape.size();
+			std::vector<size_t> idx(d, 0);
+			ptrdiff_t aoD = 0, aoG = 0, boD = 0, boG = 0;
+			for (size_t i = 0; i < out->numel(); ++i)
+			{
+				if (ag) ag[aoG] += dfa(ad[aoD], bd[boD], og[i]);
+				if (bg) bg[boG] += dfb(ad[aoD], bd[boD], og[i]);
+
+				for (size_t ax = d; ax-- > 0;)
+				{
+					aoD += aData[ax]; aoG += aGrad[ax]; boD += bData[ax]; boG += bGrad[ax];
+					if (++idx[ax] < shape[ax]) break;
+					ptrdiff_t n = static_cast<ptrdiff_t>(shape[ax]);
+					aoD -= aData[ax] * n; aoG -= aGrad[ax] * n; boD -= bData[ax] * n; boG -= bGrad[ax] * n;
+					idx[ax] = 0;
+				}
+			}
+		});
+		return out;
+	}
+
+	// Calls fn(logicalIndex, aOffset, bOffset) over a broadcast shape
+	template <typename F>
+	static void forEachBroadcast(const Shape& shape, const Strides& aStrides, const Strides& bStrides, F&& fn)
+	{
+		const size_t n = countElements(shape);
+		const size_t d = shape.size();
+		std::vector<size_t> idx(d, 0);
+		ptrdiff_t ao = 0, bo = 0;
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			fn(i, ao, bo);
+
+			for (size_t ax = d; ax-- > 0;)
+			{
+				ao += aStrides[ax];
+				bo += bStrides[ax];
+				if (++idx[ax] < shape[ax]) break;
+				ao -= aStrides[ax] * static_cast<ptrdiff_t>(shape[ax]);
+				bo -= bStrides[ax] * static_cast<ptrdiff_t>(shape[ax]);
+				idx[ax] = 0;
+			}
+		}
+	}
+
+	Shape _shape;                               // Size of each axis, row-major
+	Strides _strides;                           // Storage step per axis, in elements
+	size_t offset = 0;                          // Offset of the first element in storage
+	std::shared_ptr<TensorBuffer> storage;      // Values, shared with views
+	std::shared_ptr<TensorBuffer> gradStorage;  // Owner of the gradient buffer
+	double* gradData = nullptr;                 // Gradient, contiguous in logical order
+	bool requiresGrad = true;                   // Whether backward computes a gradient for this tensor; leaves default to true
+
+	std::string _op;                            // The operation that produced this Tensor
+	std::vector<TensorPtr> _prev;               // The tensors this Tensor depends on
+	std::function<void()> _backward;            // Propagates gradients back through this Tensor
+};
@@ -0,0 +1,448 @@
+#pragma once
+
+// Modules built on the Tensor autograd engine.
+// They keep their weights in Tensors and report them through tensor_parameters().
+
+// The TensorLayer class is the tensor counterpart of Layer: the whole layer is a single
+// fused dense node computing act(x * W^T + b) for a batch of N inputs at once.
+class TensorLayer : public Module
+{
+private:
+	TensorPtr W; // out x in, one row per neuron
+	TensorPtr b; // out
+	Activation act = Activation::TanH;
+
+public:
+	// The weights are initialized like Neuron's, with generateRandomDouble() in [-1, 1],
+	// and the biases are initialized to 0.
+	TensorLayer(int neuronsIn, int neuronsOut, Activation act = Activation::TanH) :
+		act(act)
+	{
+		W = Tensor::Random({ static_cast<size_t>(neuronsOut), static_cast<size_t>(neuronsIn) });
+		b = Tensor::Create({ static_cast<size_t>(neuronsOut) });
+	}
+
+	// Initializes the weights for the scheme on the pool (see Tensor::Initialized); the
+	// biases are initialized to 0
+	TensorLayer(int neuronsIn, int neuronsOut, Activation act, WeightInit scheme, uint64_t seed, uint32_t index,
+		BS::thread_pool& pool) :
+		act(act)
+	{
+		W = Tensor::Initialized({ static_cast<size_t>(neuronsOut), static_cast<size_t>(neuronsIn) }, scheme, seed, index, pool);
+		b = Tensor::Create({ static_cast<size_t>(neuronsOut) });
+	}
+
+	// Takes existing out x in weights and out biases, e.g. computed from another layer;
+	// no random numbers are drawn
+	TensorLayer(TensorPtr weights, TensorPtr biases, Activation act = Activation::TanH) :
+		W(std::move(weights)), b(std::move(biases)), act(act)
+	{
+		if (W->dim() != 2 || b->dim() != 1 || b->numel() != W->size(0))
+		{
+			throw std::invalid_argument("TensorLayer: weights must be out x in and biases out");
+		}
+	}
+
+	// Copies the weights and biases of a scalar Layer, so both compute the same function
+	TensorLayer(Layer& layer)
+	{
+		auto& neurons = layer.getNeurons();
+		const size_t out = neurons.size();
+		const size_t in = out ? neurons[0].getWeights().size() : 0;
+
+		W = Tensor::Create({ out, in });
+		b = Tensor::Create({ out });
+		act = (out && neurons[0].isNonlinear()) ? Activation::TanH : Activation::None;
+
+		for (size_t i = 0; i < out; ++i)
+		{
+			const auto& w = neurons[i].getWeights();
+			for (size_t j = 0; j < in; ++j)
+			{
+				W->at(i, j) = w[j]->get_val();
+			}
+			b->at(i) = neurons[i].getBias()->get_val();
+		}
+	}
+
+	// Forward pass for an N x in batch, producing N x out
+	TensorPtr operator() (const TensorPtr& x)
+	{
+		return Tensor::dense(x, W, b, act);
+	}
+
+	size_t inputs() const { return W->size(1); }
+	size_t outputs() const { return W->size(0); }
+	Activation activation() const { return act; }
+
+	TensorPtr& weights() { return W; }
+	TensorPtr& biases() { return b; }
+
+	std::vector<TensorPtr> tensor_parameters() override
+	{
+		return { W, b };
+	}
+};
+
+// The Conv2D class is a 2D convolution layer over N x C x H x W batches, computing
+// act(conv(x, W) + b) as one fused Tensor::conv2d node.
+class Conv2D : public Module
+{
+private:
+	TensorPtr W; // filters x channels x kernel x kernel
+	TensorPtr b; // filters
+	std::array<size_t, 2> stride = { 1, 1 };
+	std::array<size_t, 2> padding = { 0, 0 };
+	Activation act = Activation::TanH;
+
+public:
+	// The weights are initialized like Neuron's, with generateRandomDouble() in [-1, 1],
+	// and the biases are initialized to 0.
+	Conv2D(size_t channels, size_t filters, size_t kernel, size_t stride = 1, size_t padding = 0, Activation act = Activation::TanH) :
+		stride{ stride, stride }, padding{ padding, padding }, act(act)
+	{
+		W = Tensor::Random({ filters, channels, kernel, kernel });
+		b = Tensor::Create({ filters });
+	}
+
+	// Forward pass for an N x channels x H x W batch, producing N x filters x OH x OW
+	TensorPtr operator() (const TensorPtr& x)
+	{
+		return Tensor::conv2d(x, W, b, stride, padding, act);
+	}
+
+	TensorPtr& weights() { return W; }
+	TensorPtr& biases() { return b; }
+
+	std::vector<TensorPtr> tensor_parameters() override
+	{
+		return { W, b };
+	}
+};
+
+// The Conv1D class is a 1D convolution layer over N x C x L batches of signal windows.
+// It runs as a Conv2D with a height of 1.
+class Conv1D : public Module
+{
+private:
+	TensorPtr W; // filters x channels x 1 x kernel
+	TensorPtr b; // filters
+	size_t stride = 1;
+	size_t padding = 0;
+	Activation act = Activation::TanH;
+
+public:
+	// The weights are initialized like Neuron's, with generateRandomDouble() in [-1, 1],
+	// and the biases are initialized to 0.
+	Conv1D(size_t channels, size_t filters, size_t kernel, size_t stride = 1, size_t padding = 0, Activation act = Activation::TanH) :
+		stride(stride), padding(padding), act(act)
+	{
+		W = Tensor::Random({ filters, channels, 1, kernel });
+		b = Tensor::Create({ filters });
+	}
+
+	// Forward pass for an N x channels x L batch, producing N x filters x OL
+	TensorPtr operator() (const TensorPtr& x)
+	{
+		if (x->dim() != 3) throw std::invalid_argument("Conv1D: input must be N x C x L");
+
+		const size_t N = x->size(0), C = x->size(1), L = x->size(2);
+		TensorPtr y = Tensor::conv2d(x->reshape({ N, C, 1, L }), W, b, { 1, stride }, { 0, padding }, act);
+		return y->reshape({ N, y->size(1), y->size(3) });
+	}
+
+	TensorPtr& weights() { return W; }
+	TensorPtr& biases() { return b; }
+
+	std::vector<TensorPtr> tensor_parameters() override
+	{
+		return { W, b };
+	}
+};
+
+// The MultiHeadAttention class is a multi-head self-attention block over N x L x D batches
+// of sequences. One fused dense node projects every token to its packed query, key and
+// value, Tensor::selfAttention runs the tiled attention over all heads, and a second dense
+// node applies the output projection.
+class MultiHeadAttention : public Module
+{
+private:
+	TensorPtr Wqkv; // 3D x D: the query, key and value projections stacked
+	TensorPtr bqkv; // 3D
+	TensorPtr Wo;   // D x D
+	TensorPtr bo;   // D
+	size_t heads = 1;
+	bool causal = false;
+
+public:
+	// The weights are initialized from generateRandomDouble() scaled by 1 / sqrt(D), so the
+	// attention scores start in a range where the softmax is not saturated, and the biases
+	// are initialized to 0. With causal set, each token attends only to itself and earlier ones.
+	MultiHeadAttention(size_t dim, size_t heads, bool causal = false) :
+		heads(heads), causal(causal)
+	{
+		if (heads == 0 || dim % heads != 0)
+		{
+			throw std::invalid_argument("MultiHeadAttention: dim must be divisible by heads");
+		}
+		const double scale = 1.0 / std::sqrt(static_cast<double>(dim));
+		Wqkv = Tensor::Random({ 3 * dim, dim });
+		Wo = Tensor::Random({ dim, dim });
+		for (size_t i = 0; i < Wqkv->numel(); ++i) Wqkv->data()[i] *= scale;
+		for (size_t i = 0; i < Wo->numel(); ++i) Wo->data()[i] *= scale;
+		bqkv = Tensor::Create({ 3 * dim });
+		bo = Tensor::Create({ dim });
+	}
+
+	// Forward pass for an N x L x D batch, producing N x L x D
+	TensorPtr operator() (const TensorPtr& x)
+	{
+		const size_t D = Wo->size(0);
+		if (x->dim() != 3 || x->size(2) != D)
+		{
+			throw std::invalid_argument("MultiHeadAttention: input must be N x L x dim");
+		}
+		const size_t N = x->size(0), L = x->size(1);
+
+		TensorPtr qkv = Tensor::dense(x->reshape({ N * L, D }), Wqkv, bqkv, Activation::None);
+		TensorPtr attended = Tensor::selfAttention(qkv->reshape({ N, L, 3 * D }), heads, causal);
+		return Tensor::dense(attended->reshape({ N * L, D }), Wo, bo, Activation::None)->reshape({ N, L, D });
+	}
+
+	size_t dimension() const { return Wo->size(0); }
+	size_t head_count() const { return heads; }
+
+	std::vector<TensorPtr> tensor_parameters() override
+	{
+		return { Wqkv, bqkv, Wo, bo };
+	}
+};
+
+// The Dropout class zeroes a random fraction p of its inputs while training, optionally
+// applying an activation first in the same pass (Tensor::dropout). Each forward call in
+// training mode uses the next step of its seed's mask sequence; in inference mode it only
+// applies the activation.
+class Dropout : public Module
+{
+private:
+	double p = 0.5;
+	uint64_t seed = 0;
+	uint64_t step = 0;
+	bool isTraining = true;
+
+public:
+	Dropout(double p, uint64_t seed = 0) :
+		p(p), seed(seed)
+	{
+		if (p < 0.0 || p >= 1.0)
+		{
+			throw std::invalid_argument("Dropout: p must be in [0, 1)");
+		}
+	}
+
+	void train(bool state) { isTraining = state; }
+	bool training() const { return isTraining; }
+
+	// Forward pass: act(x), with dropout while training
+	TensorPtr operator() (const TensorPtr& x, Activation act = Activation::None)
+	{
+		if (isTraining) return Tensor::dropout(x, p, seed, step++, act);
+		return Tensor::activate(x, act);
+	}
+
+	double rate() const { return p; }
+
+	// Number of masks drawn so far; the next training call uses this step
+	uint64_t steps() const { return step; }
+};
+
+// The LayerNorm class normalizes each row of its input over the last axis, then applies a
+// learned per-feature scale and shift, as one fused Tensor::layerNorm node.
+class LayerNorm : public Module
+{
+private:
+	TensorPtr gamma; // features, initialized to 1
+	TensorPtr beta;  // features, initialized to 0
+	double eps = 1e-5;
+
+public:
+	LayerNorm(size_t features, double eps = 1e-5) :
+		eps(eps)
+	{
+		gamma = Tensor::Full({ features }, 1.0);
+		beta = Tensor::Create({ features });
+	}
+
+	// Forward pass for any tensor whose last axis has the layer's feature count
+	TensorPtr operator() (const TensorPtr& x)
+	{
+		return Tensor::layerNorm(x, gamma, beta, eps);
+	}
+
+	TensorPtr& scale() { return gamma; }
+	TensorPtr& shift() { return beta; }
+
+	std::vector<TensorPtr> tensor_parameters() override
+	{
+		return { gamma, beta };
+	}
+};
+
+// The BatchNorm class normalizes each feature of an N x features batch over the batch.
+// In training mode it uses the batch's own statistics, computed by the fused kernels, and
+// folds them into running averages; in inference mode it applies the running averages, which
+// makes it a fixed per-feature affine map that foldBatchNorm can merge into the layer before it.
+class BatchNorm : public Module
+{
+private:
+	TensorPtr gamma; // features, initialized to 1
+	TensorPtr beta;  // features, initialized to 0
+	std::vector<double> runningMean;
+	std::vector<double> runningVar;
+	double momentum = 0.1;
+	double eps = 1e-5;
+	bool isTraining = true;
+
+public:
+	// running = (1 - momentum) * running + momentum * batch statistic; the running variance
+	// is the unbiased estimate
+	BatchNorm(size_t features, double momentum = 0.1, double eps = 1e-5) :
+		runningMean(features, 0.0), runningVar(features, 1.0), momentum(momentum), eps(eps)
+	{
+		gamma = Tensor::Full({ features }, 1.0);
+		beta = Tensor::Create({ features });
+	}
+
+	// Switches between batch statistics (training) and running statistics (inference)
+	void train(bool state) { isTraining = state; }
+	bool training() const { return isTraining; }
+
+	// Forward pass for an N x features batch
+	TensorPtr operator() (const TensorPtr& x)
+	{
+		const size_t D = gamma->numel();
+		if (x->dim() != 2 || x->size(1) != D)
+		{
+			throw std::invalid_argument("BatchNorm: input must be N x features");
+		}
+		const size_t N = x->size(0);
+		if (isTraining && N < 2)
+		{
+			throw std::invalid_argument("BatchNorm: training needs at least 2 samples per batch");
+		}
+
+		TensorPtr xc = x->contiguous();
+		auto stats = std::make_shared<std::vector<double>>(2 * D); // mean, then rstd
+		double* mean = stats->data();
+		double* rstd = stats->data() + D;
+
+		if (isTraining)
+		{
+			TensorPtr out = Tensor::Create({ N, D }, { xc, gamma, beta }, "BatchNorm");
+			std::vector<double> var(D);
+			kernels::batchNormForward<double>(N, D, eps, xc->data(), gamma->data(), beta->data(), out->data(), mean, rstd, var.data());
+
+			for (size_t k = 0; k < D; ++k)
+			{
+				runningMean[k] = (1.0 - momentum) * runningMean[k] + momentum * mean[k];
+				runningVar[k] = (1.0 - momentum) * runningVar[k] + momentum * var[k] * N / (N - 1);
+			}
+
+			out->set_backward([xc, gamma = gamma, beta = beta, out = out.get(), stats, N, D]()
+			{
+				kernels::batchNormBackward<double>(N, D, xc->data(), gamma->data(), stats->data(), stats->data() + D,
+					out->grad(), xc->requires_grad() ? xc->grad() : nullptr, gamma->grad(), beta->grad());
+			});
+			return out;
+		}
+
+		// Inference: the same normalization with the running statistics, which are constants
+		for (size_t k = 0; k < D; ++k)
+		{
+			mean[k] = runningMean[k];
+			rstd[k] = 1.0 / std::sqrt(runningVar[k] + eps);
+		}
+		TensorPtr out = Tensor::Create({ N, D }, { xc, gamma, beta }, "BatchNormInference");
+		const double* g = gamma->data();
+		const double* b = beta->data();
+		for (size_t n = 0; n < N; ++n)
+		{
+			const double* xr = xc->data() + n * D;
+			double* y = out->data() + n * D;
+			for (size_t k = 0; k < D; ++k) y[k] = (xr[k] - mean[k]) * rstd[k] * g[k] + b[k];
+		}
+
+		out->set_backward([xc, gamma = gamma, beta = beta, out = out.get(), stats, N, D]()
+		{
+			const double* mean = stats->data();
+			const double* rstd = stats->data() + D;
+			const double* g = gamma->data();
+			const double* dy = out->grad();
+			double* dg = gamma->grad();
+			double* db = beta->grad();
+			double* dx = xc->requires_grad() ? xc->grad() : nullptr;
+			for (size_t n = 0; n < N; ++n)
+			{
+				const double* xr = xc->data() + n * D;
+				for (size_t k = 0; k < D; ++k)
+				{
+					const double d = dy[n * D + k];
+					dg[k] += d * (xr[k] - mean[k]) * rstd[k];
+					db[k] += d;
+					if (dx) dx[n * D + k] += d * g[k] * rstd[k];
+				}
+			}
+		});
+		return out;
+	}
+
+	TensorPtr& scale() { return gamma; }
+	TensorPtr& shift() { return beta; }
+	const std::vector<double>& running_mean() const { return runningMean; }
+	const std::vector<double>& running_var() const { return runningVar; }
+	double epsilon() const { return eps; }
+
+	std::vector<TensorPtr> tensor_parameters() override
+	{
+		return { gamma, beta };
+	}
+};
+
+// Folds an inference-mode BatchNorm into the TensorLayer in front of it, for export. The
+// BatchNorm must be in inference mode and the layer linear (Activation::None); the result
+// computes act(bn(layer(x))) as a single dense layer with W' = diag(s) W and
+// b' = s * (b - mean) + beta, s = gamma / sqrt(var + eps), so inference pays nothing for
+// the normalization. Folding draws no random numbers, so it leaves later initialization
+// unchanged.
+inline TensorLayer foldBatchNorm(TensorLayer& layer, BatchNorm& bn, Activation act = Activation::None)
+{
+	if (bn.training())
+	{
+		throw std::invalid_argument("foldBatchNorm: the BatchNorm must be in inference mode");
+	}
+	if (layer.activation() != Activation::None)
+	{
+		throw std::invalid_argument("foldBatchNorm: the layer before the BatchNorm must be linear");
+	}
+	const size_t in = layer.inputs(), out = layer.outputs();
+	if (bn.scale()->numel() != out)
+	{
+		throw std::invalid_argument("foldBatchNorm: the BatchNorm does not match the layer's outputs");
+	}
+
+	TensorPtr foldedW = Tensor::Create({ out, in });
+	TensorPtr foldedB = Tensor::Create({ out });
+	const double* W = layer.weights()->data();
+	const double* b = layer.biases()->data();
+	const double* gamma = bn.scale()->data();
+	const double* beta = bn.shift()->data();
+	double* Wf = foldedW->data();
+	double* bf = foldedB->data();
+	for (size_t i = 0; i < out; ++i)
+	{
+		const double s = gamma[i] / std::sqrt(bn.running_var()[i] + bn.epsilon());
+		for (size_t j = 0; j < in; ++j) Wf[i * in + j] = s * W[i * in + j];
+		bf[i] = s * (b[i] - bn.running_mean()[i]) + beta[i];
+	}
+	return TensorLayer(foldedW, foldedB, act);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// Standard-library compatible allocator that returns memory aligned to 'Alignment' bytes.
+// Used for numeric buffers so that rows start on cache line / SIMD register boundaries.
+//
+// std::vector<double, AlignedAllocator<double, 64>> buffer(n);
+template <typename T, std::size_t Alignment = 64>
+class AlignedAllocator
+{
+    static_assert (Alignment >= alignof (T), "Alignment must be at least alignof(T)");
+    static_assert ((Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+
+ public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template <typename U>
+    AlignedAllocator (const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate (std::size_t n)
+    {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof (T))
+            throw std::bad_array_new_length();
+
+        return static_cast<T*> (::operator new (n * sizeof (T), std::align_val_t (Alignment)));
+    }
+
+    void deallocate (T* p, std::size_t) noexcept
+    {
+        ::operator delete (p, std::align_val_t (Alignment));
+    }
+
+    template <typename U>
+    bool operator== (const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+
+    template <typename U>
+    bool operator!= (const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+template <typename T, std::size_t Alignment = 64>
+using AlignedVector = std::vector<T, AlignedAllocator<T, Alignment>>;
@@ -0,0 +1,170 @@
+#pragma once
+
+// Counter-based random numbers: Philox4x32-10 (Salmon et al., "Parallel Random Numbers:
+// As Easy as 1, 2, 3", SC11).
+//
+// A counter-based generator has no state to advance. Each output block is a pure function
+// of a 128-bit counter and a 64-bit key, so the n-th number of a stream is computed
+// directly, any element can be regenerated later from its coordinates, and any split of
+// the work across threads gives the same numbers.
+//
+// CounterRng::block (key, counter) returns 4 x 32 random bits.
+// splitMix64 turns arbitrary 64-bit values (seeds, ids) into well-mixed keys.
+//
+// A stream is the sequence of words of one (key, stream) pair: word w of it is lane w % 4
+// of block (w / 4, stream). Distinct stream ids never share a counter, so a seed gives every
+// thread, parameter or purpose its own independent stream (see streamId). RandomStream reads
+// one stream sequentially; the bulk fills in kernels/Random.h write any range of one directly.
+struct CounterRng
+{
+    using Block = std::array<uint32_t, 4>;
+
+    static constexpr uint32_t M0 = 0xD2511F53u;
+    static constexpr uint32_t M1 = 0xCD9E8D57u;
+    static constexpr uint32_t W0 = 0x9E3779B9u; // key schedule increments
+    static constexpr uint32_t W1 = 0xBB67AE85u;
+
+    // Philox4x32 with 10 rounds, the counter given as two 64-bit halves
+    static Block block (uint64_t key, uint64_t counterLo, uint64_t counterHi)
+    {
+        uint32_t c0 = static_cast<uint32_t> (counterLo);
+        uint32_t c1 = static_cast<uint32_t> (counterLo >> 32);
+        uint32_t c2 = static_cast<uint32_t> (counterHi);
+        uint32_t c3 = static_cast<uint32_t> (counterHi >> 32);
+        uint32_t k0 = static_cast<uint32_t> (key);
+        uint32_t k1 = static_cast<uint32_t> (key >> 32);
+
+        for (int round = 0; round < 10; ++round)
+        {
+            const uint64_t p0 = uint64_t (M0) * c0;
+            const uint64_t p1 = uint64_t (M1) * c2;
+            const uint32_t n0 = static_cast<uint32_t> (p1 >> 32) ^ c1 ^ k0;
+            const uint32_t n2 = static_cast<uint32_t> (p0 >> 32) ^ c3 ^ k1;
+            c1 = static_cast<uint32_t> (p1);
+            c3 = static_cast<uint32_t> (p0);
+            c0 = n0;
+            c2 = n2;
+            k0 += W0;
+            k1 += W1;
+        }
+        return { c0, c1, c2, c3 };
+    }
+
+    // The 32 random bits of element 'index' of the stream (key, stream): elements 4i..4i+3
+    // share one Philox block
+    static uint32_t bits (uint64_t key, uint64_t stream, uint64_t index)
+    {
+        return block (key, index >> 2, stream)[index & 3];
+    }
+};
+
+// SplitMix64 finalizer: a bijective mix of 64 bits, used to derive keys from seeds
+inline uint64_t splitMix64 (uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Stream id for a purpose and an index, e.g. streamId (layerIndex, neuronIndex)
+inline uint64_t streamId (uint64_t purpose, uint64_t index = 0)
+{
+    return splitMix64 (purpose ^ splitMix64 (index));
+}
+
+// Maps random bits to [0, 1): 53 bits for double, 24 for float, so every value is exact
+inline double unitDouble (uint32_t high, uint32_t low)
+{
+    return static_cast<double> ((uint64_t (high) << 21) | (low >> 11)) * 0x1.0p-53;
+}
+
+inline float unitFloat (uint32_t bits)
+{
+    return static_cast<float> (bits >> 8) * 0x1.0p-24f;
+}
+
+// Sequential reader of one stream. Cheap to construct, so use one per thread or per task
+// rather than sharing one.
+class RandomStream
+{
+ public:
+    RandomStream (uint64_t seed = 0, uint64_t stream = 0, uint64_t position = 0) :
+        key (splitMix64 (seed)), stream (stream)
+    {
+        seek (position);
+    }
+
+    // Jumps to word 'position' of the stream
+    void seek (uint64_t position)
+    {
+        word = position;
+        bufferedBlock = ~uint64_t (0);
+    }
+
+    uint64_t position() const { return word; }
+
+    uint32_t nextBits()
+    {
+        const uint64_t blockIndex = word >> 2;
+        if (blockIndex != bufferedBlock)
+        {
+            buffer = CounterRng::block (key, blockIndex, stream);
+            bufferedBlock = blockIndex;
+        }
+        return buffer[word++ & 3];
+    }
+
+    // Uniform in [0, 1), from two words
+    double uniform()
+    {
+        const uint32_t high = nextBits();
+        return unitDouble (high, nextBits());
+    }
+
+    // Uniform in [lower, upper)
+    double uniform (double lower, double upper)
+    {
+        return lower + (upper - lower) * uniform();
+    }
+
+    // Standard normal with the Box-Muller transform, from four words
+    double normal()
+    {
+        const double u1 = uniform();
+        const double u2 = uniform();
+        return std::sqrt (-2.0 * std::log (1.0 - u1)) * std::cos (6.283185307179586 * u2);
+    }
+
+ private:
+    uint64_t key = 0;
+    uint64_t stream = 0;
+    uint64_t word = 0;
+    uint64_t bufferedBlock = ~uint64_t (0);
+    CounterRng::Block buffer{};
+};
+
+// The stream of a seed for the caller with the given index, e.g. a task's index in a
+// parallel loop. The numbers depend only on the seed and the index, never on which thread
+// asks or when, so a program that hands out the indices itself reads the same numbers on
+// every run. Each thread keeps its own position in the stream.
+inline RandomStream& threadRandomStream (uint64_t seed, uint64_t index)
+{
+    thread_local std::unordered_map<uint64_t, std::unordered_map<uint64_t, RandomStream>> streams;
+
+    auto& ofSeed = streams[seed];
+    auto it = ofSeed.find (index);
+    if (it == ofSeed.end()) it = ofSeed.emplace (index, RandomStream (seed, streamId (0x7468726561640000ull, index))).first;
+    return it->second;
+}
+
+// The calling thread's stream of a seed, with threads numbered in the order they first call
+// this. That order decides which numbers a thread reads: the main thread of a program that
+// calls it before starting any other reads the same numbers on every run, but pool workers
+// racing to their first call do not. Pass an explicit index where that matters.
+inline RandomStream& threadRandomStream (uint64_t seed)
+{
+    static std::atomic<uint64_t> nextThread{0};
+    thread_local uint64_t threadIndex = nextThread++;
+    return threadRandomStream (seed, threadIndex);
+}
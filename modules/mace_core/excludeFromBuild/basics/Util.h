@@ -156,25 +156,23 @@ static std::vector<char> readBinaryFile (const std::filesystem::path& filepath)
 }
 
 
-inline double generateRandomDouble(double lower_bound, double upper_bound) {
-    std::random_device rd;  // Obtain a random number from hardware
-    std::mt19937 gen(rd()); // Seed the generator
-    std::uniform_real_distribution<> distr(lower_bound, upper_bound); // Define the range
+// Nondeterministic uniform numbers: each thread seeds its own counter-based stream from
+// std::random_device once, instead of constructing and seeding an engine on every call
+inline RandomStream& nondeterministicStream() {
+    thread_local RandomStream stream((uint64_t(std::random_device{}()) << 32) | std::random_device{}());
+    return stream;
+}
 
-    return distr(gen); // Generate numbers
+inline double generateRandomDouble(double lower_bound, double upper_bound) {
+    return nondeterministicStream().uniform(lower_bound, upper_bound);
 }
 
 inline double randomUniform(double min, double max) {
-    std::random_device rd;
-    std::default_random_engine generator(rd());
-    std::uniform_real_distribution<double> distribution(min, max);
-
-    return distribution(generator);
+    return nondeterministicStream().uniform(min, max);
 }
 
+// Uniform in [-1, 1), the same sequence on every run. Each thread reads its own stream of
+// the fixed seed 12345, so concurrent callers neither race nor share numbers.
 inline double generateRandomDouble() {
-    static std::mt19937 generator(12345); // A Mersenne Twister pseudo-random generator with a seed of 12345
-    std::uniform_real_distribution<> distr(-1.0, 1.0); // Define the distribution between -1.0 and 1.0
-
-    return distr(generator);
+    return threadRandomStream(12345).uniform(-1.0, 1.0);
 }
@@ -0,0 +1,166 @@
+#pragma once
+
+// Tiled scaled dot-product attention with an online softmax (the FlashAttention scheme).
+//
+// For one head with queries Q, keys K and values V (each L x d), attention is
+// O = softmax(scale * Q K^T) V. Computing it directly materializes the L x L score matrix,
+// which for long sequences is far larger than the inputs. Here the queries are processed in
+// blocks of AttentionTile rows and the keys and values in blocks of AttentionTile rows:
+// each pair of blocks produces one small score tile with a GEMM, and the softmax is
+// accumulated online. Every query row keeps its running maximum m and normalizer l, and
+// when a new tile raises the maximum the partial output and l are rescaled by exp(m - m').
+// Only the tile and the per-row statistics are ever held, so memory is O(L * d).
+//
+// Forward also returns the row log-sum-exp, lse = m + log(l). Backward uses it to recompute
+// each probability tile exactly as P = exp(scale * Q K^T - lse) instead of storing P, and
+// needs only one more O(L) vector, D = rowsum(dO * O).
+//
+// Rows are addressed through a row stride so the heads of a packed batch are read in place:
+// Q, K and V (and their gradients) use ldIn, O and dO use ldOut.
+
+namespace kernels
+{
+	// Rows per query and key block. With d = 64 doubles the Q, K, V and output blocks and
+	// the 64 x 64 score tile come to about 160 KB, within a per-core L2.
+	constexpr size_t AttentionTile = 64;
+
+	namespace detail
+	{
+		// Number of keys of a block that row i may attend to, for a key block starting at j0
+		inline size_t visibleKeys(bool causal, size_t i, size_t j0, size_t bc)
+		{
+			if (!causal) return bc;
+			return i < j0 ? 0 : std::min(bc, i - j0 + 1);
+		}
+	} // namespace detail
+
+	// Forward pass for one head. Writes O (L x d, row stride ldOut) and lse (L).
+	// With causal set, query i attends only to keys 0..i.
+	template <typename T>
+	void attentionForward(size_t L, size_t d, bool causal, T scale,
+		const T* Q, const T* K, const T* V, size_t ldIn, T* O, size_t ldOut, T* lse)
+	{
+		constexpr size_t B = AttentionTile;
+		thread_local AlignedVector<T, 64> S, m, l;
+		S.resize(B * B);
+		m.resize(B);
+		l.resize(B);
+		const ptrdiff_t li = static_cast<ptrdiff_t>(ldIn), lo = static_cast<ptrdiff_t>(ldOut);
+
+		for (size_t i0 = 0; i0 < L; i0 += B)
+		{
+			const size_t br = std::min(B, L - i0);
+			for (size_t r = 0; r < br; ++r)
+			{
+				std::fill(O + (i0 + r) * ldOut, O + (i0 + r) * ldOut + d, T(0));
+				m[r] = -std::numeric_limits<T>::infinity();
+				l[r] = T(0);
+			}
+
+			const size_t jEnd = causal ? i0 + br : L;
+			for (size_t j0 = 0; j0 < jEnd; j0 += B)
+			{
+				const size_t bc = std::min(B, jEnd - j0);
+
+				// S = scale * Q_i K_j^T
+				gemm<T>(br, bc, d, scale, Q + i0 * ldIn, li, 1, K + j0 * ldIn, 1, li, T(0), S.data(), static_cast<ptrdiff_t>(B), 1);
+
+				// S becomes the tile's unnormalized probabilities under the updated row maxima
+				for (size_t r = 0; r < br; ++r)
+				{
+					T* s = S.data() + r * B;
+					const size_t visible = detail::visibleKeys(causal, i0 + r, j0, bc);
+					if (visible == 0)
+					{
+						std::fill(s, s + bc, T(0));
+						continue;
+					}
+
+					T mNew = m[r];
+					for (size_t c = 0; c < visible; ++c) mNew = std::max(mNew, s[c]);
+					for (size_t c = 0; c < visible; ++c) s[c] -= mNew;
+					vexp(visible, s, s);
+					std::fill(s + visible, s + bc, T(0));
+
+					const T rescale = std::exp(m[r] - mNew);
+					T sum = T(0);
+					for (size_t c = 0; c < visible; ++c) sum += s[c];
+					l[r] = l[r] * rescale + sum;
+					m[r] = mNew;
+					if (rescale != T(1))
+					{
+						T* o = O + (i0 + r) * ldOut;
+						for (size_t k = 0; k < d; ++k) o[k] *= rescale;
+					}
+				}
+
+				// O_i += P V_j
+				gemm<T>(br, d, bc, T(1), S.data(), static_cast<ptrdiff_t>(B), 1, V + j0 * ldIn, li, 1, T(1), O + i0 * ldOut, lo, 1);
+			}
+
+			for (size_t r = 0; r < br; ++r)
+			{
+				T* o = O + (i0 + r) * ldOut;
+				const T inv = T(1) / l[r];
+				for (size_t k = 0; k < d; ++k) o[k] *= inv;
+				lse[i0 + r] = m[r] + std::log(l[r]);
+			}
+		}
+	}
+
+	// Backward pass for one head, given the forward output O, its lse and the gradient dO.
+	// Recomputes the probability tiles and accumulates into dQ, dK and dV (row stride ldIn).
+	template <typename T>
+	void attentionBackward(size_t L, size_t d, bool causal, T scale,
+		const T* Q, const T* K, const T* V, size_t ldIn, const T* O, const T* dO, size_t ldOut, const T* lse,
+		T* dQ, T* dK, T* dV)
+	{
+		constexpr size_t B = AttentionTile;
+		thread_local AlignedVector<T, 64> P, dP, D;
+		P.resize(B * B);
+		dP.resize(B * B);
+		D.resize(L);
+		const ptrdiff_t li = static_cast<ptrdiff_t>(ldIn), lo = static_cast<ptrdiff_t>(ldOut);
+		const ptrdiff_t lb = static_cast<ptrdiff_t>(B);
+
+		// D_i = dO_i . O_i, the softmax Jacobian's correction term per row
+		for (size_t i = 0; i < L; ++i) D[i] = dot(d, dO + i * ldOut, O + i * ldOut);
+
+		// Key blocks outside so dK_j and dV_j stay in cache while the query blocks stream past
+		for (size_t j0 = 0; j0 < L; j0 += B)
+		{
+			const size_t bc = std::min(B, L - j0);
+			for (size_t i0 = causal ? j0 : 0; i0 < L; i0 += B)
+			{
+				const size_t br = std::min(B, L - i0);
+
+				// P = exp(scale * Q_i K_j^T - lse_i)
+				gemm<T>(br, bc, d, scale, Q + i0 * ldIn, li, 1, K + j0 * ldIn, 1, li, T(0), P.data(), lb, 1);
+				for (size_t r = 0; r < br; ++r)
+				{
+					T* p = P.data() + r * B;
+					const size_t visible = detail::visibleKeys(causal, i0 + r, j0, bc);
+					for (size_t c = 0; c < visible; ++c) p[c] -= lse[i0 + r];
+					vexp(visible, p, p);
+					std::fill(p + visible, p + bc, T(0));
+				}
+
+				// dV_j += P^T dO_i
+				gemm<T>(bc, d, br, T(1), P.data(), 1, lb, dO + i0 * ldOut, lo, 1, T(1), dV + j0 * ldIn, li, 1);
+
+				// dS = P * (dO_i V_j^T - D_i) * scale, in place of dP
+				gemm<T>(br, bc, d, T(1), dO + i0 * ldOut, lo, 1, V + j0 * ldIn, 1, li, T(0), dP.data(), lb, 1);
+				for (size_t r = 0; r < br; ++r)
+				{
+					const T* p = P.data() + r * B;
+					T* ds = dP.data() + r * B;
+					for (size_t c = 0; c < bc; ++c) ds[c] = p[c] * (ds[c] - D[i0 + r]) * scale;
+				}
+
+				// dQ_i += dS K_j, dK_j += dS^T Q_i
+				gemm<T>(br, d, bc, T(1), dP.data(), lb, 1, K + j0 * ldIn, li, 1, T(1), dQ + i0 * ldIn, li, 1);
+				gemm<T>(bc, d, br, T(1), dP.data(), 1, lb, Q + i0 * ldIn, li, 1, T(1), dK + j0 * ldIn, li, 1);
+			}
+		}
+	}
+} // namespace kernels
@@ -0,0 +1,165 @@
+#pragma once
+
+// 2D convolution kernels lowered onto the blocked GEMM with im2col.
+//
+// Conventions: a batch is NCHW, X is N x C x H x W, the filters are F x C x KH x KW and
+// Y = act(conv(X, W) + b) is N x F x OH x OW. For each sample, im2col unrolls every
+// receptive field into a column of a P x (OH * OW) matrix, P = C * KH * KW, so the
+// convolution becomes the GEMM W (F x P) * col. Backward uses the same lowering:
+// dW += delta * col^T, and dX is the col2im scatter of dcol = W^T * delta.
+// A 1D convolution is the special case H = KH = 1.
+
+namespace kernels
+{
+	struct ConvGeometry
+	{
+		size_t channels = 1;
+		size_t height = 1;
+		size_t width = 1;
+		size_t kernelH = 1;
+		size_t kernelW = 1;
+		size_t strideH = 1;
+		size_t strideW = 1;
+		size_t padH = 0;
+		size_t padW = 0;
+
+		size_t outH() const { return (height + 2 * padH - kernelH) / strideH + 1; }
+		size_t outW() const { return (width + 2 * padW - kernelW) / strideW + 1; }
+		size_t patch() const { return channels * kernelH * kernelW; }
+		size_t inputSize() const { return channels * height * width; }
+		size_t outputPixels() const { return outH() * outW(); }
+	};
+
+	// col (patch() x outH * outW) = the receptive fields of one C x H x W image, zero-padded
+	template <typename T>
+	void im2col(const ConvGeometry& g, const T* x, T* col)
+	{
+		const size_t oh = g.outH(), ow = g.outW();
+		for (size_t c = 0; c < g.channels; ++c)
+		{
+			for (size_t ki = 0; ki < g.kernelH; ++ki)
+			{
+				for (size_t kj = 0; kj < g.kernelW; ++kj)
+				{
+					T* dst = col + ((c * g.kernelH + ki) * g.kernelW + kj) * oh * ow;
+					for (size_t oy = 0; oy < oh; ++oy)
+					{
+						const ptrdiff_t iy = static_cast<ptrdiff_t>(oy * g.strideH + ki) - static_cast<ptrdiff_t>(g.padH);
+						T* d = dst + oy * ow;
+						if (iy < 0 || iy >= static_cast<ptrdiff_t>(g.height))
+						{
+							std::fill(d, d + ow, T(0));
+							continue;
+						}
+						const T* src = x + (c * g.height + iy) * g.width;
+						for (size_t ox = 0; ox < ow; ++ox)
+						{
+							const ptrdiff_t ix = static_cast<ptrdiff_t>(ox * g.strideW + kj) - static_cast<ptrdiff_t>(g.padW);
+							d[ox] = (ix < 0 || ix >= static_cast<ptrdiff_t>(g.width)) ? T(0) : src[ix];
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// The adjoint of im2col: adds every entry of col back onto the pixel it was read from
+	template <typename T>
+	void col2im(const ConvGeometry& g, const T* col, T* dx)
+	{
+		const size_t oh = g.outH(), ow = g.outW();
+		for (size_t c = 0; c < g.channels; ++c)
+		{
+			for (size_t ki = 0; ki < g.kernelH; ++ki)
+			{
+				for (size_t kj = 0; kj < g.kernelW; ++kj)
+				{
+					const T* src = col + ((c * g.kernelH + ki) * g.kernelW + kj) * oh * ow;
+					for (size_t oy = 0; oy < oh; ++oy)
+					{
+						const ptrdiff_t iy = static_cast<ptrdiff_t>(oy * g.strideH + ki) - static_cast<ptrdiff_t>(g.padH);
+						if (iy < 0 || iy >= static_cast<ptrdiff_t>(g.height)) continue;
+						T* d = dx + (c * g.height + iy) * g.width;
+						const T* s = src + oy * ow;
+						for (size_t ox = 0; ox < ow; ++ox)
+						{
+							const ptrdiff_t ix = static_cast<ptrdiff_t>(ox * g.strideW + kj) - static_cast<ptrdiff_t>(g.padW);
+							if (ix >= 0 && ix < static_cast<ptrdiff_t>(g.width)) d[ix] += s[ox];
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Forward: Y = act(conv(X, W) + b), one im2col and one GEMM per sample
+	template <typename T>
+	void convForward(size_t N, const ConvGeometry& g, size_t filters, Activation act,
+		const T* X, const T* W, const T* b, T* Y)
+	{
+		const size_t P = g.patch(), pixels = g.outputPixels();
+		thread_local AlignedVector<T, 64> col;
+		if (col.size() < P * pixels) col.resize(P * pixels);
+
+		for (size_t n = 0; n < N; ++n)
+		{
+			T* y = Y + n * filters * pixels;
+			im2col(g, X + n * g.inputSize(), col.data());
+			for (size_t f = 0; f < filters; ++f)
+			{
+				std::fill(y + f * pixels, y + (f + 1) * pixels, b[f]);
+			}
+			gemm<T>(filters, pixels, P, T(1), W, P, col.data(), pixels, T(1), y, pixels);
+			applyActivation(act, y, filters * pixels);
+		}
+	}
+
+	// Backward of convForward, given its output Y and the gradient dY. Accumulates into dW,
+	// db and dX, skipping any of them that is null. The columns are rebuilt from X rather
+	// than kept from the forward pass, trading one cheap im2col for P * OH * OW values per
+	// sample of memory.
+	template <typename T>
+	void convBackward(size_t N, const ConvGeometry& g, size_t filters, Activation act,
+		const T* X, const T* W, const T* Y, const T* dY,
+		T* dW, T* db, T* dX)
+	{
+		const size_t P = g.patch(), pixels = g.outputPixels();
+		thread_local AlignedVector<T, 64> col, delta;
+		if (col.size() < P * pixels) col.resize(P * pixels);
+		if (delta.size() < filters * pixels) delta.resize(filters * pixels);
+
+		for (size_t n = 0; n < N; ++n)
+		{
+			const T* y = Y + n * filters * pixels;
+			const T* dy = dY + n * filters * pixels;
+
+			// delta = dY * act'(Y), reduced into db in the same loop
+			for (size_t f = 0; f < filters; ++f)
+			{
+				T sum = T(0);
+				for (size_t p = f * pixels; p < (f + 1) * pixels; ++p)
+				{
+					delta[p] = dy[p] * activationDerivative(act, y[p]);
+					sum += delta[p];
+				}
+				if (db) db[f] += sum;
+			}
+
+			// dW (F x P) += delta (F x pixels) * col^T
+			if (dW)
+			{
+				im2col(g, X + n * g.inputSize(), col.data());
+				gemm<T>(filters, P, pixels, T(1), delta.data(), static_cast<ptrdiff_t>(pixels), 1,
+					col.data(), 1, static_cast<ptrdiff_t>(pixels), T(1), dW, static_cast<ptrdiff_t>(P), 1);
+			}
+
+			// dcol (P x pixels) = W^T * delta, scattered back into dX
+			if (dX)
+			{
+				gemm<T>(P, pixels, filters, T(1), W, 1, static_cast<ptrdiff_t>(P),
+					delta.data(), static_cast<ptrdiff_t>(pixels), 1, T(0), col.data(), static_cast<ptrdiff_t>(pixels), 1);
+				col2im(g, col.data(), dX + n * g.inputSize());
+			}
+		}
+	}
+} // namespace kernels
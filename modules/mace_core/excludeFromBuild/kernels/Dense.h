@@ -0,0 +1,183 @@
+#pragma once
+
+// Dense (fully connected) layer kernels built on the GEMM in Gemm.h.
+//
+// Conventions: a batch of N samples is row-major, X is N x in, W is out x in
+// (one row per neuron), Y = act(X * W^T + b) is N x out.
+
+// The activation applied by the fused dense kernels
+enum class Activation
+{
+	None,
+	TanH,
+	Sigmoid,
+	ReLU
+};
+
+namespace kernels
+{
+	// Applies the activation in place, using the vectorized tanh and sigmoid from Math.h
+	template <typename T>
+	void applyActivation(Activation act, T* y, size_t n)
+	{
+		switch (act)
+		{
+			case Activation::TanH: vtanh(n, y, y); break;
+			case Activation::Sigmoid: vsigmoid(n, y, y); break;
+			case Activation::ReLU: for (size_t i = 0; i < n; ++i) y[i] = y[i] > T(0) ? y[i] : T(0); break;
+			default: break;
+		}
+	}
+
+	// Scalar activation for loops that handle one element at a time
+	template <typename T>
+	T activation(Activation act, T x)
+	{
+		switch (act)
+		{
+			case Activation::TanH: return std::tanh(x);
+			case Activation::Sigmoid:
+			{
+				const T e = std::exp(-std::abs(x));
+				return (x >= T(0) ? T(1) : e) / (T(1) + e);
+			}
+			case Activation::ReLU: return x > T(0) ? x : T(0);
+			default: return x;
+		}
+	}
+
+	// Derivative of the activation written in terms of its output y,
+	// so backward never has to re-evaluate the activation
+	template <typename T>
+	T activationDerivative(Activation act, T y)
+	{
+		switch (act)
+		{
+			case Activation::TanH: return T(1) - y * y;
+			case Activation::Sigmoid: return y * (T(1) - y);
+			case Activation::ReLU: return y > T(0) ? T(1) : T(0);
+			default: return T(1);
+		}
+	}
+
+	// Batches smaller than this run the dense forward as one dot product per weight row and
+	// sample instead of a GEMM
+	constexpr size_t DenseStreamingBatch = 16;
+
+	// Forward: Y = act(X * W^T + b)
+	template <typename T>
+	void denseForward(size_t N, size_t in, size_t out, Activation act,
+		const T* X, size_t ldx, const T* W, size_t ldw, const T* b, T* Y, size_t ldy)
+	{
+		for (size_t n = 0; n < N; ++n)
+		{
+			std::copy(b, b + out, Y + n * ldy);
+		}
+
+		if (N < DenseStreamingBatch)
+		{
+			// Too few samples to amortize packing W for the GEMM: stream each row of W once
+			// and take its dot product with every sample while the row is in L1
+			for (size_t i = 0; i < out; ++i)
+			{
+				const T* w = W + i * ldw;
+				for (size_t n = 0; n < N; ++n) Y[n * ldy + i] += dot(in, w, X + n * ldx);
+			}
+		}
+		else
+		{
+			gemm<T>(N, out, in, T(1), X, static_cast<ptrdiff_t>(ldx), 1, W, 1, static_cast<ptrdiff_t>(ldw),
+				T(1), Y, static_cast<ptrdiff_t>(ldy), 1);
+		}
+
+		for (size_t n = 0; n < N; ++n)
+		{
+			applyActivation(act, Y + n * ldy, out);
+		}
+	}
+
+	// Fused backward of Y = act(X * W^T + b), given the layer output Y and its gradient dY.
+	// Accumulates into dW (out x in, ldw), db (out) and dX (N x in, ldx); any of the three may
+	// be null when that gradient is not needed.
+	//
+	// The batch is processed in row blocks small enough for the delta block to stay in cache.
+	// For each block one loop forms delta = dY * act'(Y) and reduces it into db, then
+	// dW += delta^T * X is applied as a rank-k GEMM update and dX += delta * W as a second GEMM,
+	// both reading the delta block while it is still hot. The full N x out delta is never stored.
+	template <typename T>
+	void denseBackward(size_t N, size_t in, size_t out, Activation act,
+		const T* X, size_t ldx, const T* W, size_t ldw,
+		const T* Y, const T* dY, size_t ldy,
+		T* dW, T* db, T* dX)
+	{
+		if (N == 0 || out == 0 || (!dW && !db && !dX)) return;
+
+		// Single sample: one pass over W and dW, row by row
+		if (N == 1)
+		{
+			for (size_t o = 0; o < out; ++o)
+			{
+				const T d = dY[o] * activationDerivative(act, Y[o]);
+				if (db) db[o] += d;
+				if (d == T(0)) continue;
+
+				const T* w = W + o * ldw;
+				if (dW)
+				{
+					T* g = dW + o * ldw;
+					for (size_t i = 0; i < in; ++i) g[i] += d * X[i];
+				}
+				if (dX)
+				{
+					for (size_t i = 0; i < in; ++i) dX[i] += d * w[i];
+				}
+			}
+			return;
+		}
+
+		// Rows per block: about 1MB of delta so it stays in L2, but tall enough that the
+		// dW update (a GEMM with the block height as its depth) and the repacking of W for
+		// dX are amortized over many rows
+		const size_t block = std::clamp<size_t>((size_t(1) << 20) / (out * sizeof(T)), 64, 1024);
+		thread_local AlignedVector<T, 64> deltaBuffer;
+		if (deltaBuffer.size() < block * out) deltaBuffer.resize(block * out);
+		T* delta = deltaBuffer.data();
+
+		for (size_t n0 = 0; n0 < N; n0 += block)
+		{
+			const size_t nb = std::min(block, N - n0);
+
+			// delta = dY * act'(Y), reduced into db while the row is hot
+			for (size_t n = 0; n < nb; ++n)
+			{
+				const T* y = Y + (n0 + n) * ldy;
+				const T* dy = dY + (n0 + n) * ldy;
+				T* d = delta + n * out;
+				for (size_t o = 0; o < out; ++o)
+				{
+					d[o] = dy[o] * activationDerivative(act, y[o]);
+				}
+				if (db)
+				{
+					for (size_t o = 0; o < out; ++o) db[o] += d[o];
+				}
+			}
+
+			// dW += delta^T * X_block
+			if (dW)
+			{
+				gemm<T>(out, in, nb, T(1), delta, 1, static_cast<ptrdiff_t>(out),
+					X + n0 * ldx, static_cast<ptrdiff_t>(ldx), 1,
+					T(1), dW, static_cast<ptrdiff_t>(ldw), 1);
+			}
+
+			// dX_block += delta * W
+			if (dX)
+			{
+				gemm<T>(nb, in, out, T(1), delta, static_cast<ptrdiff_t>(out), 1,
+					W, static_cast<ptrdiff_t>(ldw), 1,
+					T(1), dX + n0 * ldx, static_cast<ptrdiff_t>(ldx), 1);
+			}
+		}
+	}
+} // namespace kernels
@@ -0,0 +1,160 @@
+#pragma once
+
+// Runtime selection of the instruction set used by the numeric kernels.
+//
+// The workspace is compiled for baseline x64 (SSE2). Kernels that have faster variants
+// compile them side by side with per-function target attributes (GCC/Clang) or plain
+// intrinsics (MSVC, which allows AVX intrinsics without /arch), and pick one at call time
+// through activeIsa(). The ISA is detected once, on first use, from cpuid and the OS's
+// saved register state (XCR0), so AVX2 is only chosen when the OS preserves ymm registers
+// and AVX-512 only when it preserves zmm registers.
+//
+// The AVX2 level also requires FMA and F16C (half-precision conversion), which every AVX2
+// CPU provides.
+//
+// The environment variable MG_KERNELS_ISA (sse2, avx2, avx512 or avx512vnni) lowers the
+// choice, e.g. to compare variants or to reproduce results from an older machine. A request
+// above what the CPU supports is clamped to the detected ISA.
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define MG_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if MG_KERNELS_X86 && (defined(__GNUC__) || defined(__clang__))
+#define MG_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#define MG_TARGET_AVX512 __attribute__((target("avx512f,avx512dq,avx2,fma,f16c")))
+#define MG_TARGET_AVX512VNNI __attribute__((target("avx512f,avx512dq,avx512bw,avx512vl,avx512vnni,avx2,fma,f16c")))
+#else
+#define MG_TARGET_AVX2
+#define MG_TARGET_AVX512
+#define MG_TARGET_AVX512VNNI
+#endif
+
+namespace kernels
+{
+	// Ordered from oldest to newest, so variants can be compared with >=
+	enum class Isa
+	{
+		SSE2,
+		AVX2,
+		AVX512,
+		AVX512VNNI // AVX-512 plus the BW, VL and VNNI (int8 dot product) extensions
+	};
+
+	inline const char* isaName(Isa isa)
+	{
+		switch (isa)
+		{
+			case Isa::AVX2: return "avx2";
+			case Isa::AVX512: return "avx512";
+			case Isa::AVX512VNNI: return "avx512vnni";
+			default: return "sse2";
+		}
+	}
+
+	// Parses an ISA name (case-insensitive); returns false if the name is unknown
+	inline bool isaFromName(const std::string& name, Isa& isa)
+	{
+		std::string s(name);
+		std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		if (s == "sse2") { isa = Isa::SSE2; return true; }
+		if (s == "avx2") { isa = Isa::AVX2; return true; }
+		if (s == "avx512") { isa = Isa::AVX512; return true; }
+		if (s == "avx512vnni") { isa = Isa::AVX512VNNI; return true; }
+		return false;
+	}
+
+	// Best instruction set supported by both the CPU and the OS
+	inline Isa detectIsa()
+	{
+#if MG_KERNELS_X86
+		auto cpuid = [](unsigned leaf, unsigned sub, unsigned r[4])
+		{
+#if defined(_MSC_VER)
+			int regs[4];
+			__cpuidex(regs, static_cast<int>(leaf), static_cast<int>(sub));
+			for (int i = 0; i < 4; ++i) r[i] = static_cast<unsigned>(regs[i]);
+#else
+			__cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+#endif
+		};
+
+		unsigned r[4];
+		cpuid(0, 0, r);
+		if (r[0] < 7) return Isa::SSE2;
+
+		cpuid(1, 0, r);
+		const bool osxsave = (r[2] >> 27) & 1;
+		const bool fma = (r[2] >> 12) & 1;
+		const bool f16c = (r[2] >> 29) & 1;
+		if (!osxsave) return Isa::SSE2;
+
+		// XCR0: bits 1-2 are the xmm/ymm state, bits 5-7 the AVX-512 opmask and zmm state
+#if defined(_MSC_VER)
+		const unsigned long long xcr0 = _xgetbv(0);
+#else
+		unsigned lo, hi;
+		__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		const unsigned long long xcr0 = (static_cast<unsigned long long>(hi) << 32) | lo;
+#endif
+		const bool ymmState = (xcr0 & 0x6) == 0x6;
+		const bool zmmState = (xcr0 & 0xe6) == 0xe6;
+
+		cpuid(7, 0, r);
+		const bool avx2 = (r[1] >> 5) & 1;
+		const bool avx512f = (r[1] >> 16) & 1;
+		const bool avx512dq = (r[1] >> 17) & 1;
+		const bool avx512bw = (r[1] >> 30) & 1;
+		const bool avx512vl = (r[1] >> 31) & 1;
+		const bool avx512vnni = (r[2] >> 11) & 1;
+
+		if (avx512f && avx512dq && avx512bw && avx512vl && avx512vnni && avx2 && fma && f16c && zmmState) return Isa::AVX512VNNI;
+		if (avx512f && avx512dq && avx2 && fma && f16c && zmmState) return Isa::AVX512;
+		if (avx2 && fma && f16c && ymmState) return Isa::AVX2;
+#endif
+		return Isa::SSE2;
+	}
+
+	namespace detail
+	{
+		inline Isa initialIsa()
+		{
+			const Isa detected = detectIsa();
+			Isa requested;
+			const char* env = std::getenv("MG_KERNELS_ISA");
+			if (env && isaFromName(env, requested) && requested < detected)
+			{
+				return requested;
+			}
+			return detected;
+		}
+
+		inline std::atomic<Isa>& isaState()
+		{
+			static std::atomic<Isa> isa{ initialIsa() };
+			return isa;
+		}
+	} // namespace detail
+
+	// The instruction set the kernels currently dispatch to
+	inline Isa activeIsa()
+	{
+		return detail::isaState().load(std::memory_order_relaxed);
+	}
+
+	// Switches the kernels to another instruction set, clamped to what the CPU supports.
+	// Returns the ISA actually selected. Meant for tests and benchmarks; not synchronized
+	// with kernels already running on other threads.
+	inline Isa setIsa(Isa isa)
+	{
+		const Isa selected = std::min(isa, detectIsa());
+		detail::isaState().store(selected, std::memory_order_relaxed);
+		return selected;
+	}
+} // namespace kernels
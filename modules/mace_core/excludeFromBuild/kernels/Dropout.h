@@ -0,0 +1,69 @@
+#pragma once
+
+// Dropout fused with the activation, with masks from the counter-based generator in
+// basics/CounterRng.h.
+//
+// Element i of a call keyed by (key, stream) is kept when word offset + i of that stream
+// (see kernels/Random.h) is at least p * 2^32, and kept values are scaled by 1 / (1 - p) so
+// the expected output is unchanged. The mask is never stored: backward regenerates it from
+// the same coordinates. A layer uses its seed as the key and its training step as the
+// stream, so every step draws a fresh mask; offset lets a large tensor be processed in
+// independent chunks with the same result.
+
+namespace kernels
+{
+	namespace detail
+	{
+		// Threshold on 32 random bits below which an element is dropped
+		inline uint64_t dropThreshold(double p)
+		{
+			if (p <= 0.0) return 0;
+			if (p >= 1.0) return uint64_t(1) << 32;
+			return static_cast<uint64_t>(p * 4294967296.0);
+		}
+
+		// Calls fn(i, keep) for the n elements from offset, with the mask bits generated in
+		// L1-sized chunks by the bulk generator
+		template <typename F>
+		void forEachMask(size_t n, double p, uint64_t key, uint64_t stream, uint64_t offset, F&& fn)
+		{
+			const uint64_t threshold = dropThreshold(p);
+			constexpr size_t chunk = 4 * RandomChunkBlocks;
+			thread_local AlignedVector<uint32_t, 64> bits(chunk);
+			for (size_t i0 = 0; i0 < n; i0 += chunk)
+			{
+				const size_t len = std::min(chunk, n - i0);
+				randomBits(key, stream, offset + i0, len, bits.data());
+				for (size_t i = 0; i < len; ++i) fn(i0 + i, bits[i] >= threshold);
+			}
+		}
+	} // namespace detail
+
+	// y = dropout(act(x)) for n elements; x and y may alias. The activation, mask and scale
+	// are applied in one pass, and dropped elements skip the activation.
+	template <typename T>
+	void dropoutForward(size_t n, Activation act, double p, uint64_t key, uint64_t stream, uint64_t offset,
+		const T* x, T* y)
+	{
+		const T scale = p < 1.0 ? T(1.0 / (1.0 - p)) : T(0);
+		detail::forEachMask(n, p, key, stream, offset, [&](size_t i, bool keep)
+		{
+			y[i] = keep ? activation(act, x[i]) * scale : T(0);
+		});
+	}
+
+	// Backward of dropoutForward, given its output y: dX += dY * mask * act'(act(x)). A kept
+	// output is act(x) / (1 - p), so the activation is read back from it instead of being
+	// recomputed from x.
+	template <typename T>
+	void dropoutBackward(size_t n, Activation act, double p, uint64_t key, uint64_t stream, uint64_t offset,
+		const T* y, const T* dY, T* dX)
+	{
+		const T scale = p < 1.0 ? T(1.0 / (1.0 - p)) : T(0);
+		const T keepProbability = T(1.0 - p);
+		detail::forEachMask(n, p, key, stream, offset, [&](size_t i, bool keep)
+		{
+			if (keep) dX[i] += dY[i] * scale * activationDerivative(act, y[i] * keepProbability);
+		});
+	}
+} // namespace kernels
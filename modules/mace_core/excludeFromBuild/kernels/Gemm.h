@@ -0,0 +1,779 @@
+#pragma once
+
+// Dense matrix kernels for float and double.
+//
+// gemm computes C = alpha * A * B + beta * C for M x K A, K x N B and M x N C.
+// Every operand is addressed through a row stride and a column stride, so
+// transposed operands are passed by swapping strides instead of copying.
+//
+// The blocked path follows the usual GotoBLAS/BLIS structure:
+//   - B is packed into KC x NC blocks of NR-wide column panels (stays in L3/L2)
+//   - A is packed into MC x KC blocks of MR-tall row panels (stays in L2)
+//   - a register-tiled MR x NR microkernel streams one A panel and one B panel (L1)
+// Packing zero-pads the edges so the microkernel always runs a full tile.
+//
+// The microkernel is chosen at run time from activeIsa() (see Dispatch.h): AVX-512
+// and AVX2 variants use 512/256-bit FMA on the same 6x8 (double) and 6x16 (float)
+// tiles, and the SSE2 baseline uses a portable scalar microkernel with that tiling,
+// so packing is shared by all of them. dot follows the same scheme.
+// gemmReference is the plain triple loop that everything is tested against.
+
+namespace kernels
+{
+	// Cache blocking parameters per scalar type.
+	// MC x KC of A fills about half of L2, KC x NR of B about a third of L1.
+	// TM x TN is the output tile one thread of gemmParallel owns: its A rows and the packed
+	// KC x TN slice of B together stay within a per-core L2.
+	template <typename T>
+	struct GemmBlocking;
+
+	template <>
+	struct GemmBlocking<double>
+	{
+		static constexpr size_t MR = 6;
+		static constexpr size_t NR = 8;
+		static constexpr size_t MC = 72;
+		static constexpr size_t KC = 256;
+		static constexpr size_t NC = 4080;
+		static constexpr size_t TM = 144;
+		static constexpr size_t TN = 256;
+	};
+
+	template <>
+	struct GemmBlocking<float>
+	{
+		static constexpr size_t MR = 6;
+		static constexpr size_t NR = 16;
+		static constexpr size_t MC = 96;
+		static constexpr size_t KC = 256;
+		static constexpr size_t NC = 4080;
+		static constexpr size_t TM = 192;
+		static constexpr size_t TN = 512;
+	};
+
+	// Reference implementation: C = alpha * A * B + beta * C
+	template <typename T>
+	void gemmReference(size_t M, size_t N, size_t K, T alpha,
+		const T* A, ptrdiff_t rsA, ptrdiff_t csA,
+		const T* B, ptrdiff_t rsB, ptrdiff_t csB,
+		T beta, T* C, ptrdiff_t rsC, ptrdiff_t csC)
+	{
+		for (size_t i = 0; i < M; ++i)
+		{
+			for (size_t j = 0; j < N; ++j)
+			{
+				T sum = 0;
+				for (size_t k = 0; k < K; ++k)
+				{
+					sum += A[i * rsA + k * csA] * B[k * rsB + j * csB];
+				}
+				T& c = C[i * rsC + j * csC];
+				c = (beta == T(0) ? T(0) : beta * c) + alpha * sum;
+			}
+		}
+	}
+
+	namespace detail
+	{
+		// Packs an mc x kc block of A (scaled by alpha) into MR-row panels:
+		// panel p holds, for each k, MR consecutive values. Rows past mc are zero.
+		template <typename T>
+		void packA(size_t mc, size_t kc, T alpha, const T* A, ptrdiff_t rsA, ptrdiff_t csA, T* Ap)
+		{
+			constexpr size_t MR = GemmBlocking<T>::MR;
+			for (size_t i = 0; i < mc; i += MR)
+			{
+				const size_t mr = std::min(MR, mc - i);
+				for (size_t k = 0; k < kc; ++k)
+				{
+					size_t r = 0;
+					for (; r < mr; ++r) Ap[r] = alpha * A[(i + r) * rsA + k * csA];
+					for (; r < MR; ++r) Ap[r] = T(0);
+					Ap += MR;
+				}
+			}
+		}
+
+		// Packs a kc x nc block of B into NR-column panels. Columns past nc are zero.
+		template <typename T>
+		void packB(size_t kc, size_t nc, const T* B, ptrdiff_t rsB, ptrdiff_t csB, T* Bp)
+		{
+			constexpr size_t NR = GemmBlocking<T>::NR;
+			for (size_t j = 0; j < nc; j += NR)
+			{
+				const size_t nr = std::min(NR, nc - j);
+
+				// A transposed B (the weights of a dense layer) has contiguous columns. Stream each
+				// column instead of gathering NR columns per k: with a power-of-two leading
+				// dimension the gathered lines all map to the same L1 set and evict each other.
+				if (rsB == 1 && csB != 1)
+				{
+					for (size_t c = 0; c < nr; ++c)
+					{
+						const T* b = B + (j + c) * csB;
+						for (size_t k = 0; k < kc; ++k) Bp[k * NR + c] = b[k];
+					}
+					for (size_t c = nr; c < NR; ++c)
+					{
+						for (size_t k = 0; k < kc; ++k) Bp[k * NR + c] = T(0);
+					}
+					Bp += kc * NR;
+					continue;
+				}
+
+				for (size_t k = 0; k < kc; ++k)
+				{
+					const T* b = B + k * rsB + j * csB;
+					size_t c = 0;
+					if (csB == 1 && nr == NR)
+					{
+						std::copy(b, b + NR, Bp); // fixed length, so it compiles to a few vector moves
+						c = NR;
+					}
+					else if (csB == 1)
+					{
+						for (; c < nr; ++c) Bp[c] = b[c];
+					}
+					else
+					{
+						for (; c < nr; ++c) Bp[c] = b[c * csB];
+					}
+					for (; c < NR; ++c) Bp[c] = T(0);
+					Bp += NR;
+				}
+			}
+		}
+
+		// Adds an MR x NR tile held in row-major 'tile' to C, clipped to mr x nr
+		template <typename T>
+		void addTile(const T* tile, size_t mr, size_t nr, T* C, ptrdiff_t rsC, ptrdiff_t csC)
+		{
+			constexpr size_t NR = GemmBlocking<T>::NR;
+			for (size_t i = 0; i < mr; ++i)
+				for (size_t j = 0; j < nr; ++j)
+					C[i * rsC + j * csC] += tile[i * NR + j];
+		}
+
+		// Portable microkernel: C[mr x nr] += Ap * Bp over kc
+		template <typename T>
+		void microkernelScalar(size_t kc, const T* Ap, const T* Bp, T* C, ptrdiff_t rsC, ptrdiff_t csC, size_t mr, size_t nr)
+		{
+			constexpr size_t MR = GemmBlocking<T>::MR;
+			constexpr size_t NR = GemmBlocking<T>::NR;
+			alignas(64) T tile[MR * NR] = {};
+
+			for (size_t k = 0; k < kc; ++k)
+			{
+				for (size_t i = 0; i < MR; ++i)
+				{
+					const T a = Ap[i];
+					for (size_t j = 0; j < NR; ++j)
+					{
+						tile[i * NR + j] += a * Bp[j];
+					}
+				}
+				Ap += MR;
+				Bp += NR;
+			}
+			addTile(tile, mr, nr, C, rsC, csC);
+		}
+
+#if MG_KERNELS_X86
+		// 6x8 double microkernel: 12 ymm accumulators, 2 for the B row, 1 broadcast
+		MG_TARGET_AVX2 inline void microkernelAvx2(size_t kc, const double* Ap, const double* Bp, double* C, ptrdiff_t rsC, ptrdiff_t csC, size_t mr, size_t nr)
+		{
+			__m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+			__m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+			__m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+			__m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+			__m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+			__m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+
+			for (size_t k = 0; k < kc; ++k)
+			{
+				const __m256d b0 = _mm256_load_pd(Bp);
+				const __m256d b1 = _mm256_load_pd(Bp + 4);
+				__m256d a;
+
+				a = _mm256_broadcast_sd(Ap + 0); c00 = _mm256_fmadd_pd(a, b0, c00); c01 = _mm256_fmadd_pd(a, b1, c01);
+				a = _mm256_broadcast_sd(Ap + 1); c10 = _mm256_fmadd_pd(a, b0, c10); c11 = _mm256_fmadd_pd(a, b1, c11);
+				a = _mm256_broadcast_sd(Ap + 2); c20 = _mm256_fmadd_pd(a, b0, c20); c21 = _mm256_fmadd_pd(a, b1, c21);
+				a = _mm256_broadcast_sd(Ap + 3); c30 = _mm256_fmadd_pd(a, b0, c30); c31 = _mm256_fmadd_pd(a, b1, c31);
+				a = _mm256_broadcast_sd(Ap + 4); c40 = _mm256_fmadd_pd(a, b0, c40); c41 = _mm256_fmadd_pd(a, b1, c41);
+				a = _mm256_broadcast_sd(Ap + 5); c50 = _mm256_fmadd_pd(a, b0, c50); c51 = _mm256_fmadd_pd(a, b1, c51);
+
+				Ap += 6;
+				Bp += 8;
+			}
+
+			if (mr == 6 && nr == 8 && csC == 1)
+			{
+				double* c = C;
+				_mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), c00)); _mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), c01)); c += rsC;
+				_mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), c10)); _mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), c11)); c += rsC;
+				_mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), c20)); _mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), c21)); c += rsC;
+				_mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), c30)); _mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), c31)); c += rsC;
+				_mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), c40)); _mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), c41)); c += rsC;
+				_mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), c50)); _mm256_storeu_pd(c + 4, _mm256_add_pd(_mm256_loadu_pd(c + 4), c51));
+				return;
+			}
+
+			// Edge tile or strided C: spill to a temporary and add the valid part
+			alignas(64) double tile[6 * 8];
+			_mm256_store_pd(tile + 0, c00); _mm256_store_pd(tile + 4, c01);
+			_mm256_store_pd(tile + 8, c10); _mm256_store_pd(tile + 12, c11);
+			_mm256_store_pd(tile + 16, c20); _mm256_store_pd(tile + 20, c21);
+			_mm256_store_pd(tile + 24, c30); _mm256_store_pd(tile + 28, c31);
+			_mm256_store_pd(tile + 32, c40); _mm256_store_pd(tile + 36, c41);
+			_mm256_store_pd(tile + 40, c50); _mm256_store_pd(tile + 44, c51);
+			addTile(tile, mr, nr, C, rsC, csC);
+		}
+
+		// 6x16 float microkernel
+		MG_TARGET_AVX2 inline void microkernelAvx2(size_t kc, const float* Ap, const float* Bp, float* C, ptrdiff_t rsC, ptrdiff_t csC, size_t mr, size_t nr)
+		{
+			__m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+			__m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+			__m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+			__m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+			__m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+			__m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+			for (size_t k = 0; k < kc; ++k)
+			{
+				const __m256 b0 = _mm256_load_ps(Bp);
+				const __m256 b1 = _mm256_load_ps(Bp + 8);
+				__m256 a;
+
+				a = _mm256_broadcast_ss(Ap + 0); c00 = _mm256_fmadd_ps(a, b0, c00); c01 = _mm256_fmadd_ps(a, b1, c01);
+				a = _mm256_broadcast_ss(Ap + 1); c10 = _mm256_fmadd_ps(a, b0, c10); c11 = _mm256_fmadd_ps(a, b1, c11);
+				a = _mm256_broadcast_ss(Ap + 2); c20 = _mm256_fmadd_ps(a, b0, c20); c21 = _mm256_fmadd_ps(a, b1, c21);
+				a = _mm256_broadcast_ss(Ap + 3); c30 = _mm256_fmadd_ps(a, b0, c30); c31 = _mm256_fmadd_ps(a, b1, c31);
+				a = _mm256_broadcast_ss(Ap + 4); c40 = _mm256_fmadd_ps(a, b0, c40); c41 = _mm256_fmadd_ps(a, b1, c41);
+				a = _mm256_broadcast_ss(Ap + 5); c50 = _mm256_fmadd_ps(a, b0, c50); c51 = _mm256_fmadd_ps(a, b1, c51);
+
+				Ap += 6;
+				Bp += 16;
+			}
+
+			if (mr == 6 && nr == 16 && csC == 1)
+			{
+				float* c = C;
+				_mm256_storeu_ps(c, _mm256_add_ps(_mm256_loadu_ps(c), c00)); _mm256_storeu_ps(c + 8, _mm256_add_ps(_mm256_loadu_ps(c + 8), c01)); c += rsC;
+				_mm256_storeu_ps(c, _mm256_add_ps(_mm256_loadu_ps(c), c10)); _mm256_storeu_ps(c + 8, _mm256_add_ps(_mm256_loadu_ps(c + 8), c11)); c += rsC;
+				_mm256_storeu_ps(c, _mm256_add_ps(_mm256_loadu_ps(c), c20)); _mm256_storeu_ps(c + 8, _mm256_add_ps(_mm256_loadu_ps(c + 8), c21)); c += rsC;
+				_mm256_storeu_ps(c, _mm256_add_ps(_mm256_loadu_ps(c), c30)); _mm256_storeu_ps(c + 8, _mm256_add_ps(_mm256_loadu_ps(c + 8), c31)); c += rsC;
+				_mm256_storeu_ps(c, _mm256_add_ps(_mm256_loadu_ps(c), c40)); _mm256_storeu_ps(c + 8, _mm256_add_ps(_mm256_loadu_ps(c + 8), c41)); c += rsC;
+				_mm256_storeu_ps(c, _mm256_add_ps(_mm256_loadu_ps(c), c50)); _mm256_storeu_ps(c + 8, _mm256_add_ps(_mm256_loadu_ps(c + 8), c51));
+				return;
+			}
+
+			alignas(64) float tile[6 * 16];
+			_mm256_store_ps(tile + 0, c00); _mm256_store_ps(tile + 8, c01);
+			_mm256_store_ps(tile + 16, c10); _mm256_store_ps(tile + 24, c11);
+			_mm256_store_ps(tile + 32, c20); _mm256_store_ps(tile + 40, c21);
+			_mm256_store_ps(tile + 48, c30); _mm256_store_ps(tile + 56, c31);
+			_mm256_store_ps(tile + 64, c40); _mm256_store_ps(tile + 72, c41);
+			_mm256_store_ps(tile + 80, c50); _mm256_store_ps(tile + 88, c51);
+			addTile(tile, mr, nr, C, rsC, csC);
+		}
+
+		// 6x8 double microkernel: one zmm per row of the tile. Even and odd k go to separate
+		// accumulators (12 in flight) to cover the FMA latency, and are summed at the end.
+		MG_TARGET_AVX512 inline void microkernelAvx512(size_t kc, const double* Ap, const double* Bp, double* C, ptrdiff_t rsC, ptrdiff_t csC, size_t mr, size_t nr)
+		{
+			__m512d e0 = _mm512_setzero_pd(), e1 = _mm512_setzero_pd(), e2 = _mm512_setzero_pd();
+			__m512d e3 = _mm512_setzero_pd(), e4 = _mm512_setzero_pd(), e5 = _mm512_setzero_pd();
+			__m512d o0 = _mm512_setzero_pd(), o1 = _mm512_setzero_pd(), o2 = _mm512_setzero_pd();
+			__m512d o3 = _mm512_setzero_pd(), o4 = _mm512_setzero_pd(), o5 = _mm512_setzero_pd();
+
+			size_t k = 0;
+			for (; k + 2 <= kc; k += 2)
+			{
+				const __m512d b0 = _mm512_load_pd(Bp);
+				const __m512d b1 = _mm512_load_pd(Bp + 8);
+
+				e0 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[0]), b0, e0); o0 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[6]), b1, o0);
+				e1 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[1]), b0, e1); o1 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[7]), b1, o1);
+				e2 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[2]), b0, e2); o2 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[8]), b1, o2);
+				e3 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[3]), b0, e3); o3 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[9]), b1, o3);
+				e4 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[4]), b0, e4); o4 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[10]), b1, o4);
+				e5 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[5]), b0, e5); o5 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[11]), b1, o5);
+
+				Ap += 12;
+				Bp += 16;
+			}
+			if (k < kc)
+			{
+				const __m512d b0 = _mm512_load_pd(Bp);
+				e0 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[0]), b0, e0);
+				e1 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[1]), b0, e1);
+				e2 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[2]), b0, e2);
+				e3 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[3]), b0, e3);
+				e4 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[4]), b0, e4);
+				e5 = _mm512_fmadd_pd(_mm512_set1_pd(Ap[5]), b0, e5);
+			}
+
+			const __m512d c[6] = { _mm512_add_pd(e0, o0), _mm512_add_pd(e1, o1), _mm512_add_pd(e2, o2),
+				_mm512_add_pd(e3, o3), _mm512_add_pd(e4, o4), _mm512_add_pd(e5, o5) };
+
+			if (mr == 6 && nr == 8 && csC == 1)
+			{
+				for (size_t i = 0; i < 6; ++i)
+				{
+					double* row = C + i * rsC;
+					_mm512_storeu_pd(row, _mm512_add_pd(_mm512_loadu_pd(row), c[i]));
+				}
+				return;
+			}
+
+			alignas(64) double tile[6 * 8];
+			for (size_t i = 0; i < 6; ++i) _mm512_store_pd(tile + i * 8, c[i]);
+			addTile(tile, mr, nr, C, rsC, csC);
+		}
+
+		// 6x16 float microkernel, same structure as the double one
+		MG_TARGET_AVX512 inline void microkernelAvx512(size_t kc, const float* Ap, const float* Bp, float* C, ptrdiff_t rsC, ptrdiff_t csC, size_t mr, size_t nr)
+		{
+			__m512 e0 = _mm512_setzero_ps(), e1 = _mm512_setzero_ps(), e2 = _mm512_setzero_ps();
+			__m512 e3 = _mm512_setzero_ps(), e4 = _mm512_setzero_ps(), e5 = _mm512_setzero_ps();
+			__m512 o0 = _mm512_setzero_ps(), o1 = _mm512_setzero_ps(), o2 = _mm512_setzero_ps();
+			__m512 o3 = _mm512_setzero_ps(), o4 = _mm512_setzero_ps(), o5 = _mm512_setzero_ps();
+
+			size_t k = 0;
+			for (; k + 2 <= kc; k += 2)
+			{
+				const __m512 b0 = _mm512_load_ps(Bp);
+				const __m512 b1 = _mm512_load_ps(Bp + 16);
+
+				e0 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[0]), b0, e0); o0 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[6]), b1, o0);
+				e1 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[1]), b0, e1); o1 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[7]), b1, o1);
+				e2 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[2]), b0, e2); o2 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[8]), b1, o2);
+				e3 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[3]), b0, e3); o3 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[9]), b1, o3);
+				e4 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[4]), b0, e4); o4 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[10]), b1, o4);
+				e5 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[5]), b0, e5); o5 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[11]), b1, o5);
+
+				Ap += 12;
+				Bp += 32;
+			}
+			if (k < kc)
+			{
+				const __m512 b0 = _mm512_load_ps(Bp);
+				e0 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[0]), b0, e0);
+				e1 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[1]), b0, e1);
+				e2 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[2]), b0, e2);
+				e3 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[3]), b0, e3);
+				e4 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[4]), b0, e4);
+				e5 = _mm512_fmadd_ps(_mm512_set1_ps(Ap[5]), b0, e5);
+			}
+
+			const __m512 c[6] = { _mm512_add_ps(e0, o0), _mm512_add_ps(e1, o1), _mm512_add_ps(e2, o2),
+				_mm512_add_ps(e3, o3), _mm512_add_ps(e4, o4), _mm512_add_ps(e5, o5) };
+
+			if (mr == 6 && nr == 16 && csC == 1)
+			{
+				for (size_t i = 0; i < 6; ++i)
+				{
+					float* row = C + i * rsC;
+					_mm512_storeu_ps(row, _mm512_add_ps(_mm512_loadu_ps(row), c[i]));
+				}
+				return;
+			}
+
+			alignas(64) float tile[6 * 16];
+			for (size_t i = 0; i < 6; ++i) _mm512_store_ps(tile + i * 16, c[i]);
+			addTile(tile, mr, nr, C, rsC, csC);
+		}
+#endif
+
+		template <typename T>
+		using Microkernel = void (*)(size_t kc, const T* Ap, const T* Bp, T* C, ptrdiff_t rsC, ptrdiff_t csC, size_t mr, size_t nr);
+
+		// Picks the microkernel for the active ISA once per gemm call
+		template <typename T>
+		Microkernel<T> selectMicrokernel()
+		{
+#if MG_KERNELS_X86
+			if constexpr (std::is_same_v<T, double> || std::is_same_v<T, float>)
+			{
+				switch (activeIsa())
+				{
+					case Isa::AVX512VNNI:
+					case Isa::AVX512: return static_cast<Microkernel<T>>(&microkernelAvx512);
+					case Isa::AVX2: return static_cast<Microkernel<T>>(&microkernelAvx2);
+					default: break;
+				}
+			}
+#endif
+			return &microkernelScalar<T>;
+		}
+
+		// C = beta * C, treating beta == 0 as an overwrite so NaNs in C don't propagate
+		template <typename T>
+		void scaleC(size_t M, size_t N, T beta, T* C, ptrdiff_t rsC, ptrdiff_t csC)
+		{
+			if (beta == T(1)) return;
+			for (size_t i = 0; i < M; ++i)
+				for (size_t j = 0; j < N; ++j)
+				{
+					T& c = C[i * rsC + j * csC];
+					c = beta == T(0) ? T(0) : beta * c;
+				}
+		}
+
+		// Per-thread packing buffers, reused across calls
+		template <typename T>
+		T* packBuffer(size_t which, size_t count)
+		{
+			thread_local AlignedVector<T, 64> buffers[2];
+			if (buffers[which].size() < count) buffers[which].resize(count);
+			return buffers[which].data();
+		}
+	} // namespace detail
+
+	// Blocked, packed, register-tiled GEMM: C = alpha * A * B + beta * C
+	template <typename T>
+	void gemm(size_t M, size_t N, size_t K, T alpha,
+		const T* A, ptrdiff_t rsA, ptrdiff_t csA,
+		const T* B, ptrdiff_t rsB, ptrdiff_t csB,
+		T beta, T* C, ptrdiff_t rsC, ptrdiff_t csC)
+	{
+		using Blk = GemmBlocking<T>;
+
+		detail::scaleC(M, N, beta, C, rsC, csC);
+		if (M == 0 || N == 0 || K == 0 || alpha == T(0)) return;
+
+		const detail::Microkernel<T> microkernel = detail::selectMicrokernel<T>();
+
+		T* Bp = detail::packBuffer<T>(0, Blk::KC * ((std::min(N, Blk::NC) + Blk::NR - 1) / Blk::NR) * Blk::NR);
+		T* Ap = detail::packBuffer<T>(1, Blk::KC * ((std::min(M, Blk::MC) + Blk::MR - 1) / Blk::MR) * Blk::MR);
+
+		for (size_t jc = 0; jc < N; jc += Blk::NC)
+		{
+			const size_t nc = std::min(Blk::NC, N - jc);
+
+			for (size_t pc = 0; pc < K; pc += Blk::KC)
+			{
+				const size_t kc = std::min(Blk::KC, K - pc);
+				detail::packB(kc, nc, B + pc * rsB + jc * csB, rsB, csB, Bp);
+
+				for (size_t ic = 0; ic < M; ic += Blk::MC)
+				{
+					const size_t mc = std::min(Blk::MC, M - ic);
+					detail::packA(mc, kc, alpha, A + ic * rsA + pc * csA, rsA, csA, Ap);
+
+					for (size_t jr = 0; jr < nc; jr += Blk::NR)
+					{
+						const size_t nr = std::min(Blk::NR, nc - jr);
+						for (size_t ir = 0; ir < mc; ir += Blk::MR)
+						{
+							const size_t mr = std::min(Blk::MR, mc - ir);
+							microkernel(kc, Ap + ir * kc, Bp + jr * kc,
+								C + (ic + ir) * rsC + (jc + jr) * csC, rsC, csC, mr, nr);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Row-major convenience overload: leading dimensions instead of strides
+	template <typename T>
+	void gemm(size_t M, size_t N, size_t K, T alpha, const T* A, size_t lda, const T* B, size_t ldb, T beta, T* C, size_t ldc)
+	{
+		gemm<T>(M, N, K, alpha, A, static_cast<ptrdiff_t>(lda), 1, B, static_cast<ptrdiff_t>(ldb), 1, beta, C, static_cast<ptrdiff_t>(ldc), 1);
+	}
+
+	// Multithreaded GEMM: C = alpha * A * B + beta * C, with C split into 2D tiles of up to
+	// TM x TN that are dispatched to the pool with parallelize_loop, one task per tile.
+	// Each tile is an independent blocked gemm with its own thread_local packing buffers,
+	// so no synchronization is needed beyond waiting for the tiles. Tiles shrink until there
+	// are at least four per thread so uneven edges still balance. Small products run serially.
+	// Must not be called from a task running on the same pool, since it waits on the pool.
+	template <typename T>
+	void gemmParallel(BS::thread_pool& pool, size_t M, size_t N, size_t K, T alpha,
+		const T* A, ptrdiff_t rsA, ptrdiff_t csA,
+		const T* B, ptrdiff_t rsB, ptrdiff_t csB,
+		T beta, T* C, ptrdiff_t rsC, ptrdiff_t csC)
+	{
+		using Blk = GemmBlocking<T>;
+
+		const size_t threads = pool.get_thread_count();
+		if (threads <= 1 || static_cast<double>(M) * N * K < 128.0 * 128.0 * 128.0)
+		{
+			gemm<T>(M, N, K, alpha, A, rsA, csA, B, rsB, csB, beta, C, rsC, csC);
+			return;
+		}
+
+		size_t tm = Blk::TM;
+		size_t tn = Blk::TN;
+		auto tileCount = [&]() { return ((M + tm - 1) / tm) * ((N + tn - 1) / tn); };
+		while (tileCount() < 4 * threads && (tm > Blk::MC || tn > 4 * Blk::NR))
+		{
+			if (tm > Blk::MC && (tm >= tn || tn <= 4 * Blk::NR))
+				tm = std::max(Blk::MC, (tm / 2 + Blk::MR - 1) / Blk::MR * Blk::MR);
+			else
+				tn = std::max(4 * Blk::NR, (tn / 2 + Blk::NR - 1) / Blk::NR * Blk::NR);
+		}
+
+		const size_t tilesN = (N + tn - 1) / tn;
+		const size_t tiles = tileCount();
+
+		pool.parallelize_loop(size_t(0), tiles, [&](size_t first, size_t last)
+		{
+			for (size_t t = first; t < last; ++t)
+			{
+				const size_t i0 = (t / tilesN) * tm;
+				const size_t j0 = (t % tilesN) * tn;
+				gemm<T>(std::min(tm, M - i0), std::min(tn, N - j0), K, alpha,
+					A + i0 * rsA, rsA, csA, B + j0 * csB, rsB, csB,
+					beta, C + i0 * rsC + j0 * csC, rsC, csC);
+			}
+		}, tiles).wait();
+	}
+
+	// Row-major convenience overload: leading dimensions instead of strides
+	template <typename T>
+	void gemmParallel(BS::thread_pool& pool, size_t M, size_t N, size_t K, T alpha, const T* A, size_t lda, const T* B, size_t ldb, T beta, T* C, size_t ldc)
+	{
+		gemmParallel<T>(pool, M, N, K, alpha, A, static_cast<ptrdiff_t>(lda), 1, B, static_cast<ptrdiff_t>(ldb), 1, beta, C, static_cast<ptrdiff_t>(ldc), 1);
+	}
+
+	// Dot product of two contiguous vectors. This generic version is the SSE2 baseline;
+	// the double and float overloads below dispatch to wider variants when available.
+	template <typename T>
+	T dot(size_t n, const T* x, const T* y)
+	{
+		T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+		{
+			s0 += x[i] * y[i];
+			s1 += x[i + 1] * y[i + 1];
+			s2 += x[i + 2] * y[i + 2];
+			s3 += x[i + 3] * y[i + 3];
+		}
+		for (; i < n; ++i) s0 += x[i] * y[i];
+		return (s0 + s1) + (s2 + s3);
+	}
+
+#if MG_KERNELS_X86
+	namespace detail
+	{
+		MG_TARGET_AVX2 inline double dotAvx2(size_t n, const double* x, const double* y)
+		{
+			__m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd(), s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16)
+			{
+				s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+				s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), s1);
+				s2 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 8), _mm256_loadu_pd(y + i + 8), s2);
+				s3 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 12), _mm256_loadu_pd(y + i + 12), s3);
+			}
+			for (; i + 4 <= n; i += 4)
+			{
+				s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+			}
+			__m256d s = _mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3));
+			__m128d h = _mm_add_pd(_mm256_castpd256_pd128(s), _mm256_extractf128_pd(s, 1));
+			double sum = _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+			for (; i < n; ++i) sum += x[i] * y[i];
+			return sum;
+		}
+
+		MG_TARGET_AVX2 inline float dotAvx2(size_t n, const float* x, const float* y)
+		{
+			__m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps(), s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+			size_t i = 0;
+			for (; i + 32 <= n; i += 32)
+			{
+				s0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), s0);
+				s1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8), s1);
+				s2 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 16), _mm256_loadu_ps(y + i + 16), s2);
+				s3 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 24), _mm256_loadu_ps(y + i + 24), s3);
+			}
+			for (; i + 8 <= n; i += 8)
+			{
+				s0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), s0);
+			}
+			__m256 s = _mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3));
+			__m128 h = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+			h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+			h = _mm_add_ss(h, _mm_shuffle_ps(h, h, 1));
+			float sum = _mm_cvtss_f32(h);
+			for (; i < n; ++i) sum += x[i] * y[i];
+			return sum;
+		}
+
+		MG_TARGET_AVX512 inline double dotAvx512(size_t n, const double* x, const double* y)
+		{
+			__m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd(), s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+			size_t i = 0;
+			for (; i + 32 <= n; i += 32)
+			{
+				s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s0);
+				s1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), s1);
+				s2 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 16), _mm512_loadu_pd(y + i + 16), s2);
+				s3 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 24), _mm512_loadu_pd(y + i + 24), s3);
+			}
+			for (; i + 8 <= n; i += 8)
+			{
+				s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s0);
+			}
+			if (i < n)
+			{
+				const __mmask8 m = static_cast<__mmask8>((1u << (n - i)) - 1);
+				s1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, x + i), _mm512_maskz_loadu_pd(m, y + i), s1);
+			}
+			return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+		}
+
+		MG_TARGET_AVX512 inline float dotAvx512(size_t n, const float* x, const float* y)
+		{
+			__m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps(), s2 = _mm512_setzero_ps(), s3 = _mm512_setzero_ps();
+			size_t i = 0;
+			for (; i + 64 <= n; i += 64)
+			{
+				s0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), s0);
+				s1 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16), s1);
+				s2 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 32), _mm512_loadu_ps(y + i + 32), s2);
+				s3 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 48), _mm512_loadu_ps(y + i + 48), s3);
+			}
+			for (; i + 16 <= n; i += 16)
+			{
+				s0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), s0);
+			}
+			if (i < n)
+			{
+				const __mmask16 m = static_cast<__mmask16>((1u << (n - i)) - 1);
+				s1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, y + i), s1);
+			}
+			return _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(s0, s1), _mm512_add_ps(s2, s3)));
+		}
+	} // namespace detail
+
+	inline double dot(size_t n, const double* x, const double* y)
+	{
+		switch (activeIsa())
+		{
+			case Isa::AVX512VNNI:
+			case Isa::AVX512: return detail::dotAvx512(n, x, y);
+			case Isa::AVX2: return detail::dotAvx2(n, x, y);
+			default: return dot<double>(n, x, y);
+		}
+	}
+
+	inline float dot(size_t n, const float* x, const float* y)
+	{
+		switch (activeIsa())
+		{
+			case Isa::AVX512VNNI:
+			case Isa::AVX512: return detail::dotAvx512(n, x, y);
+			case Isa::AVX2: return detail::dotAvx2(n, x, y);
+			default: return dot<float>(n, x, y);
+		}
+	}
+#endif
+
+	// AXPY: y += a * x for contiguous vectors. Like dot, the generic version is the SSE2
+	// baseline and the double and float overloads dispatch.
+	template <typename T>
+	void axpy(size_t n, T a, const T* x, T* y)
+	{
+		for (size_t i = 0; i < n; ++i) y[i] += a * x[i];
+	}
+
+#if MG_KERNELS_X86
+	namespace detail
+	{
+		MG_TARGET_AVX2 inline void axpyAvx2(size_t n, double a, const double* x, double* y)
+		{
+			const __m256d va = _mm256_set1_pd(a);
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8)
+			{
+				_mm256_storeu_pd(y + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+				_mm256_storeu_pd(y + i + 4, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+			}
+			for (; i < n; ++i) y[i] += a * x[i];
+		}
+
+		MG_TARGET_AVX2 inline void axpyAvx2(size_t n, float a, const float* x, float* y)
+		{
+			const __m256 va = _mm256_set1_ps(a);
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16)
+			{
+				_mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+				_mm256_storeu_ps(y + i + 8, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8)));
+			}
+			for (; i < n; ++i) y[i] += a * x[i];
+		}
+
+		MG_TARGET_AVX512 inline void axpyAvx512(size_t n, double a, const double* x, double* y)
+		{
+			const __m512d va = _mm512_set1_pd(a);
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8)
+			{
+				_mm512_storeu_pd(y + i, _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+			}
+			if (i < n)
+			{
+				const __mmask8 m = static_cast<__mmask8>((1u << (n - i)) - 1);
+				_mm512_mask_storeu_pd(y + i, m, _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(m, x + i), _mm512_maskz_loadu_pd(m, y + i)));
+			}
+		}
+
+		MG_TARGET_AVX512 inline void axpyAvx512(size_t n, float a, const float* x, float* y)
+		{
+			const __m512 va = _mm512_set1_ps(a);
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16)
+			{
+				_mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+			}
+			if (i < n)
+			{
+				const __mmask16 m = static_cast<__mmask16>((1u << (n - i)) - 1);
+				_mm512_mask_storeu_ps(y + i, m, _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, y + i)));
+			}
+		}
+	} // namespace detail
+
+	inline void axpy(size_t n, double a, const double* x, double* y)
+	{
+		switch (activeIsa())
+		{
+			case Isa::AVX512VNNI:
+			case Isa::AVX512: detail::axpyAvx512(n, a, x, y); return;
+			case Isa::AVX2: detail::axpyAvx2(n, a, x, y); return;
+			default: axpy<double>(n, a, x, y); return;
+		}
+	}
+
+	inline void axpy(size_t n, float a, const float* x, float* y)
+	{
+		switch (activeIsa())
+		{
+			case Isa::AVX512VNNI:
+			case Isa::AVX512: detail::axpyAvx512(n, a, x, y); return;
+			case Isa::AVX2: detail::axpyAvx2(n, a, x, y); return;
+			default: axpy<float>(n, a, x, y); return;
+		}
+	}
+#endif
+
+	// GEMV: y = alpha * A * x + beta * y for row-major M x K A with leading dimension lda.
+	// Each row is one contiguous dot product, which is the dense-layer forward for one sample.
+	template <typename T>
+	void gemv(size_t M, size_t K, T alpha, const T* A, size_t lda, const T* x, T beta, T* y)
+	{
+		for (size_t i = 0; i < M; ++i)
+		{
+			const T d = dot(K, A + i * lda, x);
+			y[i] = (beta == T(0) ? T(0) : beta * y[i]) + alpha * d;
+		}
+	}
+} // namespace kernels
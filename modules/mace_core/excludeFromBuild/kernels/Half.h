@@ -0,0 +1,258 @@
+#pragma once
+
+// 16-bit floating point weight storage for bandwidth-bound inference.
+//
+// bf16 keeps float's 8-bit exponent and truncates the mantissa to 7 bits, so it has float's
+// range and about 2-3 significant digits. fp16 (IEEE binary16) has a 5-bit exponent and a
+// 10-bit mantissa: more precision, but a range of only about 6e-8 to 65504.
+//
+// Both are storage formats only. Narrowing (float to 16 bits) rounds to nearest even and
+// happens once, when a model is exported. Widening happens on the fly inside the kernels,
+// which accumulate in float: F16C's vcvtph2ps for fp16, a 16-bit shift for bf16.
+
+namespace kernels
+{
+	struct bf16
+	{
+		uint16_t bits = 0;
+	};
+
+	struct fp16
+	{
+		uint16_t bits = 0;
+	};
+
+	inline bf16 toBf16(float f)
+	{
+		const uint32_t x = std::bit_cast<uint32_t>(f);
+		if ((x & 0x7fffffffu) > 0x7f800000u)
+		{
+			return bf16{ static_cast<uint16_t>((x >> 16) | 0x40) }; // keep NaNs quiet NaNs
+		}
+		const uint32_t rounding = 0x7fffu + ((x >> 16) & 1);
+		return bf16{ static_cast<uint16_t>((x + rounding) >> 16) };
+	}
+
+	inline float toFloat(bf16 h)
+	{
+		return std::bit_cast<float>(static_cast<uint32_t>(h.bits) << 16);
+	}
+
+	inline fp16 toFp16(float f)
+	{
+		uint32_t x = std::bit_cast<uint32_t>(f);
+		const uint32_t sign = x & 0x80000000u;
+		x ^= sign;
+
+		uint32_t h;
+		if (x >= 0x47800000u)
+		{
+			// 65536 and above, infinities and NaNs
+			h = x > 0x7f800000u ? 0x7e00u : 0x7c00u;
+		}
+		else if (x < 0x38800000u)
+		{
+			// Below the smallest normal half: adding 0.5 aligns the 10 mantissa bits at the
+			// bottom of the float, and the float addition does the round to nearest even
+			const float aligned = std::bit_cast<float>(x) + 0.5f;
+			h = std::bit_cast<uint32_t>(aligned) - 0x3f000000u;
+		}
+		else
+		{
+			// Rebias the exponent and round the 13 dropped mantissa bits to nearest even.
+			// A carry out of the mantissa correctly bumps the exponent, up to infinity.
+			const uint32_t odd = (x >> 13) & 1;
+			x += 0xc8000fffu + odd;
+			h = x >> 13;
+		}
+		return fp16{ static_cast<uint16_t>(h | (sign >> 16)) };
+	}
+
+	inline float toFloat(fp16 h)
+	{
+		const uint32_t sign = static_cast<uint32_t>(h.bits & 0x8000) << 16;
+		const uint32_t exponent = (h.bits >> 10) & 0x1f;
+		const uint32_t mantissa = h.bits & 0x3ff;
+
+		if (exponent == 0)
+		{
+			// Zero or subnormal: mantissa * 2^-24, exact in float
+			const float v = static_cast<float>(mantissa) * 5.9604644775390625e-8f;
+			return sign ? -v : v;
+		}
+		if (exponent == 31)
+		{
+			return std::bit_cast<float>(sign | 0x7f800000u | (mantissa << 13));
+		}
+		return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+	}
+
+	// Narrowing conversion of an array, used when exporting weights
+	template <typename H>
+	void convert(size_t n, const float* x, H* y)
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			if constexpr (std::is_same_v<H, bf16>) y[i] = toBf16(x[i]);
+			else y[i] = toFp16(x[i]);
+		}
+	}
+
+	namespace detail
+	{
+#if MG_KERNELS_X86
+		template <typename H>
+		MG_TARGET_AVX2 inline __m256 widen8(const H* p)
+		{
+			const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			if constexpr (std::is_same_v<H, bf16>) return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+			else return _mm256_cvtph_ps(h);
+		}
+
+		template <typename H>
+		MG_TARGET_AVX512 inline __m512 widen16(const __m256i h)
+		{
+			if constexpr (std::is_same_v<H, bf16>) return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16));
+			else return _mm512_cvtph_ps(h);
+		}
+
+		template <typename H>
+		MG_TARGET_AVX2 inline void convertAvx2(size_t n, const H* x, float* y)
+		{
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8) _mm256_storeu_ps(y + i, widen8(x + i));
+			for (; i < n; ++i) y[i] = toFloat(x[i]);
+		}
+
+		// Widens the weights as they stream in
+		template <typename H>
+		MG_TARGET_AVX2 inline float dotHalfAvx2(size_t n, const H* w, const float* x)
+		{
+			__m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps(), s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+			size_t i = 0;
+			for (; i + 32 <= n; i += 32)
+			{
+				s0 = _mm256_fmadd_ps(widen8(w + i), _mm256_loadu_ps(x + i), s0);
+				s1 = _mm256_fmadd_ps(widen8(w + i + 8), _mm256_loadu_ps(x + i + 8), s1);
+				s2 = _mm256_fmadd_ps(widen8(w + i + 16), _mm256_loadu_ps(x + i + 16), s2);
+				s3 = _mm256_fmadd_ps(widen8(w + i + 24), _mm256_loadu_ps(x + i + 24), s3);
+			}
+			for (; i + 8 <= n; i += 8)
+			{
+				s0 = _mm256_fmadd_ps(widen8(w + i), _mm256_loadu_ps(x + i), s0);
+			}
+			__m256 s = _mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3));
+			__m128 h = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+			h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+			h = _mm_add_ss(h, _mm_shuffle_ps(h, h, 1));
+			float sum = _mm_cvtss_f32(h);
+			for (; i < n; ++i) sum += toFloat(w[i]) * x[i];
+			return sum;
+		}
+
+		template <typename H>
+		MG_TARGET_AVX512 inline float dotHalfAvx512(size_t n, const H* w, const float* x)
+		{
+			__m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+			size_t i = 0;
+			for (; i + 32 <= n; i += 32)
+			{
+				s0 = _mm512_fmadd_ps(widen16<H>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + i))), _mm512_loadu_ps(x + i), s0);
+				s1 = _mm512_fmadd_ps(widen16<H>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + i + 16))), _mm512_loadu_ps(x + i + 16), s1);
+			}
+			for (; i + 16 <= n; i += 16)
+			{
+				s0 = _mm512_fmadd_ps(widen16<H>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + i))), _mm512_loadu_ps(x + i), s0);
+			}
+			float sum = _mm512_reduce_add_ps(_mm512_add_ps(s0, s1));
+			for (; i < n; ++i) sum += toFloat(w[i]) * x[i];
+			return sum;
+		}
+#endif
+	} // namespace detail
+
+	// Widening conversion of an array
+	template <typename H>
+	void convert(size_t n, const H* x, float* y)
+	{
+#if MG_KERNELS_X86
+		if (activeIsa() >= Isa::AVX2)
+		{
+			detail::convertAvx2(n, x, y);
+			return;
+		}
+#endif
+		for (size_t i = 0; i < n; ++i) y[i] = toFloat(x[i]);
+	}
+
+	// Dot product of 16-bit weights with float inputs, accumulated in float
+	template <typename H>
+	float dotHalf(size_t n, const H* w, const float* x)
+	{
+#if MG_KERNELS_X86
+		if (activeIsa() >= Isa::AVX512) return detail::dotHalfAvx512(n, w, x);
+		if (activeIsa() >= Isa::AVX2) return detail::dotHalfAvx2(n, w, x);
+#endif
+		float sum = 0.0f;
+		for (size_t i = 0; i < n; ++i) sum += toFloat(w[i]) * x[i];
+		return sum;
+	}
+
+	// Dense forward with 16-bit weights: Y = act(X * W^T + b), X, b and Y in float.
+	// Small batches stream each weight row once: a single sample through the widening dot
+	// product, a few samples by widening the row into L1 and reusing it for every sample, so
+	// the weights are read from memory at 2 bytes each. Larger batches widen a block of rows
+	// into a float buffer and run the float GEMM on it, amortizing the conversion.
+	template <typename H>
+	void denseForwardHalf(size_t N, size_t in, size_t out, Activation act,
+		const float* X, size_t ldx, const H* W, size_t ldw, const float* b, float* Y, size_t ldy)
+	{
+		if (N == 1)
+		{
+			for (size_t i = 0; i < out; ++i)
+			{
+				Y[i] = dotHalf(in, W + i * ldw, X) + b[i];
+			}
+		}
+		else if (N < DenseStreamingBatch)
+		{
+			thread_local AlignedVector<float, 64> row;
+			if (row.size() < in) row.resize(in);
+			for (size_t i = 0; i < out; ++i)
+			{
+				convert(in, W + i * ldw, row.data());
+				for (size_t n = 0; n < N; ++n)
+				{
+					Y[n * ldy + i] = dot(in, row.data(), X + n * ldx) + b[i];
+				}
+			}
+		}
+		else
+		{
+			// Rows per block: about 256KB of widened weights
+			const size_t rows = std::clamp<size_t>((size_t(1) << 18) / (in * sizeof(float)), 16, 1024);
+			thread_local AlignedVector<float, 64> block;
+			if (block.size() < rows * in) block.resize(rows * in);
+
+			for (size_t n = 0; n < N; ++n)
+			{
+				std::copy(b, b + out, Y + n * ldy);
+			}
+			for (size_t i0 = 0; i0 < out; i0 += rows)
+			{
+				const size_t rb = std::min(rows, out - i0);
+				for (size_t i = 0; i < rb; ++i)
+				{
+					convert(in, W + (i0 + i) * ldw, block.data() + i * in);
+				}
+				gemm<float>(N, rb, in, 1.0f, X, static_cast<ptrdiff_t>(ldx), 1, block.data(), 1, static_cast<ptrdiff_t>(in),
+					1.0f, Y + i0, static_cast<ptrdiff_t>(ldy), 1);
+			}
+		}
+
+		for (size_t n = 0; n < N; ++n)
+		{
+			applyActivation(act, Y + n * ldy, out);
+		}
+	}
+} // namespace kernels
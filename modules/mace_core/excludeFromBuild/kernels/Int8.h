@@ -0,0 +1,212 @@
+#pragma once
+
+// Int8 kernels for quantized inference.
+//
+// Quantization is symmetric: a real value x is stored as q = round(x / scale) clamped to
+// [-127, 127], so zero is exact and -128 is never produced. Products are accumulated in
+// int32. The widening variants stay in range for K below 2^17 (127 * 127 * K < 2^31), but
+// the VNNI variant accumulates the offset activations, up to 255 * 127 per product, so the
+// common bound is K <= Int8MaxDepth = (2^31 - 1) / (255 * 127) = 66311.
+//
+// gemmS8 dispatches on activeIsa():
+// - AVX2 and AVX512 widen both operands to int16 and use vpmaddwd (16 products per instruction)
+// - AVX512VNNI uses vpdpbusd (64 products per instruction). It multiplies unsigned by signed
+//   bytes, so the activations are offset by 128 into [1, 255] and the offset's contribution,
+//   128 * sum(W row), is subtracted afterwards using the precomputed row sums.
+
+namespace kernels
+{
+	// Deepest K gemmS8 accumulates without overflow on every ISA (see the file comment)
+	constexpr size_t Int8MaxDepth = 66311;
+
+	// q = clamp(round(x / scale), -127, 127), rounding halfway cases to even
+	template <typename T>
+	void quantizeS8(size_t n, const T* x, T scale, int8_t* q)
+	{
+		const T inv = scale > T(0) ? T(1) / scale : T(0);
+		for (size_t i = 0; i < n; ++i)
+		{
+			const T v = std::clamp(x[i] * inv, T(-127), T(127));
+			q[i] = static_cast<int8_t>(std::lrint(v));
+		}
+	}
+
+	// Row sums of an M x K int8 matrix, the correction term the VNNI variant of gemmS8 needs
+	inline void rowSumsS8(size_t M, size_t K, const int8_t* W, size_t ldw, int32_t* sums)
+	{
+		for (size_t i = 0; i < M; ++i)
+		{
+			int32_t s = 0;
+			for (size_t k = 0; k < K; ++k) s += W[i * ldw + k];
+			sums[i] = s;
+		}
+	}
+
+	namespace detail
+	{
+		inline void gemmS8Scalar(size_t N, size_t M, size_t K, const int8_t* X, size_t ldx, const int8_t* W, size_t ldw, int32_t* Y, size_t ldy)
+		{
+			for (size_t n = 0; n < N; ++n)
+			{
+				const int8_t* x = X + n * ldx;
+				for (size_t i = 0; i < M; ++i)
+				{
+					const int8_t* w = W + i * ldw;
+					int32_t s = 0;
+					for (size_t k = 0; k < K; ++k) s += static_cast<int32_t>(x[k]) * w[k];
+					Y[n * ldy + i] = s;
+				}
+			}
+		}
+
+#if MG_KERNELS_X86
+		MG_TARGET_AVX2 inline int32_t hsumEpi32(__m256i v)
+		{
+			__m128i h = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+			h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+			h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_cvtsi128_si32(h);
+		}
+
+		// Four rows of W per pass, so each widened block of x is reused four times
+		MG_TARGET_AVX2 inline void gemmS8Avx2(size_t N, size_t M, size_t K, const int8_t* X, size_t ldx, const int8_t* W, size_t ldw, int32_t* Y, size_t ldy)
+		{
+			const size_t K16 = K & ~size_t(15);
+			for (size_t n = 0; n < N; ++n)
+			{
+				const int8_t* x = X + n * ldx;
+				int32_t* y = Y + n * ldy;
+				size_t i = 0;
+				for (; i + 4 <= M; i += 4)
+				{
+					const int8_t* w0 = W + i * ldw;
+					const int8_t* w1 = w0 + ldw;
+					const int8_t* w2 = w1 + ldw;
+					const int8_t* w3 = w2 + ldw;
+					__m256i a0 = _mm256_setzero_si256(), a1 = _mm256_setzero_si256(), a2 = _mm256_setzero_si256(), a3 = _mm256_setzero_si256();
+					for (size_t k = 0; k < K16; k += 16)
+					{
+						const __m256i xv = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + k)));
+						a0 = _mm256_add_epi32(a0, _mm256_madd_epi16(xv, _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w0 + k)))));
+						a1 = _mm256_add_epi32(a1, _mm256_madd_epi16(xv, _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w1 + k)))));
+						a2 = _mm256_add_epi32(a2, _mm256_madd_epi16(xv, _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w2 + k)))));
+						a3 = _mm256_add_epi32(a3, _mm256_madd_epi16(xv, _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w3 + k)))));
+					}
+					int32_t s0 = hsumEpi32(a0), s1 = hsumEpi32(a1), s2 = hsumEpi32(a2), s3 = hsumEpi32(a3);
+					for (size_t k = K16; k < K; ++k)
+					{
+						s0 += x[k] * w0[k];
+						s1 += x[k] * w1[k];
+						s2 += x[k] * w2[k];
+						s3 += x[k] * w3[k];
+					}
+					y[i] = s0;
+					y[i + 1] = s1;
+					y[i + 2] = s2;
+					y[i + 3] = s3;
+				}
+				for (; i < M; ++i)
+				{
+					const int8_t* w = W + i * ldw;
+					__m256i a = _mm256_setzero_si256();
+					for (size_t k = 0; k < K16; k += 16)
+					{
+						const __m256i xv = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + k)));
+						a = _mm256_add_epi32(a, _mm256_madd_epi16(xv, _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w + k)))));
+					}
+					int32_t s = hsumEpi32(a);
+					for (size_t k = K16; k < K; ++k) s += x[k] * w[k];
+					y[i] = s;
+				}
+			}
+		}
+
+		// Eight floats per step; cvtps rounds to nearest even like lrint, and the clamp happens
+		// before the conversion so the saturating packs never see values outside [-127, 127]
+		MG_TARGET_AVX2 inline void quantizeS8Avx2(size_t n, const float* x, float scale, int8_t* q)
+		{
+			const float inv = scale > 0.0f ? 1.0f / scale : 0.0f;
+			const __m256 vinv = _mm256_set1_ps(inv);
+			const __m256 lo = _mm256_set1_ps(-127.0f), hi = _mm256_set1_ps(127.0f);
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8)
+			{
+				const __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(x + i), vinv), lo), hi);
+				const __m256i d = _mm256_cvtps_epi32(v);
+				const __m128i w = _mm_packs_epi32(_mm256_castsi256_si128(d), _mm256_extracti128_si256(d, 1));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(q + i), _mm_packs_epi16(w, w));
+			}
+			for (; i < n; ++i)
+			{
+				q[i] = static_cast<int8_t>(std::lrint(std::clamp(x[i] * inv, -127.0f, 127.0f)));
+			}
+		}
+
+		// The tail of each row is read with a masked load, which zeroes the lanes past K in
+		// both operands, so no scalar remainder loop is needed
+		MG_TARGET_AVX512VNNI inline void gemmS8Vnni(size_t N, size_t M, size_t K, const int8_t* X, size_t ldx, const int8_t* W, size_t ldw, const int32_t* rowSums, int32_t* Y, size_t ldy)
+		{
+			const __m512i offset = _mm512_set1_epi8(static_cast<char>(0x80));
+			const size_t K64 = K & ~size_t(63);
+			const __mmask64 tail = (K - K64) ? (~__mmask64(0) >> (64 - (K - K64))) : 0;
+
+			for (size_t n = 0; n < N; ++n)
+			{
+				const int8_t* x = X + n * ldx;
+				int32_t* y = Y + n * ldy;
+				for (size_t i = 0; i < M; i += 4)
+				{
+					const size_t rows = std::min<size_t>(4, M - i);
+					const int8_t* w[4];
+					for (size_t r = 0; r < 4; ++r) w[r] = W + (i + (r < rows ? r : 0)) * ldw;
+
+					__m512i a0 = _mm512_setzero_si512(), a1 = _mm512_setzero_si512(), a2 = _mm512_setzero_si512(), a3 = _mm512_setzero_si512();
+					for (size_t k = 0; k < K64; k += 64)
+					{
+						const __m512i xu = _mm512_xor_si512(_mm512_loadu_si512(x + k), offset);
+						a0 = _mm512_dpbusd_epi32(a0, xu, _mm512_loadu_si512(w[0] + k));
+						a1 = _mm512_dpbusd_epi32(a1, xu, _mm512_loadu_si512(w[1] + k));
+						a2 = _mm512_dpbusd_epi32(a2, xu, _mm512_loadu_si512(w[2] + k));
+						a3 = _mm512_dpbusd_epi32(a3, xu, _mm512_loadu_si512(w[3] + k));
+					}
+					if (tail)
+					{
+						const __m512i xu = _mm512_xor_si512(_mm512_maskz_loadu_epi8(tail, x + K64), offset);
+						a0 = _mm512_dpbusd_epi32(a0, xu, _mm512_maskz_loadu_epi8(tail, w[0] + K64));
+						a1 = _mm512_dpbusd_epi32(a1, xu, _mm512_maskz_loadu_epi8(tail, w[1] + K64));
+						a2 = _mm512_dpbusd_epi32(a2, xu, _mm512_maskz_loadu_epi8(tail, w[2] + K64));
+						a3 = _mm512_dpbusd_epi32(a3, xu, _mm512_maskz_loadu_epi8(tail, w[3] + K64));
+					}
+					const int32_t s[4] = { _mm512_reduce_add_epi32(a0), _mm512_reduce_add_epi32(a1), _mm512_reduce_add_epi32(a2), _mm512_reduce_add_epi32(a3) };
+					for (size_t r = 0; r < rows; ++r) y[i + r] = s[r] - 128 * rowSums[i + r];
+				}
+			}
+		}
+#endif
+	} // namespace detail
+
+#if MG_KERNELS_X86
+	inline void quantizeS8(size_t n, const float* x, float scale, int8_t* q)
+	{
+		if (activeIsa() >= Isa::AVX2) detail::quantizeS8Avx2(n, x, scale, q);
+		else quantizeS8<float>(n, x, scale, q);
+	}
+#endif
+
+	// Y (N x M) = X (N x K) * W^T for int8 X and W (W is M x K, one row per output) with
+	// int32 results. rowSums must hold rowSumsS8 of W; only the VNNI variant reads it.
+	// K must not exceed Int8MaxDepth.
+	inline void gemmS8(size_t N, size_t M, size_t K, const int8_t* X, size_t ldx, const int8_t* W, size_t ldw, const int32_t* rowSums, int32_t* Y, size_t ldy)
+	{
+#if MG_KERNELS_X86
+		switch (activeIsa())
+		{
+			case Isa::AVX512VNNI: detail::gemmS8Vnni(N, M, K, X, ldx, W, ldw, rowSums, Y, ldy); return;
+			case Isa::AVX512:
+			case Isa::AVX2: detail::gemmS8Avx2(N, M, K, X, ldx, W, ldw, Y, ldy); return;
+			default: break;
+		}
+#endif
+		detail::gemmS8Scalar(N, M, K, X, ldx, W, ldw, Y, ldy);
+	}
+} // namespace kernels
@@ -0,0 +1,184 @@
+#pragma once
+
+// Layer and batch normalization kernels.
+//
+// Both normalize with y = (x - mean) * rstd * gamma + beta, rstd = 1 / sqrt(var + eps):
+// layer norm over the D features of each row of an N x D batch, batch norm over the N rows
+// of each feature column. The statistics take one pass over the activations with Welford's
+// update, which stays accurate when the mean is large compared to the spread, unlike the
+// sum / sum-of-squares form. Forward saves mean and rstd, and backward needs two passes:
+// one for the two reductions sum(g) and sum(g * xhat), g = dY * gamma, which also yield
+// dgamma and dbeta, and one that writes dX.
+
+namespace kernels
+{
+	namespace detail
+	{
+		// Values reduced per block before merging into the running moments; one block is in L1
+		constexpr size_t NormBlock = 256;
+
+		// Merges the moments (count, mean, M2) of a block into the running ones (Chan et al.)
+		template <typename T>
+		void mergeMoments(T& count, T& mean, T& m2, T blockCount, T blockMean, T blockM2)
+		{
+			const T n = count + blockCount;
+			const T delta = blockMean - mean;
+			mean += delta * blockCount / n;
+			m2 += blockM2 + delta * delta * count * blockCount / n;
+			count = n;
+		}
+
+		// Mean and sum of squared deviations of x[0..n) in one pass over memory: each block
+		// is reduced while it sits in L1, so the inner loops vectorize, and then merged
+		template <typename T>
+		void rowMoments(size_t n, const T* x, T& mean, T& m2)
+		{
+			T count = T(0);
+			mean = T(0);
+			m2 = T(0);
+			for (size_t k0 = 0; k0 < n; k0 += NormBlock)
+			{
+				const size_t len = std::min(NormBlock, n - k0);
+				const T* b = x + k0;
+				T sum = T(0);
+				for (size_t k = 0; k < len; ++k) sum += b[k];
+				const T blockMean = sum / T(len);
+				T blockM2 = T(0);
+				for (size_t k = 0; k < len; ++k) blockM2 += (b[k] - blockMean) * (b[k] - blockMean);
+				mergeMoments(count, mean, m2, T(len), blockMean, blockM2);
+			}
+		}
+	} // namespace detail
+
+	// Layer norm forward over the rows of X (N x D). gamma and beta have D elements;
+	// mean and rstd receive N values each for the backward pass.
+	template <typename T>
+	void layerNormForward(size_t N, size_t D, T eps, const T* X, const T* gamma, const T* beta,
+		T* Y, T* mean, T* rstd)
+	{
+		for (size_t n = 0; n < N; ++n)
+		{
+			const T* x = X + n * D;
+			T* y = Y + n * D;
+			T mu, m2;
+			detail::rowMoments(D, x, mu, m2);
+			const T rs = T(1) / std::sqrt(m2 / T(D) + eps);
+			for (size_t k = 0; k < D; ++k) y[k] = (x[k] - mu) * rs * gamma[k] + beta[k];
+			mean[n] = mu;
+			rstd[n] = rs;
+		}
+	}
+
+	// Layer norm backward. Accumulates into dgamma, dbeta and, if dX is not null, dX.
+	template <typename T>
+	void layerNormBackward(size_t N, size_t D, const T* X, const T* gamma, const T* mean, const T* rstd,
+		const T* dY, T* dX, T* dgamma, T* dbeta)
+	{
+		for (size_t n = 0; n < N; ++n)
+		{
+			const T* x = X + n * D;
+			const T* dy = dY + n * D;
+			const T mu = mean[n], rs = rstd[n];
+
+			T sumG = T(0), sumGX = T(0);
+			for (size_t k = 0; k < D; ++k)
+			{
+				const T xhat = (x[k] - mu) * rs;
+				const T g = dy[k] * gamma[k];
+				sumG += g;
+				sumGX += g * xhat;
+				dgamma[k] += dy[k] * xhat;
+				dbeta[k] += dy[k];
+			}
+			if (!dX) continue;
+
+			// dx = rstd * (g - mean(g) - xhat * mean(g * xhat))
+			const T a = sumG / T(D), c = sumGX / T(D);
+			T* dx = dX + n * D;
+			for (size_t k = 0; k < D; ++k)
+			{
+				const T xhat = (x[k] - mu) * rs;
+				dx[k] += rs * (dy[k] * gamma[k] - a - xhat * c);
+			}
+		}
+	}
+
+	// Batch norm forward with the statistics of the batch itself, over the columns of X
+	// (N x D). mean and rstd receive D values each, and var, if given, the D biased batch
+	// variances; recovering them from rstd as 1 / rstd^2 - eps cancels when var << eps. The
+	// column statistics are updated row by row with Welford's recurrence, which runs across
+	// all columns at once.
+	template <typename T>
+	void batchNormForward(size_t N, size_t D, T eps, const T* X, const T* gamma, const T* beta,
+		T* Y, T* mean, T* rstd, T* var = nullptr)
+	{
+		thread_local AlignedVector<T, 64> m2;
+		m2.assign(D, T(0));
+		std::fill(mean, mean + D, T(0));
+
+		for (size_t n = 0; n < N; ++n)
+		{
+			const T* x = X + n * D;
+			const T inv = T(1) / T(n + 1);
+			for (size_t k = 0; k < D; ++k)
+			{
+				const T delta = x[k] - mean[k];
+				mean[k] += delta * inv;
+				m2[k] += delta * (x[k] - mean[k]);
+			}
+		}
+		for (size_t k = 0; k < D; ++k) rstd[k] = T(1) / std::sqrt(m2[k] / T(N) + eps);
+		if (var)
+		{
+			for (size_t k = 0; k < D; ++k) var[k] = m2[k] / T(N);
+		}
+
+		for (size_t n = 0; n < N; ++n)
+		{
+			const T* x = X + n * D;
+			T* y = Y + n * D;
+			for (size_t k = 0; k < D; ++k) y[k] = (x[k] - mean[k]) * rstd[k] * gamma[k] + beta[k];
+		}
+	}
+
+	// Batch norm backward for batchNormForward. Accumulates into dgamma, dbeta and, if dX is
+	// not null, dX. The reductions run row by row across the columns, like the forward pass.
+	template <typename T>
+	void batchNormBackward(size_t N, size_t D, const T* X, const T* gamma, const T* mean, const T* rstd,
+		const T* dY, T* dX, T* dgamma, T* dbeta)
+	{
+		thread_local AlignedVector<T, 64> sumDY, sumDYX;
+		sumDY.assign(D, T(0));
+		sumDYX.assign(D, T(0));
+
+		for (size_t n = 0; n < N; ++n)
+		{
+			const T* x = X + n * D;
+			const T* dy = dY + n * D;
+			for (size_t k = 0; k < D; ++k)
+			{
+				sumDY[k] += dy[k];
+				sumDYX[k] += dy[k] * (x[k] - mean[k]) * rstd[k];
+			}
+		}
+		for (size_t k = 0; k < D; ++k)
+		{
+			dgamma[k] += sumDYX[k];
+			dbeta[k] += sumDY[k];
+		}
+		if (!dX) return;
+
+		// dx = gamma * rstd * (dy - mean(dy) - xhat * mean(dy * xhat))
+		for (size_t n = 0; n < N; ++n)
+		{
+			const T* x = X + n * D;
+			const T* dy = dY + n * D;
+			T* dx = dX + n * D;
+			for (size_t k = 0; k < D; ++k)
+			{
+				const T xhat = (x[k] - mean[k]) * rstd[k];
+				dx[k] += gamma[k] * rstd[k] * (dy[k] - (sumDY[k] + xhat * sumDYX[k]) / T(N));
+			}
+		}
+	}
+} // namespace kernels
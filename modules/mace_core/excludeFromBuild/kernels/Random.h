@@ -0,0 +1,338 @@
+#pragma once
+
+// Bulk random number generation from the counter-based streams of basics/CounterRng.h.
+//
+// randomBits writes any range of words of a (key, stream) stream. The AVX2 and AVX-512
+// variants run 8 and 16 Philox blocks side by side, one per 32-bit lane, and transpose the
+// results back into stream order, so every variant writes the same words. The fills
+// convert words into numbers the same way RandomStream does:
+//   - fillUniform<double>: element i from words 2i and 2i+1
+//   - fillUniform<float>: element i from word i
+//   - fillNormal: element i from words 4i..4i+3 (Box-Muller, like RandomStream::normal)
+// Since element i depends only on (key, stream, i), filling a range in chunks, in any
+// order or on any number of threads, gives bitwise identical results. The Parallel
+// variants split the range over a thread pool.
+//
+// initWeightsParallel fills a weight matrix for one of the WeightInit schemes. Element
+// (i, j) of an out x in matrix is element i * in + j of its stream whatever the row stride,
+// so padded and unpadded copies of a layer, and any pool size, get the same weights.
+
+// Initialization schemes for a weight matrix with fanIn inputs and fanOut outputs per weight
+enum class WeightInit
+{
+	Uniform,       // uniform in [-1, 1), like generateRandomDouble()
+	XavierUniform, // uniform in [-a, a), a = sqrt(6 / (fanIn + fanOut)), for tanh and sigmoid
+	XavierNormal,  // normal with stddev sqrt(2 / (fanIn + fanOut))
+	HeUniform,     // uniform in [-a, a), a = sqrt(6 / fanIn), for ReLU
+	HeNormal       // normal with stddev sqrt(2 / fanIn)
+};
+
+namespace kernels
+{
+	// Philox blocks per chunk of the fills; the chunk's words stay in L1
+	constexpr size_t RandomChunkBlocks = 256;
+
+	namespace detail
+	{
+		inline void philoxBlocksGeneric(uint64_t key, uint64_t stream, uint64_t first, size_t count, uint32_t* out)
+		{
+			for (size_t b = 0; b < count; ++b)
+			{
+				const CounterRng::Block block = CounterRng::block(key, first + b, stream);
+				std::copy(block.begin(), block.end(), out + 4 * b);
+			}
+		}
+
+#if MG_KERNELS_X86
+		// 32 x 32 -> 64 bit products of all 8 lanes, split into high and low words
+		MG_TARGET_AVX2 inline void mulhiloAvx2(__m256i a, __m256i m, __m256i& hi, __m256i& lo)
+		{
+			const __m256i even = _mm256_mul_epu32(a, m);
+			const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+			lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+			hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+		}
+
+		MG_TARGET_AVX2 inline void philoxBlocksAvx2(uint64_t key, uint64_t stream, uint64_t first, size_t count, uint32_t* out)
+		{
+			const __m256i m0 = _mm256_set1_epi32(static_cast<int>(CounterRng::M0));
+			const __m256i m1 = _mm256_set1_epi32(static_cast<int>(CounterRng::M1));
+			const __m256i w0 = _mm256_set1_epi32(static_cast<int>(CounterRng::W0));
+			const __m256i w1 = _mm256_set1_epi32(static_cast<int>(CounterRng::W1));
+			const __m256i s0 = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream)));
+			const __m256i s1 = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream >> 32)));
+
+			size_t b = 0;
+			for (; b + 8 <= count; b += 8)
+			{
+				alignas(32) uint32_t lo[8], hi[8];
+				for (int k = 0; k < 8; ++k)
+				{
+					const uint64_t counter = first + b + k;
+					lo[k] = static_cast<uint32_t>(counter);
+					hi[k] = static_cast<uint32_t>(counter >> 32);
+				}
+				__m256i c0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(lo));
+				__m256i c1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(hi));
+				__m256i c2 = s0, c3 = s1;
+				__m256i k0 = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(key)));
+				__m256i k1 = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(key >> 32)));
+
+				for (int round = 0; round < 10; ++round)
+				{
+					__m256i hi0, lo0, hi1, lo1;
+					mulhiloAvx2(c0, m0, hi0, lo0);
+					mulhiloAvx2(c2, m1, hi1, lo1);
+					c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), k0);
+					c1 = lo1;
+					c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), k1);
+					c3 = lo0;
+					k0 = _mm256_add_epi32(k0, w0);
+					k1 = _mm256_add_epi32(k1, w1);
+				}
+
+				// Transpose the 4 x 8 lanes back into 8 consecutive blocks
+				const __m256i t0 = _mm256_unpacklo_epi32(c0, c1), t1 = _mm256_unpackhi_epi32(c0, c1);
+				const __m256i t2 = _mm256_unpacklo_epi32(c2, c3), t3 = _mm256_unpackhi_epi32(c2, c3);
+				const __m256i u0 = _mm256_unpacklo_epi64(t0, t2), u1 = _mm256_unpackhi_epi64(t0, t2);
+				const __m256i u2 = _mm256_unpacklo_epi64(t1, t3), u3 = _mm256_unpackhi_epi64(t1, t3);
+				__m256i* dst = reinterpret_cast<__m256i*>(out + 4 * b);
+				_mm256_storeu_si256(dst, _mm256_permute2x128_si256(u0, u1, 0x20));
+				_mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(u2, u3, 0x20));
+				_mm256_storeu_si256(dst + 2, _mm256_permute2x128_si256(u0, u1, 0x31));
+				_mm256_storeu_si256(dst + 3, _mm256_permute2x128_si256(u2, u3, 0x31));
+			}
+			philoxBlocksGeneric(key, stream, first + b, count - b, out + 4 * b);
+		}
+
+		MG_TARGET_AVX512 inline void mulhiloAvx512(__m512i a, __m512i m, __m512i& hi, __m512i& lo)
+		{
+			const __m512i even = _mm512_mul_epu32(a, m);
+			const __m512i odd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), m);
+			lo = _mm512_mask_blend_epi32(0xAAAA, even, _mm512_slli_epi64(odd, 32));
+			hi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, 32), odd);
+		}
+
+		MG_TARGET_AVX512 inline void philoxBlocksAvx512(uint64_t key, uint64_t stream, uint64_t first, size_t count, uint32_t* out)
+		{
+			const __m512i m0 = _mm512_set1_epi32(static_cast<int>(CounterRng::M0));
+			const __m512i m1 = _mm512_set1_epi32(static_cast<int>(CounterRng::M1));
+			const __m512i w0 = _mm512_set1_epi32(static_cast<int>(CounterRng::W0));
+			const __m512i w1 = _mm512_set1_epi32(static_cast<int>(CounterRng::W1));
+			const __m512i s0 = _mm512_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream)));
+			const __m512i s1 = _mm512_set1_epi32(static_cast<int>(static_cast<uint32_t>(stream >> 32)));
+
+			size_t b = 0;
+			for (; b + 16 <= count; b += 16)
+			{
+				alignas(64) uint32_t lo[16], hi[16];
+				for (int k = 0; k < 16; ++k)
+				{
+					const uint64_t counter = first + b + k;
+					lo[k] = static_cast<uint32_t>(counter);
+					hi[k] = static_cast<uint32_t>(counter >> 32);
+				}
+				__m512i c0 = _mm512_load_si512(lo);
+				__m512i c1 = _mm512_load_si512(hi);
+				__m512i c2 = s0, c3 = s1;
+				__m512i k0 = _mm512_set1_epi32(static_cast<int>(static_cast<uint32_t>(key)));
+				__m512i k1 = _mm512_set1_epi32(static_cast<int>(static_cast<uint32_t>(key >> 32)));
+
+				for (int round = 0; round < 10; ++round)
+				{
+					__m512i hi0, lo0, hi1, lo1;
+					mulhiloAvx512(c0, m0, hi0, lo0);
+					mulhiloAvx512(c2, m1, hi1, lo1);
+					c0 = _mm512_xor_si512(_mm512_xor_si512(hi1, c1), k0);
+					c1 = lo1;
+					c2 = _mm512_xor_si512(_mm512_xor_si512(hi0, c3), k1);
+					c3 = lo0;
+					k0 = _mm512_add_epi32(k0, w0);
+					k1 = _mm512_add_epi32(k1, w1);
+				}
+
+				// After the unpacks, 128-bit lane L of u[j] holds block 4L + j
+				const __m512i t0 = _mm512_unpacklo_epi32(c0, c1), t1 = _mm512_unpackhi_epi32(c0, c1);
+				const __m512i t2 = _mm512_unpacklo_epi32(c2, c3), t3 = _mm512_unpackhi_epi32(c2, c3);
+				const __m512i u[4] = { _mm512_unpacklo_epi64(t0, t2), _mm512_unpackhi_epi64(t0, t2),
+					_mm512_unpacklo_epi64(t1, t3), _mm512_unpackhi_epi64(t1, t3) };
+				uint32_t* dst = out + 4 * b;
+				for (int j = 0; j < 4; ++j)
+				{
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * j), _mm512_extracti32x4_epi32(u[j], 0));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * (4 + j)), _mm512_extracti32x4_epi32(u[j], 1));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * (8 + j)), _mm512_extracti32x4_epi32(u[j], 2));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * (12 + j)), _mm512_extracti32x4_epi32(u[j], 3));
+				}
+			}
+			philoxBlocksGeneric(key, stream, first + b, count - b, out + 4 * b);
+		}
+#endif
+
+		// count consecutive Philox blocks starting at block 'first', in stream order
+		inline void philoxBlocks(uint64_t key, uint64_t stream, uint64_t first, size_t count, uint32_t* out)
+		{
+#if MG_KERNELS_X86
+			switch (activeIsa())
+			{
+				case Isa::AVX512VNNI:
+				case Isa::AVX512: philoxBlocksAvx512(key, stream, first, count, out); return;
+				case Isa::AVX2: philoxBlocksAvx2(key, stream, first, count, out); return;
+				default: break;
+			}
+#endif
+			philoxBlocksGeneric(key, stream, first, count, out);
+		}
+	} // namespace detail
+
+	// Words offset..offset+n-1 of the stream (key, stream)
+	inline void randomBits(uint64_t key, uint64_t stream, uint64_t offset, size_t n, uint32_t* out)
+	{
+		size_t i = 0;
+
+		// A partial block up front, whole blocks straight into out, a partial block at the end
+		if ((offset & 3) && n > 0)
+		{
+			const CounterRng::Block block = CounterRng::block(key, offset >> 2, stream);
+			for (size_t lane = offset & 3; lane < 4 && i < n; ++lane) out[i++] = block[lane];
+		}
+		const size_t whole = (n - i) / 4;
+		detail::philoxBlocks(key, stream, (offset + i) >> 2, whole, out + i);
+		i += 4 * whole;
+		if (i < n)
+		{
+			const CounterRng::Block block = CounterRng::block(key, (offset + i) >> 2, stream);
+			for (size_t lane = 0; i < n; ++lane) out[i++] = block[lane];
+		}
+	}
+
+	namespace detail
+	{
+		// Calls convert(i, words of element i) for n elements from 'first', wordsPer words each
+		template <typename F>
+		void forEachRandomElement(uint64_t key, uint64_t stream, uint64_t first, size_t n, size_t wordsPer, F&& convert)
+		{
+			thread_local AlignedVector<uint32_t, 64> words;
+			const size_t chunk = 4 * RandomChunkBlocks / wordsPer;
+			words.resize(chunk * wordsPer);
+			for (size_t i0 = 0; i0 < n; i0 += chunk)
+			{
+				const size_t len = std::min(chunk, n - i0);
+				randomBits(key, stream, (first + i0) * wordsPer, len * wordsPer, words.data());
+				for (size_t i = 0; i < len; ++i) convert(i0 + i, words.data() + i * wordsPer);
+			}
+		}
+	} // namespace detail
+
+	// Uniform numbers in [lower, upper): out[i] is element offset + i of the stream
+	template <typename T>
+	void fillUniform(size_t n, T* out, T lower, T upper, uint64_t key, uint64_t stream, uint64_t offset = 0)
+	{
+		const T span = upper - lower;
+		if constexpr (std::is_same_v<T, float>)
+		{
+			detail::forEachRandomElement(key, stream, offset, n, 1, [&](size_t i, const uint32_t* w)
+			{
+				out[i] = lower + span * unitFloat(w[0]);
+			});
+		}
+		else
+		{
+			detail::forEachRandomElement(key, stream, offset, n, 2, [&](size_t i, const uint32_t* w)
+			{
+				out[i] = static_cast<T>(lower + span * unitDouble(w[0], w[1]));
+			});
+		}
+	}
+
+	// Normally distributed numbers: out[i] is element offset + i of the stream
+	template <typename T>
+	void fillNormal(size_t n, T* out, T mean, T stddev, uint64_t key, uint64_t stream, uint64_t offset = 0)
+	{
+		detail::forEachRandomElement(key, stream, offset, n, 4, [&](size_t i, const uint32_t* w)
+		{
+			const double u1 = unitDouble(w[0], w[1]);
+			const double u2 = unitDouble(w[2], w[3]);
+			const double z = std::sqrt(-2.0 * std::log(1.0 - u1)) * std::cos(6.283185307179586 * u2);
+			out[i] = static_cast<T>(mean + stddev * z);
+		});
+	}
+
+	namespace detail
+	{
+		// Splits [0, n) into ranges of at least 'grain' elements over the pool
+		template <typename F>
+		void parallelRanges(BS::thread_pool& pool, size_t n, size_t grain, F&& fill)
+		{
+			const size_t threads = pool.get_thread_count();
+			if (threads <= 1 || n < 2 * grain)
+			{
+				fill(size_t(0), n);
+				return;
+			}
+			const size_t parts = std::min(4 * threads, n / grain);
+			pool.parallelize_loop(size_t(0), parts, [&](size_t firstPart, size_t lastPart)
+			{
+				for (size_t part = firstPart; part < lastPart; ++part)
+				{
+					fill(n * part / parts, n * (part + 1) / parts);
+				}
+			}, parts).wait();
+		}
+	} // namespace detail
+
+	// fillUniform over a thread pool; bitwise identical to the serial call for any pool size
+	template <typename T>
+	void fillUniformParallel(BS::thread_pool& pool, size_t n, T* out, T lower, T upper, uint64_t key, uint64_t stream, uint64_t offset = 0)
+	{
+		detail::parallelRanges(pool, n, 16384, [&](size_t first, size_t last)
+		{
+			fillUniform<T>(last - first, out + first, lower, upper, key, stream, offset + first);
+		});
+	}
+
+	// fillNormal over a thread pool; bitwise identical to the serial call for any pool size
+	template <typename T>
+	void fillNormalParallel(BS::thread_pool& pool, size_t n, T* out, T mean, T stddev, uint64_t key, uint64_t stream, uint64_t offset = 0)
+	{
+		detail::parallelRanges(pool, n, 4096, [&](size_t first, size_t last)
+		{
+			fillNormal<T>(last - first, out + first, mean, stddev, key, stream, offset + first);
+		});
+	}
+
+	// Stream of parameter tensor 'index' of a model, e.g. its layer number
+	inline uint64_t weightStream(uint64_t index)
+	{
+		return streamId(0x77656967687473ull, index);
+	}
+
+	// Fills the out x in matrix W (row stride ld) for the scheme, rows split over the pool.
+	// The result depends only on (key, stream), not on the pool size or ld.
+	template <typename T>
+	void initWeightsParallel(BS::thread_pool& pool, WeightInit scheme, size_t out, size_t in, T* W, size_t ld,
+		uint64_t key, uint64_t stream)
+	{
+		const double fanIn = static_cast<double>(in), fanOut = static_cast<double>(out);
+		double bound = 1.0, stddev = 0.0;
+		switch (scheme)
+		{
+			case WeightInit::XavierUniform: bound = std::sqrt(6.0 / (fanIn + fanOut)); break;
+			case WeightInit::XavierNormal: stddev = std::sqrt(2.0 / (fanIn + fanOut)); break;
+			case WeightInit::HeUniform: bound = std::sqrt(6.0 / fanIn); break;
+			case WeightInit::HeNormal: stddev = std::sqrt(2.0 / fanIn); break;
+			default: break;
+		}
+		const bool normal = scheme == WeightInit::XavierNormal || scheme == WeightInit::HeNormal;
+
+		const size_t grain = std::max<size_t>(1, 16384 / std::max<size_t>(in, 1));
+		detail::parallelRanges(pool, out, grain, [&](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; ++i)
+			{
+				if (normal) fillNormal<T>(in, W + i * ld, T(0), T(stddev), key, stream, i * in);
+				else fillUniform<T>(in, W + i * ld, T(-bound), T(bound), key, stream, i * in);
+			}
+		});
+	}
+} // namespace kernels
@@ -0,0 +1,255 @@
+#pragma once
+
+// Fused LSTM and GRU kernels over a window of timesteps.
+//
+// Conventions: a window is time-major, X is steps x N x in (one N x in block per timestep)
+// and the hidden outputs Y are steps x N x H. The input projection X * Wx^T does not depend
+// on the recurrence, so it runs as one GEMM over all steps * N rows up front; each timestep
+// then needs one N x H by H x G GEMM for the recurrent projection and one fused pass that
+// applies every gate nonlinearity and the state update. Backward walks the window in
+// reverse, carrying only the gradient of the state, and defers the weight gradients to
+// three GEMMs over the whole window.
+//
+// Gradients stop at the start of the window: the initial state is treated as a constant,
+// which is truncated backpropagation through time with the window as the truncation length.
+
+namespace kernels
+{
+	// LSTM, gate order i, f, g, o (G = 4H):
+	//   a = x Wx^T + h Wh^T + b
+	//   i = sigmoid(a_i), f = sigmoid(a_f), g = tanh(a_g), o = sigmoid(a_o)
+	//   c' = f * c + i * g, h' = o * tanh(c')
+	// gates (steps x N x 4H) receives the gate activations and C (steps x N x H) the cell
+	// states, both needed by lstmBackward. h0 and c0 are the N x H initial state.
+	template <typename T>
+	void lstmForward(size_t steps, size_t N, size_t in, size_t H,
+		const T* X, const T* Wx, const T* Wh, const T* b, const T* h0, const T* c0,
+		T* Y, T* gates, T* C)
+	{
+		const size_t G = 4 * H, rows = steps * N;
+		if (rows == 0 || H == 0) return;
+
+		// Input projection of every step at once
+		for (size_t r = 0; r < rows; ++r) std::copy(b, b + G, gates + r * G);
+		gemm<T>(rows, G, in, T(1), X, static_cast<ptrdiff_t>(in), 1, Wx, 1, static_cast<ptrdiff_t>(in), T(1), gates, static_cast<ptrdiff_t>(G), 1);
+
+		for (size_t t = 0; t < steps; ++t)
+		{
+			const T* hp = t ? Y + (t - 1) * N * H : h0;
+			const T* cp = t ? C + (t - 1) * N * H : c0;
+			T* a = gates + t * N * G;
+			T* c = C + t * N * H;
+			T* h = Y + t * N * H;
+
+			gemm<T>(N, G, H, T(1), hp, static_cast<ptrdiff_t>(H), 1, Wh, 1, static_cast<ptrdiff_t>(H), T(1), a, static_cast<ptrdiff_t>(G), 1);
+			for (size_t n = 0; n < N; ++n)
+			{
+				T* an = a + n * G;
+				vsigmoid(2 * H, an, an);
+				vtanh(H, an + 2 * H, an + 2 * H);
+				vsigmoid(H, an + 3 * H, an + 3 * H);
+
+				const T* cpn = cp + n * H;
+				T* cn = c + n * H;
+				T* hn = h + n * H;
+				for (size_t k = 0; k < H; ++k) cn[k] = an[H + k] * cpn[k] + an[k] * an[2 * H + k];
+				vtanh(H, cn, hn);
+				for (size_t k = 0; k < H; ++k) hn[k] *= an[3 * H + k];
+			}
+		}
+	}
+
+	// Backward of lstmForward over the window, given dY (steps x N x H). Accumulates into
+	// dWx, dWh, db and, if dX is not null, dX.
+	template <typename T>
+	void lstmBackward(size_t steps, size_t N, size_t in, size_t H,
+		const T* X, const T* Wx, const T* Wh, const T* h0, const T* c0,
+		const T* Y, const T* gates, const T* C, const T* dY,
+		T* dWx, T* dWh, T* db, T* dX)
+	{
+		const size_t G = 4 * H, rows = steps * N;
+		if (rows == 0 || H == 0) return;
+
+		thread_local AlignedVector<T, 64> dA, dh, dc, tc;
+		dA.resize(rows * G);
+		dh.assign(N * H, T(0)); // gradient flowing into h from the next step
+		dc.assign(N * H, T(0)); // gradient flowing into c from the next step
+		tc.resize(H);
+
+		for (size_t t = steps; t-- > 0;)
+		{
+			const T* cp = t ? C + (t - 1) * N * H : c0;
+			for (size_t n = 0; n < N; ++n)
+			{
+				const T* a = gates + (t * N + n) * G;
+				const T* c = C + (t * N + n) * H;
+				const T* dy = dY + (t * N + n) * H;
+				const T* cpn = cp + n * H;
+				T* d = dA.data() + (t * N + n) * G;
+				T* dhn = dh.data() + n * H;
+				T* dcn = dc.data() + n * H;
+
+				vtanh(H, c, tc.data());
+				for (size_t k = 0; k < H; ++k)
+				{
+					const T i = a[k], f = a[H + k], g = a[2 * H + k], o = a[3 * H + k];
+					const T dhk = dy[k] + dhn[k];
+					const T dck = dhk * o * (T(1) - tc[k] * tc[k]) + dcn[k];
+					d[k] = dck * g * i * (T(1) - i);
+					d[H + k] = dck * cpn[k] * f * (T(1) - f);
+					d[2 * H + k] = dck * i * (T(1) - g * g);
+					d[3 * H + k] = dhk * tc[k] * o * (T(1) - o);
+					dcn[k] = dck * f;
+				}
+			}
+			// dh for the previous step = dA_t * Wh
+			gemm<T>(N, H, G, T(1), dA.data() + t * N * G, static_cast<ptrdiff_t>(G), 1, Wh, static_cast<ptrdiff_t>(H), 1,
+				T(0), dh.data(), static_cast<ptrdiff_t>(H), 1);
+		}
+
+		// Weight gradients for the whole window: dWx += dA^T X, dWh += dA^T Hprev, db += colsum(dA)
+		gemm<T>(G, in, rows, T(1), dA.data(), 1, static_cast<ptrdiff_t>(G), X, static_cast<ptrdiff_t>(in), 1,
+			T(1), dWx, static_cast<ptrdiff_t>(in), 1);
+		gemm<T>(G, H, N, T(1), dA.data(), 1, static_cast<ptrdiff_t>(G), h0, static_cast<ptrdiff_t>(H), 1,
+			T(1), dWh, static_cast<ptrdiff_t>(H), 1);
+		if (steps > 1)
+		{
+			gemm<T>(G, H, rows - N, T(1), dA.data() + N * G, 1, static_cast<ptrdiff_t>(G), Y, static_cast<ptrdiff_t>(H), 1,
+				T(1), dWh, static_cast<ptrdiff_t>(H), 1);
+		}
+		for (size_t r = 0; r < rows; ++r)
+		{
+			for (size_t k = 0; k < G; ++k) db[k] += dA[r * G + k];
+		}
+		if (dX)
+		{
+			gemm<T>(rows, in, G, T(1), dA.data(), static_cast<ptrdiff_t>(G), 1, Wx, static_cast<ptrdiff_t>(in), 1,
+				T(1), dX, static_cast<ptrdiff_t>(in), 1);
+		}
+	}
+
+	// GRU, gate order r, z, n (G = 3H), with separate input and hidden biases:
+	//   ax = x Wx^T + bx, ah = h Wh^T + bh
+	//   r = sigmoid(ax_r + ah_r), z = sigmoid(ax_z + ah_z), n = tanh(ax_n + r * ah_n)
+	//   h' = (1 - z) * n + z * h
+	// gates (steps x N x 3H) receives r, z, n and hn (steps x N x H) the ah_n term, both
+	// needed by gruBackward.
+	template <typename T>
+	void gruForward(size_t steps, size_t N, size_t in, size_t H,
+		const T* X, const T* Wx, const T* Wh, const T* bx, const T* bh, const T* h0,
+		T* Y, T* gates, T* hn)
+	{
+		const size_t G = 3 * H, rows = steps * N;
+		if (rows == 0 || H == 0) return;
+
+		for (size_t r = 0; r < rows; ++r) std::copy(bx, bx + G, gates + r * G);
+		gemm<T>(rows, G, in, T(1), X, static_cast<ptrdiff_t>(in), 1, Wx, 1, static_cast<ptrdiff_t>(in), T(1), gates, static_cast<ptrdiff_t>(G), 1);
+
+		thread_local AlignedVector<T, 64> ah;
+		ah.resize(N * G);
+		for (size_t t = 0; t < steps; ++t)
+		{
+			const T* hp = t ? Y + (t - 1) * N * H : h0;
+			T* a = gates + t * N * G;
+			T* h = Y + t * N * H;
+
+			for (size_t n = 0; n < N; ++n) std::copy(bh, bh + G, ah.data() + n * G);
+			gemm<T>(N, G, H, T(1), hp, static_cast<ptrdiff_t>(H), 1, Wh, 1, static_cast<ptrdiff_t>(H), T(1), ah.data(), static_cast<ptrdiff_t>(G), 1);
+			for (size_t n = 0; n < N; ++n)
+			{
+				T* an = a + n * G;
+				const T* ahn = ah.data() + n * G;
+				T* hnn = hn + (t * N + n) * H;
+				for (size_t k = 0; k < 2 * H; ++k) an[k] += ahn[k];
+				vsigmoid(2 * H, an, an);
+				for (size_t k = 0; k < H; ++k)
+				{
+					hnn[k] = ahn[2 * H + k];
+					an[2 * H + k] += an[k] * hnn[k];
+				}
+				vtanh(H, an + 2 * H, an + 2 * H);
+
+				const T* hpn = hp + n * H;
+				T* hk = h + n * H;
+				for (size_t k = 0; k < H; ++k)
+				{
+					const T z = an[H + k];
+					hk[k] = (T(1) - z) * an[2 * H + k] + z * hpn[k];
+				}
+			}
+		}
+	}
+
+	// Backward of gruForward over the window, given dY (steps x N x H). Accumulates into
+	// dWx, dWh, dbx, dbh and, if dX is not null, dX.
+	template <typename T>
+	void gruBackward(size_t steps, size_t N, size_t in, size_t H,
+		const T* X, const T* Wx, const T* Wh, const T* h0,
+		const T* Y, const T* gates, const T* hn, const T* dY,
+		T* dWx, T* dWh, T* dbx, T* dbh, T* dX)
+	{
+		const size_t G = 3 * H, rows = steps * N;
+		if (rows == 0 || H == 0) return;
+
+		// Gradients of the input and hidden pre-activations; they differ only in the n gate
+		thread_local AlignedVector<T, 64> dAx, dAh, dh;
+		dAx.resize(rows * G);
+		dAh.resize(rows * G);
+		dh.assign(N * H, T(0));
+
+		for (size_t t = steps; t-- > 0;)
+		{
+			const T* hp = t ? Y + (t - 1) * N * H : h0;
+			for (size_t n = 0; n < N; ++n)
+			{
+				const size_t row = t * N + n;
+				const T* a = gates + row * G;
+				const T* hnn = hn + row * H;
+				const T* dy = dY + row * H;
+				const T* hpn = hp + n * H;
+				T* dx = dAx.data() + row * G;
+				T* dhh = dAh.data() + row * G;
+				T* dhn = dh.data() + n * H;
+
+				for (size_t k = 0; k < H; ++k)
+				{
+					const T r = a[k], z = a[H + k], nn = a[2 * H + k];
+					const T dhk = dy[k] + dhn[k];
+					const T dan = dhk * (T(1) - z) * (T(1) - nn * nn);
+					const T daz = dhk * (hpn[k] - nn) * z * (T(1) - z);
+					const T dar = dan * hnn[k] * r * (T(1) - r);
+					dx[k] = dhh[k] = dar;
+					dx[H + k] = dhh[H + k] = daz;
+					dx[2 * H + k] = dan;
+					dhh[2 * H + k] = dan * r;
+					dhn[k] = dhk * z; // the direct path; the recurrent GEMM is added below
+				}
+			}
+			gemm<T>(N, H, G, T(1), dAh.data() + t * N * G, static_cast<ptrdiff_t>(G), 1, Wh, static_cast<ptrdiff_t>(H), 1,
+				T(1), dh.data(), static_cast<ptrdiff_t>(H), 1);
+		}
+
+		gemm<T>(G, in, rows, T(1), dAx.data(), 1, static_cast<ptrdiff_t>(G), X, static_cast<ptrdiff_t>(in), 1,
+			T(1), dWx, static_cast<ptrdiff_t>(in), 1);
+		gemm<T>(G, H, N, T(1), dAh.data(), 1, static_cast<ptrdiff_t>(G), h0, static_cast<ptrdiff_t>(H), 1,
+			T(1), dWh, static_cast<ptrdiff_t>(H), 1);
+		if (steps > 1)
+		{
+			gemm<T>(G, H, rows - N, T(1), dAh.data() + N * G, 1, static_cast<ptrdiff_t>(G), Y, static_cast<ptrdiff_t>(H), 1,
+				T(1), dWh, static_cast<ptrdiff_t>(H), 1);
+		}
+		for (size_t r = 0; r < rows; ++r)
+		{
+			for (size_t k = 0; k < G; ++k)
+			{
+				dbx[k] += dAx[r * G + k];
+				dbh[k] += dAh[r * G + k];
+			}
+		}
+		if (dX)
+		{
+			gemm<T>(rows, in, G, T(1), dAx.data(), static_cast<ptrdiff_t>(G), 1, Wx, static_cast<ptrdiff_t>(in), 1,
+				T(1), dX, static_cast<ptrdiff_t>(in), 1);
+		}
+	}
+} // namespace kernels
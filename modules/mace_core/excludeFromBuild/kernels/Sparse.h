@@ -0,0 +1,331 @@
+#pragma once
+
+// Sparse dense-layer kernels: the weight matrix W (out x in, one row per neuron) is stored in
+// CSR form, so the cost is proportional to the number of nonzero weights instead of out * in.
+//
+// Same conventions as Dense.h: a batch of N samples is row-major, X is N x in and
+// Y = act(X * W^T + b) is N x out. For N > 1 the kernels work on transposed copies of X
+// and of the output, with the batch padded to a multiple of 16 samples, so every nonzero
+// weight becomes a few full-width vector FMAs over the batch instead of N scattered
+// accesses. The forward keeps a row's accumulators in registers across all its nonzeros.
+
+namespace kernels
+{
+	template <typename T>
+	struct CsrMatrix
+	{
+		size_t rows = 0;
+		size_t cols = 0;
+		std::vector<uint32_t> rowStart; // rows + 1 offsets into columns and values
+		std::vector<uint32_t> columns;
+		AlignedVector<T> values;
+
+		size_t nonZeros() const { return values.size(); }
+		double density() const { return rows && cols ? static_cast<double>(values.size()) / (rows * cols) : 0.0; }
+	};
+
+	// Builds the CSR form of a dense row-major matrix, keeping the entries that are not zero
+	template <typename T>
+	CsrMatrix<T> toCsr(size_t rows, size_t cols, const T* W, size_t ldw)
+	{
+		CsrMatrix<T> m;
+		m.rows = rows;
+		m.cols = cols;
+		m.rowStart.reserve(rows + 1);
+		m.rowStart.push_back(0);
+		for (size_t i = 0; i < rows; ++i)
+		{
+			for (size_t j = 0; j < cols; ++j)
+			{
+				if (W[i * ldw + j] != T(0))
+				{
+					m.columns.push_back(static_cast<uint32_t>(j));
+					m.values.push_back(W[i * ldw + j]);
+				}
+			}
+			m.rowStart.push_back(static_cast<uint32_t>(m.values.size()));
+		}
+		return m;
+	}
+
+	// dst (cols x rows, ldd) = src^T for a row-major rows x cols src (lds)
+	template <typename T>
+	void transpose(size_t rows, size_t cols, const T* src, size_t lds, T* dst, size_t ldd)
+	{
+		constexpr size_t B = 32;
+		for (size_t i0 = 0; i0 < rows; i0 += B)
+		{
+			for (size_t j0 = 0; j0 < cols; j0 += B)
+			{
+				const size_t i1 = std::min(rows, i0 + B), j1 = std::min(cols, j0 + B);
+				for (size_t i = i0; i < i1; ++i)
+					for (size_t j = j0; j < j1; ++j)
+						dst[j * ldd + i] = src[i * lds + j];
+			}
+		}
+	}
+
+	// Samples in the transposed batch buffers are padded to a multiple of this
+	constexpr size_t SparseBatchPad = 16;
+
+	// y[0, ld) = bias + sum over the row's nonzeros of value * xt[column * ld + n].
+	// This generic version is the SSE2 baseline.
+	template <typename T>
+	void sparseRow(uint32_t begin, uint32_t end, const uint32_t* cols, const T* vals, const T* xt, size_t ld, T bias, T* y)
+	{
+		for (size_t n0 = 0; n0 < ld; n0 += SparseBatchPad)
+		{
+			T acc[SparseBatchPad];
+			for (size_t n = 0; n < SparseBatchPad; ++n) acc[n] = bias;
+			for (uint32_t k = begin; k < end; ++k)
+			{
+				const T v = vals[k];
+				const T* x = xt + cols[k] * ld + n0;
+				for (size_t n = 0; n < SparseBatchPad; ++n) acc[n] += v * x[n];
+			}
+			std::copy(acc, acc + SparseBatchPad, y + n0);
+		}
+	}
+
+#if MG_KERNELS_X86
+	namespace detail
+	{
+		MG_TARGET_AVX2 inline void sparseRowAvx2(uint32_t begin, uint32_t end, const uint32_t* cols, const double* vals, const double* xt, size_t ld, double bias, double* y)
+		{
+			for (size_t n0 = 0; n0 < ld; n0 += 16)
+			{
+				__m256d a0 = _mm256_set1_pd(bias), a1 = a0, a2 = a0, a3 = a0;
+				for (uint32_t k = begin; k < end; ++k)
+				{
+					const __m256d v = _mm256_set1_pd(vals[k]);
+					const double* x = xt + cols[k] * ld + n0;
+					a0 = _mm256_fmadd_pd(v, _mm256_load_pd(x), a0);
+					a1 = _mm256_fmadd_pd(v, _mm256_load_pd(x + 4), a1);
+					a2 = _mm256_fmadd_pd(v, _mm256_load_pd(x + 8), a2);
+					a3 = _mm256_fmadd_pd(v, _mm256_load_pd(x + 12), a3);
+				}
+				_mm256_store_pd(y + n0, a0);
+				_mm256_store_pd(y + n0 + 4, a1);
+				_mm256_store_pd(y + n0 + 8, a2);
+				_mm256_store_pd(y + n0 + 12, a3);
+			}
+		}
+
+		MG_TARGET_AVX2 inline void sparseRowAvx2(uint32_t begin, uint32_t end, const uint32_t* cols, const float* vals, const float* xt, size_t ld, float bias, float* y)
+		{
+			for (size_t n0 = 0; n0 < ld; n0 += 16)
+			{
+				__m256 a0 = _mm256_set1_ps(bias), a1 = a0;
+				for (uint32_t k = begin; k < end; ++k)
+				{
+					const __m256 v = _mm256_set1_ps(vals[k]);
+					const float* x = xt + cols[k] * ld + n0;
+					a0 = _mm256_fmadd_ps(v, _mm256_load_ps(x), a0);
+					a1 = _mm256_fmadd_ps(v, _mm256_load_ps(x + 8), a1);
+				}
+				_mm256_store_ps(y + n0, a0);
+				_mm256_store_ps(y + n0 + 8, a1);
+			}
+		}
+
+		// 32 samples per pass while they last, then 16
+		MG_TARGET_AVX512 inline void sparseRowAvx512(uint32_t begin, uint32_t end, const uint32_t* cols, const double* vals, const double* xt, size_t ld, double bias, double* y)
+		{
+			size_t n0 = 0;
+			for (; n0 + 32 <= ld; n0 += 32)
+			{
+				__m512d a0 = _mm512_set1_pd(bias), a1 = a0, a2 = a0, a3 = a0;
+				for (uint32_t k = begin; k < end; ++k)
+				{
+					const __m512d v = _mm512_set1_pd(vals[k]);
+					const double* x = xt + cols[k] * ld + n0;
+					a0 = _mm512_fmadd_pd(v, _mm512_load_pd(x), a0);
+					a1 = _mm512_fmadd_pd(v, _mm512_load_pd(x + 8), a1);
+					a2 = _mm512_fmadd_pd(v, _mm512_load_pd(x + 16), a2);
+					a3 = _mm512_fmadd_pd(v, _mm512_load_pd(x + 24), a3);
+				}
+				_mm512_store_pd(y + n0, a0);
+				_mm512_store_pd(y + n0 + 8, a1);
+				_mm512_store_pd(y + n0 + 16, a2);
+				_mm512_store_pd(y + n0 + 24, a3);
+			}
+			if (n0 < ld)
+			{
+				__m512d a0 = _mm512_set1_pd(bias), a1 = a0;
+				for (uint32_t k = begin; k < end; ++k)
+				{
+					const __m512d v = _mm512_set1_pd(vals[k]);
+					const double* x = xt + cols[k] * ld + n0;
+					a0 = _mm512_fmadd_pd(v, _mm512_load_pd(x), a0);
+					a1 = _mm512_fmadd_pd(v, _mm512_load_pd(x + 8), a1);
+				}
+				_mm512_store_pd(y + n0, a0);
+				_mm512_store_pd(y + n0 + 8, a1);
+			}
+		}
+
+		MG_TARGET_AVX512 inline void sparseRowAvx512(uint32_t begin, uint32_t end, const uint32_t* cols, const float* vals, const float* xt, size_t ld, float bias, float* y)
+		{
+			size_t n0 = 0;
+			for (; n0 + 32 <= ld; n0 += 32)
+			{
+				__m512 a0 = _mm512_set1_ps(bias), a1 = a0;
+				for (uint32_t k = begin; k < end; ++k)
+				{
+					const __m512 v = _mm512_set1_ps(vals[k]);
+					const float* x = xt + cols[k] * ld + n0;
+					a0 = _mm512_fmadd_ps(v, _mm512_load_ps(x), a0);
+					a1 = _mm512_fmadd_ps(v, _mm512_load_ps(x + 16), a1);
+				}
+				_mm512_store_ps(y + n0, a0);
+				_mm512_store_ps(y + n0 + 16, a1);
+			}
+			if (n0 < ld)
+			{
+				__m512 a0 = _mm512_set1_ps(bias);
+				for (uint32_t k = begin; k < end; ++k)
+				{
+					a0 = _mm512_fmadd_ps(_mm512_set1_ps(vals[k]), _mm512_load_ps(xt + cols[k] * ld + n0), a0);
+				}
+				_mm512_store_ps(y + n0, a0);
+			}
+		}
+	} // namespace detail
+
+	inline void sparseRow(uint32_t begin, uint32_t end, const uint32_t* cols, const double* vals, const double* xt, size_t ld, double bias, double* y)
+	{
+		switch (activeIsa())
+		{
+			case Isa::AVX512VNNI:
+			case Isa::AVX512: detail::sparseRowAvx512(begin, end, cols, vals, xt, ld, bias, y); return;
+			case Isa::AVX2: detail::sparseRowAvx2(begin, end, cols, vals, xt, ld, bias, y); return;
+			default: sparseRow<double>(begin, end, cols, vals, xt, ld, bias, y); return;
+		}
+	}
+
+	inline void sparseRow(uint32_t begin, uint32_t end, const uint32_t* cols, const float* vals, const float* xt, size_t ld, float bias, float* y)
+	{
+		switch (activeIsa())
+		{
+			case Isa::AVX512VNNI:
+			case Isa::AVX512: detail::sparseRowAvx512(begin, end, cols, vals, xt, ld, bias, y); return;
+			case Isa::AVX2: detail::sparseRowAvx2(begin, end, cols, vals, xt, ld, bias, y); return;
+			default: sparseRow<float>(begin, end, cols, vals, xt, ld, bias, y); return;
+		}
+	}
+#endif
+
+	// Forward: Y = act(X * W^T + b)
+	template <typename T>
+	void sparseForward(size_t N, Activation act, const CsrMatrix<T>& W,
+		const T* X, size_t ldx, const T* b, T* Y, size_t ldy)
+	{
+		const size_t in = W.cols, out = W.rows;
+		const uint32_t* cols = W.columns.data();
+		const T* vals = W.values.data();
+
+		if (N == 1)
+		{
+			// One gathered dot product per row
+			for (size_t i = 0; i < out; ++i)
+			{
+				T s = b[i];
+				for (uint32_t k = W.rowStart[i]; k < W.rowStart[i + 1]; ++k) s += vals[k] * X[cols[k]];
+				Y[i] = s;
+			}
+		}
+		else
+		{
+			// The padding samples of xt are zero and their outputs are never read
+			const size_t ld = (N + SparseBatchPad - 1) & ~(SparseBatchPad - 1);
+			thread_local AlignedVector<T, 64> xt, yt;
+			xt.assign(in * ld, T(0));
+			yt.resize(out * ld);
+			transpose(N, in, X, ldx, xt.data(), ld);
+
+			for (size_t i = 0; i < out; ++i)
+			{
+				sparseRow(W.rowStart[i], W.rowStart[i + 1], cols, vals, xt.data(), ld, b[i], yt.data() + i * ld);
+			}
+			transpose(out, N, yt.data(), ld, Y, ldy);
+		}
+
+		for (size_t n = 0; n < N; ++n)
+		{
+			applyActivation(act, Y + n * ldy, out);
+		}
+	}
+
+	// Backward of sparseForward, given the layer output Y and its gradient dY. Accumulates
+	// into dValues (one gradient per stored weight, so pruned weights stay pruned), db and,
+	// if dX is not null, dX.
+	template <typename T>
+	void sparseBackward(size_t N, Activation act, const CsrMatrix<T>& W,
+		const T* X, size_t ldx, const T* Y, const T* dY, size_t ldy,
+		T* dValues, T* db, T* dX)
+	{
+		const size_t in = W.cols, out = W.rows;
+		const uint32_t* cols = W.columns.data();
+		const T* vals = W.values.data();
+		if (N == 0 || out == 0) return;
+
+		if (N == 1)
+		{
+			for (size_t i = 0; i < out; ++i)
+			{
+				const T d = dY[i] * activationDerivative(act, Y[i]);
+				db[i] += d;
+				if (d == T(0)) continue;
+				for (uint32_t k = W.rowStart[i]; k < W.rowStart[i + 1]; ++k)
+				{
+					dValues[k] += d * X[cols[k]];
+					if (dX) dX[cols[k]] += d * vals[k];
+				}
+			}
+			return;
+		}
+
+		// delta^T (out x N), formed and reduced into db in one pass
+		thread_local AlignedVector<T, 64> dt, xt, dxt;
+		dt.resize(out * N);
+		xt.resize(in * N);
+		transpose(N, in, X, ldx, xt.data(), N);
+		for (size_t i = 0; i < out; ++i)
+		{
+			T* d = dt.data() + i * N;
+			T sum = T(0);
+			for (size_t n = 0; n < N; ++n)
+			{
+				d[n] = dY[n * ldy + i] * activationDerivative(act, Y[n * ldy + i]);
+				sum += d[n];
+			}
+			db[i] += sum;
+		}
+
+		if (dX) dxt.assign(in * N, T(0));
+		for (size_t i = 0; i < out; ++i)
+		{
+			const T* d = dt.data() + i * N;
+			for (uint32_t k = W.rowStart[i]; k < W.rowStart[i + 1]; ++k)
+			{
+				dValues[k] += dot(N, d, xt.data() + cols[k] * N);
+
+				if (dX)
+				{
+					const T v = vals[k];
+					T* g = dxt.data() + cols[k] * N;
+					for (size_t n = 0; n < N; ++n) g[n] += v * d[n];
+				}
+			}
+		}
+
+		if (dX)
+		{
+			for (size_t j = 0; j < in; ++j)
+			{
+				const T* g = dxt.data() + j * N;
+				for (size_t n = 0; n < N; ++n) dX[n * ldx + j] += g[n];
+			}
+		}
+	}
+} // namespace kernels
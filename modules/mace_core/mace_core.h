@@ -2,6 +2,7 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include <map>
 #include <array>
 #include <queue>
 #include <stack>
@@ -19,6 +20,7 @@
 #include <assert.h>
 #include <limits>
 #include <algorithm>
+#include <numeric>
 #include <functional>
 #include <stdint.h>
 #include <any>
@@ -30,6 +32,10 @@
 #include <future>
 #include <semaphore>
 #include <concepts>
+#include <atomic>
+#include <cstdlib>
+#include <cctype>
+#include <bit>
 
 using ItemID = int64_t;
 
@@ -46,10 +52,39 @@ using RandoM = effolkronium::random_static;
 using nlohmann::json;
 
 // some useful tools and defines outside mace namespace
+#include "excludeFromBuild/basics/CounterRng.h"
 #include "excludeFromBuild/basics/Util.h"
+#include "excludeFromBuild/basics/AlignedAllocator.h"
 #include "excludeFromBuild/thread/BS_thread_pool.h"
 #include "excludeFromBuild/thread/BS_thread_pool_light.h"
+#include "excludeFromBuild/ai/AutogradProfiler.h"
+#include "excludeFromBuild/ai/GraphStats.h"
+#include "excludeFromBuild/kernels/Dispatch.h"
+#include "excludeFromBuild/kernels/Gemm.h"
+#include "excludeFromBuild/kernels/Math.h"
+#include "excludeFromBuild/kernels/Dense.h"
+#include "excludeFromBuild/kernels/Int8.h"
+#include "excludeFromBuild/kernels/Half.h"
+#include "excludeFromBuild/kernels/Sparse.h"
+#include "excludeFromBuild/kernels/Conv.h"
+#include "excludeFromBuild/kernels/Recurrent.h"
+#include "excludeFromBuild/kernels/Attention.h"
+#include "excludeFromBuild/kernels/Norm.h"
+#include "excludeFromBuild/kernels/Random.h"
+#include "excludeFromBuild/kernels/Dropout.h"
+#include "excludeFromBuild/ai/Tensor.h"
 #include "excludeFromBuild/ai/Micrograd.h"
+#include "excludeFromBuild/ai/LaneNode.h"
+#include "excludeFromBuild/ai/DenseLayer.h"
+#include "excludeFromBuild/ai/SparseInputLayer.h"
+#include "excludeFromBuild/ai/Embedding.h"
+#include "excludeFromBuild/ai/QuantizedMLP.h"
+#include "excludeFromBuild/ai/PackedMLP.h"
+#include "excludeFromBuild/ai/SparseMLP.h"
+#include "excludeFromBuild/ai/NeuronPruning.h"
+#include "excludeFromBuild/ai/TensorModules.h"
+#include "excludeFromBuild/ai/Recurrent.h"
+#include "excludeFromBuild/ai/MemoryPlanner.h"
 
 namespace mace
 {
@@ -20,7 +20,6 @@ end
 		"Debug", 
         "Release",
     }
-	vectorextensions "AVX2"
 	filter "configurations:Debug"    defines { "DEBUG" }  symbols  "On"
     filter "configurations:Release"  defines { "NDEBUG" } optimize "On"
     
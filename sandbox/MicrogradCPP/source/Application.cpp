@@ -9,6 +9,10 @@ constexpr uint32_t HIDDEN_LAYER_NEURONS = 8;
 constexpr uint32_t EPOCHS = 1000;
 constexpr double LEARNING_RATE = 0.025;
 
+// When true, the app builds the graph of a single training step for the
+// configured MLP, prints its structure statistics as JSON and exits
+constexpr bool GRAPH_STATS_MODE = false;
+
 // The mean squared error loss function
 ValuePtr meanSquardError(const std::vector<ValuePtr>& target, const std::vector<ValuePtr>& prediction)
 {
@@ -81,6 +85,15 @@ public:
 			std::vector<std::vector<ValuePtr>> targets;
 			fillTargets(targets);
 
+			if (GRAPH_STATS_MODE)
+			{
+				std::vector<ValuePtr> prediction = mlp(inputs[0]);
+				ValuePtr loss = meanSquardError(targets[0], prediction);
+
+				std::cout << loss->graph_stats(mlp.parameters()).toJson().dump(4) << std::endl;
+				return;
+			}
+
 			// "Epoch" is a term used in machine learning to denote one complete pass 
 			// through the entire training dataset. It's used as a measure of the number
 			// of times the learning algorithm has worked through the entire training set.
@@ -17,7 +17,6 @@ end
 		"Debug", 
         "Release",
     }
-	vectorextensions "AVX2"
 	filter "configurations:Debug"    defines { "DEBUG" }  symbols  "On"
     filter "configurations:Release"  defines { "NDEBUG" } optimize "On"
     
@@ -25,3 +24,5 @@ end
 	
 	include "tests/ExprNode"
 	include "tests/NN"
+	include "tests/Tensor"
+	include "tests/Kernels"
@@ -101,6 +101,246 @@ TEST_CASE("More complex backpropagation tests") {
         CHECK(c->get_grad() == doctest::Approx(-1.0));
         CHECK(d->get_grad() == doctest::Approx(2.0));
     }
+
+    SUBCASE("Test tanh derivative") {
+        auto a = ExprNode::Create(0.5);
+        auto f = a->tanH();
+        f->backward();
+
+        // d/dx tanh(x) = 1 - tanh(x)^2, from the output that already holds tanh(x)
+        CHECK(a->get_grad() == doctest::Approx(1.0 - std::tanh(0.5) * std::tanh(0.5)));
+    }
+
+    SUBCASE("Test released graphs are freed") {
+        auto a = ExprNode::Create(2.0);
+        auto b = ExprNode::Create(3.0);
+
+        // Every op's node is released once nothing outside the graph refers to it
+        std::vector<std::weak_ptr<ExprNode>> nodes;
+        {
+            auto sum = *a + b;
+            auto sumConst = *sum + 1.0;
+            auto product = *sumConst * a;
+            auto productConst = *product * 2.0;
+            auto quotient = *productConst / b;
+            auto power = quotient->pow(2.0);
+            auto f = power->tanH();
+            f->backward();
+            nodes = { sum, sumConst, product, productConst, quotient, power, f };
+        }
+        for (auto& node : nodes)
+        {
+            CHECK(node.expired());
+        }
+    }
+}
+
+TEST_CASE("Autograd profiler") {
+    AutogradProfiler::reset();
+
+    SUBCASE("Disabled profiler records nothing") {
+        AutogradProfiler::disable();
+
+        auto a = ExprNode::Create(2.0);
+        auto b = ExprNode::Create(3.0);
+        auto c = *a * b;
+        c->backward();
+
+        CHECK(AutogradProfiler::count(ProfileOp::Mul, ProfilePass::Forward) == 0);
+        CHECK(AutogradProfiler::count(ProfileOp::Mul, ProfilePass::Backward) == 0);
+    }
+
+    SUBCASE("Counts are split by op and pass") {
+        AutogradProfiler::enable();
+
+        auto a = ExprNode::Create(2.0);
+        auto b = ExprNode::Create(3.0);
+
+        // f = tanh(a * b + a) / b
+        auto f = *(*(*a * b) + a)->tanH() / b;
+        f->backward();
+
+        AutogradProfiler::disable();
+
+        CHECK(AutogradProfiler::count(ProfileOp::Mul, ProfilePass::Forward) == 1);
+        CHECK(AutogradProfiler::count(ProfileOp::Add, ProfilePass::Forward) == 1);
+        CHECK(AutogradProfiler::count(ProfileOp::TanH, ProfilePass::Forward) == 1);
+        CHECK(AutogradProfiler::count(ProfileOp::Div, ProfilePass::Forward) == 1);
+
+        CHECK(AutogradProfiler::count(ProfileOp::Mul, ProfilePass::Backward) == 1);
+        CHECK(AutogradProfiler::count(ProfileOp::Add, ProfilePass::Backward) == 1);
+        CHECK(AutogradProfiler::count(ProfileOp::TanH, ProfilePass::Backward) == 1);
+        CHECK(AutogradProfiler::count(ProfileOp::Div, ProfilePass::Backward) == 1);
+
+        json report = AutogradProfiler::report();
+        CHECK(report["forward"]["count"] == 4);
+        CHECK(report["backward"]["count"] == 4);
+        CHECK(report["backward"]["calls"] == 1);
+        CHECK(report["forward"]["ops"]["TanH"]["count"] == 1);
+        CHECK(report["forward"]["ops"].contains("Softmax") == false);
+    }
+
+    AutogradProfiler::reset();
+}
+
+TEST_CASE("Graph structure statistics") {
+    auto a = ExprNode::Create(2.0);
+    auto b = ExprNode::Create(3.0);
+    auto c = ExprNode::Create(4.0);
+
+    // f = tanh(a * b + a * c)
+    auto f = (*(*a * b) + (*a * c))->tanH();
+
+    GraphStats stats = f->graph_stats({ a, b });
+
+    CHECK(stats.nodeCount == 7);
+    CHECK(stats.leafCount == 3);
+    CHECK(stats.parameterCount == 2);
+    CHECK(stats.maxDepth == 3);
+    CHECK(stats.opCounts["*"] == 2);
+    CHECK(stats.opCounts["+"] == 1);
+    CHECK(stats.opCounts["TanH"] == 1);
+    CHECK(stats.opCounts["leaf"] == 3);
+
+    // a feeds both multiplications, the root has no parents
+    CHECK(stats.fanOutHistogram[2] == 1);
+    CHECK(stats.fanOutHistogram[0] == 1);
+    CHECK(stats.fanInHistogram[2] == 3);
+    CHECK(stats.fanInHistogram[0] == 3);
+
+    REQUIRE(stats.widthPerLevel.size() == 4);
+    CHECK(stats.widthPerLevel[0] == 3);
+    CHECK(stats.widthPerLevel[1] == 2);
+    CHECK(stats.widthPerLevel[3] == 1);
+
+    CHECK(stats.nodeBytes >= 7 * sizeof(ExprNode));
+    CHECK(stats.closureBytes > 0);
+
+    json report = stats.toJson();
+    CHECK(report["nodes"] == 7);
+    CHECK(report["width_per_level"].size() == 4);
+}
+
+TEST_CASE("Lane-vector graphs match per-sample ExprNode graphs") {
+    constexpr size_t W = LaneNode<double>::Width;
+    std::vector<double> av(W), bv(W);
+    for (size_t i = 0; i < W; ++i) {
+        av[i] = 0.5 + 0.25 * i;
+        bv[i] = -1.0 + 0.5 * i;
+    }
+
+    SUBCASE("Every op, lane by lane") {
+        auto a = LaneNode<double>::Create();
+        auto b = LaneNode<double>::Create();
+        for (size_t i = 0; i < W; ++i) {
+            a->set_lane(i, av[i]);
+            b->set_lane(i, bv[i]);
+        }
+
+        // f = tanh(a * b + b / a) - a^2 + b * 0.5
+        auto build = [](auto a, auto b) {
+            auto t = (*(*a * b) + (*b / a))->tanH();
+            return *(*t - a->pow(2)) + (*b * 0.5);
+        };
+        auto f = build(a, b);
+        f->backward();
+
+        for (size_t i = 0; i < W; ++i) {
+            auto sa = ExprNode::Create(av[i]);
+            auto sb = ExprNode::Create(bv[i]);
+            auto sf = build(sa, sb);
+            sf->backward();
+
+            CHECK(f->get_val()[i] == doctest::Approx(sf->get_val()));
+            CHECK(a->get_grad()[i] == doctest::Approx(sa->get_grad()));
+            CHECK(b->get_grad()[i] == doctest::Approx(sb->get_grad()));
+        }
+
+        auto e = b->exp();
+        e->backward();
+        for (size_t i = 0; i < W; ++i) {
+            CHECK(e->get_val()[i] == doctest::Approx(std::exp(bv[i])));
+            CHECK(b->get_grad()[i] == doctest::Approx(std::exp(bv[i])));
+        }
+    }
+
+    SUBCASE("MLP graph built once, parameter gradients summed across lanes") {
+        MLP mlp(2, { 3, 1 }, false);
+
+        std::vector<LanePtr> inputs = { LaneNode<double>::Create(), LaneNode<double>::Create() };
+        auto target = LaneNode<double>::Create();
+        auto diff = *mlp(inputs)[0] - target;
+        auto loss = *diff * diff;
+
+        for (int step = 0; step < 2; ++step) {
+            // New samples each step; the graph is re-run, not rebuilt
+            for (size_t i = 0; i < W; ++i) {
+                inputs[0]->set_lane(i, av[i] + step);
+                inputs[1]->set_lane(i, bv[i]);
+                target->set_lane(i, 0.1 * i);
+            }
+            loss->forward();
+            mlp.zero_grad();
+            loss->backward();
+
+            std::vector<double> laneGrads;
+            for (auto& p : mlp.parameters()) laneGrads.push_back(p->get_grad());
+
+            mlp.zero_grad();
+            for (size_t i = 0; i < W; ++i) {
+                std::vector<ValuePtr> x = { ExprNode::Create(av[i] + step), ExprNode::Create(bv[i]) };
+                auto d = *mlp(x)[0] - ExprNode::Create(0.1 * i);
+                auto l = *d * d;
+                CHECK(loss->get_val()[i] == doctest::Approx(l->get_val()));
+                l->backward();
+            }
+
+            auto params = mlp.parameters();
+            for (size_t k = 0; k < params.size(); ++k) {
+                CHECK(laneGrads[k] == doctest::Approx(params[k]->get_grad()));
+            }
+
+            // The mirrored parameters pick up the update on the next forward()
+            for (auto& p : params) p->set_val(p->get_val() - 0.1 * p->get_grad());
+        }
+    }
+
+    SUBCASE("Padding lanes add nothing to parameter gradients") {
+        MLP mlp(2, { 3, 1 }, false);
+
+        std::vector<LanePtr> inputs = { LaneNode<double>::Create(), LaneNode<double>::Create() };
+        auto target = LaneNode<double>::Create();
+        auto diff = *mlp(inputs)[0] - target;
+        auto loss = *diff * diff;
+
+        // One real sample fewer than the width; the padding lane holds NaN
+        const size_t active = W - 1;
+        for (size_t i = 0; i < W; ++i) {
+            const double pad = i < active ? 0.0 : std::numeric_limits<double>::quiet_NaN();
+            inputs[0]->set_lane(i, av[i] + pad);
+            inputs[1]->set_lane(i, bv[i] + pad);
+            target->set_lane(i, 0.1 * i + pad);
+        }
+        loss->forward();
+        mlp.zero_grad();
+        loss->backward(active);
+
+        std::vector<double> laneGrads;
+        for (auto& p : mlp.parameters()) laneGrads.push_back(p->get_grad());
+
+        mlp.zero_grad();
+        for (size_t i = 0; i < active; ++i) {
+            std::vector<ValuePtr> x = { ExprNode::Create(av[i]), ExprNode::Create(bv[i]) };
+            auto d = *mlp(x)[0] - ExprNode::Create(0.1 * i);
+            auto l = *d * d;
+            l->backward();
+        }
+
+        auto params = mlp.parameters();
+        for (size_t k = 0; k < params.size(); ++k) {
+            CHECK(laneGrads[k] == doctest::Approx(params[k]->get_grad()));
+        }
+    }
 }
 
 class Application : public Jahley::App
@@ -0,0 +1,707 @@
+﻿#include "Jahley.h"
+
+const std::string APP_NAME = "Kernels";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+#include <json/json.hpp>
+using nlohmann::json;
+
+template <typename T>
+static std::vector<T> randomVector (size_t n)
+{
+    std::vector<T> v (n);
+    for (auto& x : v)
+        x = static_cast<T> (generateRandomDouble());
+    return v;
+}
+
+// Runs the blocked GEMM and the reference on the same operands and compares every element
+template <typename T>
+static void checkGemm (size_t M, size_t N, size_t K, bool transA, bool transB, T alpha, T beta)
+{
+    std::vector<T> A = randomVector<T> (M * K);
+    std::vector<T> B = randomVector<T> (K * N);
+    std::vector<T> C = randomVector<T> (M * N);
+    std::vector<T> expected = C;
+
+    // A transposed operand is stored K x M and read through swapped strides
+    ptrdiff_t rsA = transA ? 1 : K, csA = transA ? M : 1;
+    ptrdiff_t rsB = transB ? 1 : N, csB = transB ? K : 1;
+
+    kernels::gemm<T> (M, N, K, alpha, A.data(), rsA, csA, B.data(), rsB, csB, beta, C.data(), N, 1);
+    kernels::gemmReference<T> (M, N, K, alpha, A.data(), rsA, csA, B.data(), rsB, csB, beta, expected.data(), N, 1);
+
+    const double tolerance = std::is_same_v<T, float> ? 1e-3 : 1e-10;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < M * N; ++i)
+    {
+        if (std::abs (static_cast<double> (C[i] - expected[i])) > tolerance * (1.0 + std::sqrt (static_cast<double> (K))))
+            ++mismatches;
+    }
+    CHECK (mismatches == 0);
+}
+
+TEST_CASE_TEMPLATE ("Blocked GEMM matches the reference", T, double, float)
+{
+    SUBCASE ("Exact tile multiples")
+    {
+        checkGemm<T> (12, 32, 16, false, false, T (1), T (0));
+    }
+
+    SUBCASE ("Edge tiles")
+    {
+        checkGemm<T> (1, 1, 1, false, false, T (1), T (0));
+        checkGemm<T> (7, 9, 5, false, false, T (1), T (1));
+        checkGemm<T> (13, 17, 3, false, false, T (0.5), T (2));
+    }
+
+    SUBCASE ("Crosses every cache block")
+    {
+        checkGemm<T> (150, 300, 600, false, false, T (1), T (1));
+    }
+
+    SUBCASE ("Transposed operands")
+    {
+        checkGemm<T> (33, 21, 40, true, false, T (1), T (0));
+        checkGemm<T> (33, 21, 40, false, true, T (1), T (0));
+        checkGemm<T> (33, 21, 40, true, true, T (-1), T (0.5));
+    }
+
+    SUBCASE ("Full and partial B panels")
+    {
+        // A row-major B copies whole NR-wide panels at once. A transposed B is packed a
+        // column at a time, here with a partial last panel and a power-of-two leading
+        // dimension that crosses a KC block.
+        constexpr size_t NR = kernels::GemmBlocking<T>::NR;
+        checkGemm<T> (20, 3 * NR, 64, false, false, T (1), T (0));
+        checkGemm<T> (20, 2 * NR + 5, 512, false, true, T (1), T (1));
+    }
+}
+
+TEST_CASE ("GEMM with beta zero ignores the old contents of C")
+{
+    std::vector<double> A = {1, 2, 3, 4};
+    std::vector<double> B = {5, 6, 7, 8};
+    std::vector<double> C (4, std::numeric_limits<double>::quiet_NaN());
+
+    kernels::gemm<double> (2, 2, 2, 1.0, A.data(), 2, B.data(), 2, 0.0, C.data(), 2);
+    CHECK (C == std::vector<double>{19, 22, 43, 50});
+}
+
+TEST_CASE_TEMPLATE ("GEMV matches the reference", T, double, float)
+{
+    const size_t M = 37, K = 101;
+    std::vector<T> A = randomVector<T> (M * K);
+    std::vector<T> x = randomVector<T> (K);
+    std::vector<T> y = randomVector<T> (M);
+    std::vector<T> expected = y;
+
+    kernels::gemv<T> (M, K, T (2), A.data(), K, x.data(), T (1), y.data());
+    kernels::gemmReference<T> (M, 1, K, T (2), A.data(), K, 1, x.data(), 1, 1, T (1), expected.data(), 1, 1);
+
+    for (size_t i = 0; i < M; ++i)
+    {
+        CHECK (y[i] == doctest::Approx (expected[i]).epsilon (1e-4));
+    }
+}
+
+TEST_CASE_TEMPLATE ("Parallel GEMM matches the serial GEMM", T, double, float)
+{
+    // Tiles only split the output, so every element sees the same sequence of operations
+    // as the serial GEMM and the results must be identical, not just close.
+    auto check = [] (BS::thread_pool& pool, size_t M, size_t N, size_t K, T beta)
+    {
+        std::vector<T> A = randomVector<T> (M * K);
+        std::vector<T> B = randomVector<T> (K * N);
+        std::vector<T> C = randomVector<T> (M * N);
+        std::vector<T> expected = C;
+
+        kernels::gemmParallel<T> (pool, M, N, K, T (1), A.data(), K, B.data(), N, beta, C.data(), N);
+        kernels::gemm<T> (M, N, K, T (1), A.data(), K, B.data(), N, beta, expected.data(), N);
+        CHECK (C == expected);
+    };
+
+    for (unsigned threads : {1u, 2u, 4u})
+    {
+        BS::thread_pool pool (threads);
+        check (pool, 5, 7, 3, T (0));
+        check (pool, 300, 520, 200, T (1));
+        check (pool, 37, 1100, 150, T (0.5));
+        check (pool, 1100, 30, 150, T (0));
+    }
+}
+
+TEST_CASE_TEMPLATE ("Dense forward matches the reference on both sides of the streaming threshold", T, double, float)
+{
+    // Batches below DenseStreamingBatch take one dot product per weight row and sample,
+    // larger ones the GEMM. W has a padded leading dimension.
+    const size_t in = 77, out = 45, ldw = 80;
+    std::vector<T> W = randomVector<T> (out * ldw), b = randomVector<T> (out);
+
+    for (size_t N : {size_t (1), size_t (7), kernels::DenseStreamingBatch - 1, kernels::DenseStreamingBatch, size_t (37)})
+    {
+        std::vector<T> X = randomVector<T> (N * in), Y (N * out), expected (N * out);
+        kernels::denseForward<T> (N, in, out, Activation::TanH, X.data(), in, W.data(), ldw, b.data(), Y.data(), out);
+
+        for (size_t n = 0; n < N; ++n)
+        {
+            for (size_t o = 0; o < out; ++o)
+            {
+                double sum = b[o];
+                for (size_t i = 0; i < in; ++i) sum += static_cast<double> (W[o * ldw + i]) * X[n * in + i];
+                expected[n * out + o] = static_cast<T> (std::tanh (sum));
+            }
+        }
+
+        const double eps = std::is_same_v<T, float> ? 1e-4 : 1e-10;
+        for (size_t i = 0; i < Y.size(); ++i) CHECK (Y[i] == doctest::Approx (expected[i]).epsilon (eps));
+    }
+}
+
+TEST_CASE ("DenseLayer batched forward matches per-sample forward")
+{
+    DenseLayer layer (19, 11);
+    const size_t N = 7;
+    std::vector<double> X = randomVector<double> (N * 19);
+    std::vector<double> Y (N * 11);
+    layer.forward (X.data(), N, Y.data());
+
+    for (size_t n = 0; n < N; ++n)
+    {
+        std::vector<double> y (11);
+        layer.forward (X.data() + n * 19, y.data());
+        for (size_t i = 0; i < 11; ++i)
+        {
+            CHECK (Y[n * 11 + i] == doctest::Approx (y[i]));
+        }
+    }
+}
+
+// Unfused reference: delta = dY * act'(Y), then db, dW and dX one at a time
+template <typename T>
+static void denseBackwardReference (size_t N, size_t in, size_t out, Activation act,
+                                    const T* X, const T* W, const T* Y, const T* dY,
+                                    T* dW, T* db, T* dX)
+{
+    for (size_t n = 0; n < N; ++n)
+    {
+        for (size_t o = 0; o < out; ++o)
+        {
+            const T d = dY[n * out + o] * kernels::activationDerivative (act, Y[n * out + o]);
+            db[o] += d;
+            for (size_t i = 0; i < in; ++i)
+            {
+                dW[o * in + i] += d * X[n * in + i];
+                if (dX) dX[n * in + i] += d * W[o * in + i];
+            }
+        }
+    }
+}
+
+template <typename T>
+static void checkDenseBackward (size_t N, size_t in, size_t out, Activation act, bool withDX, bool withParams = true)
+{
+    std::vector<T> X = randomVector<T> (N * in);
+    std::vector<T> W = randomVector<T> (out * in);
+    std::vector<T> b = randomVector<T> (out);
+    std::vector<T> Y (N * out);
+    std::vector<T> dY = randomVector<T> (N * out);
+    kernels::denseForward<T> (N, in, out, act, X.data(), in, W.data(), in, b.data(), Y.data(), out);
+
+    // Both start from the same nonzero gradients to check that the kernel accumulates
+    std::vector<T> dW = randomVector<T> (out * in), db = randomVector<T> (out), dX = randomVector<T> (N * in);
+    std::vector<T> dWRef = dW, dbRef = db, dXRef = dX;
+
+    // Without params the kernel gets no dW and db and must leave them alone
+    kernels::denseBackward<T> (N, in, out, act, X.data(), in, W.data(), in, Y.data(), dY.data(), out,
+                               withParams ? dW.data() : nullptr, withParams ? db.data() : nullptr, withDX ? dX.data() : nullptr);
+    if (!withParams)
+    {
+        CHECK (dW == dWRef);
+        CHECK (db == dbRef);
+    }
+    denseBackwardReference<T> (N, in, out, act, X.data(), W.data(), Y.data(), dY.data(),
+                               dWRef.data(), dbRef.data(), withDX ? dXRef.data() : nullptr);
+
+    const double eps = std::is_same_v<T, float> ? 1e-3 : 1e-9;
+    if (withParams)
+    {
+        for (size_t i = 0; i < dW.size(); ++i) CHECK (dW[i] == doctest::Approx (dWRef[i]).epsilon (eps));
+        for (size_t i = 0; i < db.size(); ++i) CHECK (db[i] == doctest::Approx (dbRef[i]).epsilon (eps));
+    }
+    for (size_t i = 0; i < dX.size(); ++i) CHECK (dX[i] == doctest::Approx (dXRef[i]).epsilon (eps));
+}
+
+TEST_CASE_TEMPLATE ("Fused dense backward matches the unfused reference", T, double, float)
+{
+    SUBCASE ("Single sample")
+    {
+        checkDenseBackward<T> (1, 23, 17, Activation::TanH, true);
+        checkDenseBackward<T> (1, 23, 17, Activation::None, false);
+    }
+
+    SUBCASE ("Batch spanning several row blocks")
+    {
+        checkDenseBackward<T> (500, 31, 600, Activation::TanH, true);
+        checkDenseBackward<T> (500, 31, 600, Activation::Sigmoid, true);
+        checkDenseBackward<T> (500, 31, 600, Activation::ReLU, false);
+    }
+
+    SUBCASE ("Frozen weights pass no dW or db")
+    {
+        checkDenseBackward<T> (1, 23, 17, Activation::TanH, true, false);
+        checkDenseBackward<T> (500, 31, 600, Activation::TanH, true, false);
+    }
+}
+
+TEST_CASE ("DenseLayer batched backward matches the ExprNode graph")
+{
+    uint32_t id = 0;
+    Layer scalar (6, 4, id);
+    DenseLayer layer (scalar);
+    const size_t N = 3;
+    std::vector<double> X = randomVector<double> (N * 6);
+    std::vector<double> Y (N * 4);
+    std::vector<double> dY (N * 4, 1.0);
+    std::vector<double> dX (N * 6, 0.0);
+
+    layer.forward (X.data(), N, Y.data());
+    layer.backward (X.data(), N, Y.data(), dY.data(), dX.data());
+
+    // Same loss, the sum of every output, through the scalar graph one sample at a time
+    for (size_t n = 0; n < N; ++n)
+    {
+        std::vector<ValuePtr> x;
+        for (size_t j = 0; j < 6; ++j)
+        {
+            x.push_back (ExprNode::Create (X[n * 6 + j]));
+        }
+        std::vector<ValuePtr> y = scalar (x);
+        ValuePtr loss = y[0];
+        for (size_t i = 1; i < y.size(); ++i)
+        {
+            loss = *loss + y[i];
+        }
+        loss->backward();
+
+        for (size_t j = 0; j < 6; ++j)
+        {
+            CHECK (dX[n * 6 + j] == doctest::Approx (x[j]->get_grad()));
+        }
+    }
+
+    auto& neurons = scalar.getNeurons();
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (size_t j = 0; j < 6; ++j)
+        {
+            CHECK (layer.neuron (i).weight_grad (j) == doctest::Approx (neurons[i].getWeights()[j]->get_grad()));
+        }
+        CHECK (layer.neuron (i).bias_grad() == doctest::Approx (neurons[i].getBias()->get_grad()));
+    }
+}
+
+// Largest error of a vectorized function over samples in [lo, hi], in ulps of the libm
+// result computed in long double. Where long double is just double (MSVC) the reference
+// itself carries up to half an ulp, so the bound is loosened by one.
+template <typename T, typename F, typename R>
+static double maxUlpError (F f, R reference, double lo, double hi, bool logarithmic)
+{
+    const size_t n = 100000;
+    std::mt19937_64 rng (7);
+    std::uniform_real_distribution<double> u (0.0, 1.0);
+    std::vector<T> x (n), y (n);
+    for (auto& v : x)
+    {
+        const double t = u (rng);
+        v = static_cast<T> (logarithmic ? std::exp (std::log (lo) + t * (std::log (hi) - std::log (lo))) : lo + t * (hi - lo));
+    }
+    f (n, x.data(), y.data());
+
+    double worst = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const long double r = reference (static_cast<long double> (x[i]));
+        const T rounded = static_cast<T> (r);
+        if (!std::isfinite (rounded) || rounded == T (0)) continue;
+
+        const long double ulp = std::nextafter (std::abs (rounded), std::numeric_limits<T>::infinity()) - std::abs (rounded);
+        worst = std::max (worst, static_cast<double> (std::abs (static_cast<long double> (y[i]) - r) / ulp));
+    }
+    return worst;
+}
+
+TEST_CASE_TEMPLATE ("Vectorized exp, log, tanh and sigmoid stay within their documented ulp error", T, double, float)
+{
+    using Ulp = kernels::MathMaxUlp<T>;
+    const double slack = (std::is_same_v<T, double> && sizeof (long double) == sizeof (double)) ? 1.0 : 0.0;
+    const double expHi = std::is_same_v<T, double> ? 709.0 : 88.0;
+    const double expLo = std::is_same_v<T, double> ? -708.0 : -87.0;
+    const double tiny = static_cast<double> (std::numeric_limits<T>::denorm_min()) * 16;
+    const double huge = static_cast<double> (std::numeric_limits<T>::max()) / 16;
+
+    auto vexp = [] (size_t n, const T* x, T* y) { kernels::vexp (n, x, y); };
+    auto vlog = [] (size_t n, const T* x, T* y) { kernels::vlog (n, x, y); };
+    auto vtanh = [] (size_t n, const T* x, T* y) { kernels::vtanh (n, x, y); };
+    auto vsigmoid = [] (size_t n, const T* x, T* y) { kernels::vsigmoid (n, x, y); };
+
+    auto refExp = [] (long double v) { return std::exp (v); };
+    auto refLog = [] (long double v) { return std::log (v); };
+    auto refTanh = [] (long double v) { return std::tanh (v); };
+    auto refSigmoid = [] (long double v) { return 1.0L / (1.0L + std::exp (-v)); };
+
+    CHECK (maxUlpError<T> (vexp, refExp, -1.0, 1.0, false) <= Ulp::exp + slack);
+    CHECK (maxUlpError<T> (vexp, refExp, expLo, expHi, false) <= Ulp::exp + slack);
+    CHECK (maxUlpError<T> (vlog, refLog, 0.5, 2.0, false) <= Ulp::log + slack);
+    CHECK (maxUlpError<T> (vlog, refLog, tiny, huge, true) <= Ulp::log + slack);
+    CHECK (maxUlpError<T> (vtanh, refTanh, -20.0, 20.0, false) <= Ulp::tanh + slack);
+    CHECK (maxUlpError<T> (vtanh, refTanh, 1e-30, 1.0, true) <= Ulp::tanh + slack);
+    CHECK (maxUlpError<T> (vsigmoid, refSigmoid, -80.0, 40.0, false) <= Ulp::sigmoid + slack);
+
+    // Special values and the lane tail (7 elements is not a multiple of the vector width)
+    const T inf = std::numeric_limits<T>::infinity();
+    std::vector<T> x = {std::numeric_limits<T>::quiet_NaN(), inf, -inf, T (0), T (-1), T (1000), T (-1000)};
+    std::vector<T> y (x.size());
+
+    kernels::vexp (x.size(), x.data(), y.data());
+    CHECK (std::isnan (y[0]));
+    CHECK (y[1] == inf);
+    CHECK (y[2] == T (0));
+    CHECK (y[3] == T (1));
+    CHECK (y[5] == inf);
+    CHECK (y[6] == T (0));
+
+    kernels::vlog (x.size(), x.data(), y.data());
+    CHECK (std::isnan (y[0]));
+    CHECK (y[1] == inf);
+    CHECK (y[3] == -inf);
+    CHECK (std::isnan (y[4]));
+
+    kernels::vtanh (x.size(), x.data(), y.data());
+    CHECK (std::isnan (y[0]));
+    CHECK (y[1] == T (1));
+    CHECK (y[2] == T (-1));
+    CHECK (y[3] == T (0));
+    CHECK (y[6] == T (-1));
+
+    kernels::vsigmoid (x.size(), x.data(), y.data());
+    CHECK (std::isnan (y[0]));
+    CHECK (y[1] == T (1));
+    CHECK (y[2] == T (0));
+    CHECK (y[3] == T (0.5));
+    CHECK (y[5] == T (1));
+}
+
+TEST_CASE_TEMPLATE ("Half precision conversions round to nearest even", H, kernels::bf16, kernels::fp16)
+{
+    auto narrow = [] (float f)
+    {
+        if constexpr (std::is_same_v<H, kernels::bf16>) return kernels::toBf16 (f);
+        else return kernels::toFp16 (f);
+    };
+
+    // Every finite value survives a round trip, and every midpoint between two neighbours
+    // rounds to the one with the even mantissa
+    size_t roundTripErrors = 0, midpointErrors = 0;
+    for (uint32_t bits = 0; bits < 0x8000; ++bits)
+    {
+        const float v = kernels::toFloat (H {static_cast<uint16_t> (bits)});
+        const float next = kernels::toFloat (H {static_cast<uint16_t> (bits + 1)});
+        if (!std::isfinite (v)) continue;
+
+        if (narrow (v).bits != bits || narrow (-v).bits != (bits | 0x8000)) ++roundTripErrors;
+        if (std::isfinite (next))
+        {
+            const uint16_t even = (bits & 1) ? static_cast<uint16_t> (bits + 1) : static_cast<uint16_t> (bits);
+            if (narrow (v + (next - v) / 2).bits != even) ++midpointErrors;
+        }
+    }
+    CHECK (roundTripErrors == 0);
+    CHECK (midpointErrors == 0);
+
+    const float inf = std::numeric_limits<float>::infinity();
+    CHECK (kernels::toFloat (narrow (inf)) == inf);
+    CHECK (kernels::toFloat (narrow (-inf)) == -inf);
+    CHECK (std::isnan (kernels::toFloat (narrow (std::numeric_limits<float>::quiet_NaN()))));
+    if constexpr (std::is_same_v<H, kernels::fp16>)
+    {
+        CHECK (kernels::toFloat (narrow (65504.0f)) == 65504.0f);
+        CHECK (kernels::toFloat (narrow (65520.0f)) == inf);
+        CHECK (kernels::toFloat (narrow (1e-8f)) == 0.0f);
+    }
+}
+
+TEST_CASE_TEMPLATE ("Dense forward with 16-bit weights matches the float kernel", H, kernels::bf16, kernels::fp16)
+{
+    // Batches below and above the streaming threshold, with a depth that leaves vector tails
+    const size_t in = 77, out = 45, ld = 80;
+    std::vector<float> w = randomVector<float> (out * ld), b = randomVector<float> (out);
+    std::vector<H> packed (out * ld);
+    kernels::convert (w.size(), w.data(), packed.data());
+    kernels::convert (packed.size(), packed.data(), w.data()); // the values the kernel sees
+
+    for (size_t N : {1, 3, 20})
+    {
+        std::vector<float> X = randomVector<float> (N * in), Y (N * out), expected (N * out);
+        kernels::denseForwardHalf<H> (N, in, out, Activation::TanH, X.data(), in, packed.data(), ld, b.data(), Y.data(), out);
+        kernels::denseForward<float> (N, in, out, Activation::TanH, X.data(), in, w.data(), ld, b.data(), expected.data(), out);
+        for (size_t i = 0; i < Y.size(); ++i)
+        {
+            CHECK (Y[i] == doctest::Approx (expected[i]).epsilon (1e-4));
+        }
+    }
+}
+
+TEST_CASE_TEMPLATE ("Sparse forward and backward match the dense kernels", T, double, float)
+{
+    // About two thirds of the weights zeroed, and one row left completely empty
+    const size_t in = 53, out = 31;
+    std::vector<T> w = randomVector<T> (out * in), b = randomVector<T> (out);
+    for (size_t k = 0; k < w.size(); ++k)
+    {
+        if (k % 3 != 0 || k / in == 5) w[k] = T (0);
+    }
+    const kernels::CsrMatrix<T> csr = kernels::toCsr (out, in, w.data(), in);
+    CHECK (csr.nonZeros() == static_cast<size_t> (std::count_if (w.begin(), w.end(), [] (T v) { return v != T (0); })));
+
+    // 33 and 70 pad to 48 and 80 samples, which the AVX-512 kernels cover with one and two
+    // 32-sample passes followed by a 16-sample tail
+    const T tol = std::is_same_v<T, float> ? T (1e-4) : T (1e-10);
+    for (size_t N : {1, 7, 33, 70})
+    {
+        std::vector<T> X = randomVector<T> (N * in), dY = randomVector<T> (N * out);
+        std::vector<T> Y (N * out), expected (N * out);
+        kernels::sparseForward<T> (N, Activation::TanH, csr, X.data(), in, b.data(), Y.data(), out);
+        kernels::denseForward<T> (N, in, out, Activation::TanH, X.data(), in, w.data(), in, b.data(), expected.data(), out);
+        for (size_t i = 0; i < Y.size(); ++i)
+        {
+            CHECK (Y[i] == doctest::Approx (expected[i]).epsilon (tol));
+        }
+
+        std::vector<T> dValues (csr.nonZeros(), T (0)), db (out, T (0)), dX (N * in, T (0));
+        std::vector<T> dW (out * in, T (0)), dbExpected (out, T (0)), dXExpected (N * in, T (0));
+        kernels::sparseBackward<T> (N, Activation::TanH, csr, X.data(), in, Y.data(), dY.data(), out, dValues.data(), db.data(), dX.data());
+        kernels::denseBackward<T> (N, in, out, Activation::TanH, X.data(), in, w.data(), in, expected.data(), dY.data(), out,
+                                   dW.data(), dbExpected.data(), dXExpected.data());
+
+        // Stored weights get the dense gradient at their position
+        for (size_t i = 0; i < out; ++i)
+        {
+            for (uint32_t k = csr.rowStart[i]; k < csr.rowStart[i + 1]; ++k)
+            {
+                CHECK (dValues[k] == doctest::Approx (dW[i * in + csr.columns[k]]).epsilon (tol));
+            }
+            CHECK (db[i] == doctest::Approx (dbExpected[i]).epsilon (tol));
+        }
+        for (size_t i = 0; i < dX.size(); ++i)
+        {
+            CHECK (dX[i] == doctest::Approx (dXExpected[i]).epsilon (tol));
+        }
+    }
+}
+
+TEST_CASE ("Counter-based dropout masks are reproducible and unbiased")
+{
+    // Known-answer vectors of Philox4x32-10 from the Random123 distribution
+    CHECK (CounterRng::block (0, 0, 0) == CounterRng::Block{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8});
+    CHECK (CounterRng::block (~0ull, ~0ull, ~0ull) == CounterRng::Block{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd});
+
+    const size_t n = 100003;
+    const double p = 0.3;
+    const uint64_t key = splitMix64 (42);
+    std::vector<double> x (n, 1.0), y (n), chunked (n);
+    kernels::dropoutForward<double> (n, Activation::None, p, key, 7, 0, x.data(), y.data());
+
+    const size_t kept = std::count_if (y.begin(), y.end(), [] (double v) { return v != 0.0; });
+    CHECK (double (kept) / n == doctest::Approx (1.0 - p).epsilon (0.01));
+    for (double v : y)
+    {
+        if (v != 0.0) CHECK (v == doctest::Approx (1.0 / (1.0 - p)));
+    }
+
+    // Chunks at unaligned offsets give the same mask, another step a different one
+    for (size_t start = 0; start < n; start += 1001)
+    {
+        const size_t len = std::min<size_t> (1001, n - start);
+        kernels::dropoutForward<double> (len, Activation::None, p, key, 7, start, x.data() + start, chunked.data() + start);
+    }
+    CHECK (chunked == y);
+    kernels::dropoutForward<double> (n, Activation::None, p, key, 8, 0, x.data(), chunked.data());
+    CHECK (chunked != y);
+
+    // Backward regenerates the mask and reads the activation of the kept elements back from
+    // the forward output
+    std::vector<double> a = randomVector<double> (n), ya (n), dY (n, 1.0), dX (n, 0.0);
+    kernels::dropoutForward<double> (n, Activation::TanH, p, key, 7, 0, a.data(), ya.data());
+    kernels::dropoutBackward<double> (n, Activation::TanH, p, key, 7, 0, ya.data(), dY.data(), dX.data());
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double t = std::tanh (a[i]);
+        CHECK (ya[i] == doctest::Approx (y[i] * t));
+        CHECK (dX[i] == doctest::Approx (y[i] * (1.0 - t * t)));
+    }
+}
+
+TEST_CASE ("Random streams are reproducible across chunks and thread counts")
+{
+    const uint64_t key = splitMix64 (7), stream = streamId (3, 11);
+
+    // The sequential reader and the bulk fills read the same stream
+    const size_t n = 5001;
+    std::vector<double> uniform (n), normal (n);
+    std::vector<float> uniformF (n);
+    kernels::fillUniform<double> (n, uniform.data(), -2.0, 3.0, key, stream);
+    kernels::fillUniform<float> (n, uniformF.data(), 0.0f, 1.0f, key, stream);
+    kernels::fillNormal<double> (n, normal.data(), 0.0, 1.0, key, stream);
+
+    RandomStream reader (7, stream);
+    for (size_t i = 0; i < n; ++i) CHECK (uniform[i] == reader.uniform (-2.0, 3.0));
+    reader.seek (0);
+    for (size_t i = 0; i < n; ++i) CHECK (uniformF[i] == unitFloat (reader.nextBits()));
+    reader.seek (0);
+    for (size_t i = 0; i < n; ++i) CHECK (normal[i] == reader.normal());
+
+    double mean = 0.0, meanSq = 0.0;
+    for (double z : normal)
+    {
+        mean += z / n;
+        meanSq += z * z / n;
+    }
+    CHECK (std::abs (mean) < 0.05);
+    CHECK (meanSq == doctest::Approx (1.0).epsilon (0.05));
+    CHECK (*std::min_element (uniform.begin(), uniform.end()) >= -2.0);
+    CHECK (*std::max_element (uniform.begin(), uniform.end()) < 3.0);
+
+    // Any chunking and any pool size give the same numbers
+    std::vector<double> pieces (n);
+    for (size_t start = 0; start < n; start += 333)
+    {
+        const size_t len = std::min<size_t> (333, n - start);
+        kernels::fillNormal<double> (len, pieces.data() + start, 0.0, 1.0, key, stream, start);
+    }
+    CHECK (pieces == normal);
+
+    const size_t big = 200003;
+    std::vector<double> serial (big), parallel (big);
+    kernels::fillUniform<double> (big, serial.data(), 0.0, 1.0, key, stream);
+    for (unsigned threads : {1u, 3u, 8u})
+    {
+        BS::thread_pool pool (threads);
+        std::fill (parallel.begin(), parallel.end(), -1.0);
+        kernels::fillUniformParallel<double> (pool, big, parallel.data(), 0.0, 1.0, key, stream);
+        CHECK (parallel == serial);
+    }
+
+    // An explicitly indexed thread stream reads the same numbers on whichever worker asks
+    std::vector<double> drawn (16);
+    BS::thread_pool pool (3);
+    pool.parallelize_loop (size_t (0), drawn.size(), [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i) drawn[i] = threadRandomStream (99, i).uniform();
+    }).wait();
+    for (size_t i = 0; i < drawn.size(); ++i)
+    {
+        CHECK (drawn[i] == RandomStream (99, streamId (0x7468726561640000ull, i)).uniform());
+    }
+
+    // Other streams and seeds are different
+    std::vector<double> other (n);
+    kernels::fillUniform<double> (n, other.data(), -2.0, 3.0, key, streamId (3, 12));
+    CHECK (other != uniform);
+}
+
+TEST_CASE ("Every ISA variant the CPU supports matches the reference")
+{
+    const kernels::Isa original = kernels::activeIsa();
+    kernels::Isa parsed;
+    CHECK (kernels::isaFromName ("AVX2", parsed));
+    CHECK (parsed == kernels::Isa::AVX2);
+    CHECK_FALSE (kernels::isaFromName ("neon", parsed));
+
+    for (kernels::Isa isa : {kernels::Isa::SSE2, kernels::Isa::AVX2, kernels::Isa::AVX512, kernels::Isa::AVX512VNNI})
+    {
+        // Variants above what this CPU supports are clamped, so only test the ones selected
+        if (kernels::setIsa (isa) != isa) continue;
+        CAPTURE (kernels::isaName (isa));
+
+        checkGemm<double> (50, 37, 70, false, false, 1.0, 1.0);
+        checkGemm<float> (50, 37, 70, false, true, 1.0f, 0.0f);
+
+        std::vector<double> x = randomVector<double> (101), y = randomVector<double> (101);
+        double expected = 0.0;
+        for (size_t i = 0; i < x.size(); ++i) expected += x[i] * y[i];
+        CHECK (kernels::dot (x.size(), x.data(), y.data()) == doctest::Approx (expected));
+
+        // Philox blocks side by side, from an unaligned word offset, against the scalar generator
+        std::vector<uint32_t> words (1001);
+        kernels::randomBits (99, 5, 3, words.size(), words.data());
+        for (size_t i = 0; i < words.size(); ++i)
+        {
+            CHECK (words[i] == CounterRng::bits (99, 5, 3 + i));
+        }
+
+        std::vector<double> z = y;
+        kernels::axpy (x.size(), 0.5, x.data(), z.data());
+        for (size_t i = 0; i < z.size(); ++i)
+        {
+            CHECK (z[i] == doctest::Approx (y[i] + 0.5 * x[i]));
+        }
+
+        // Int8 GEMM against a plain loop, with row counts and depths that leave tails
+        const size_t N = 3, M = 7, K = 150;
+        std::vector<int8_t> qx (N * K), qw (M * K);
+        for (auto& v : qx) v = static_cast<int8_t> (std::lround (generateRandomDouble() * 127.0));
+        for (auto& v : qw) v = static_cast<int8_t> (std::lround (generateRandomDouble() * 127.0));
+        std::vector<int32_t> sums (M), acc (N * M);
+        kernels::rowSumsS8 (M, K, qw.data(), K, sums.data());
+        kernels::gemmS8 (N, M, K, qx.data(), K, qw.data(), K, sums.data(), acc.data(), M);
+        for (size_t n = 0; n < N; ++n)
+        {
+            for (size_t i = 0; i < M; ++i)
+            {
+                int32_t s = 0;
+                for (size_t k = 0; k < K; ++k) s += qx[n * K + k] * qw[i * K + k];
+                CHECK (acc[n * M + i] == s);
+            }
+        }
+
+        // Widening dot product of 16-bit weights
+        std::vector<float> xf (x.begin(), x.end());
+        std::vector<kernels::fp16> hf (xf.size());
+        kernels::convert (xf.size(), xf.data(), hf.data());
+        float halfExpected = 0.0f;
+        for (size_t i = 0; i < xf.size(); ++i) halfExpected += kernels::toFloat (hf[i]) * xf[i];
+        CHECK (kernels::dotHalf (hf.size(), hf.data(), xf.data()) == doctest::Approx (halfExpected).epsilon (1e-5));
+
+        std::vector<float> tf (xf.size());
+        kernels::vtanh (xf.size(), xf.data(), tf.data());
+        for (size_t i = 0; i < xf.size(); ++i)
+        {
+            CHECK (tf[i] == doctest::Approx (std::tanh (xf[i])).epsilon (1e-6));
+        }
+    }
+    kernels::setIsa (original);
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}
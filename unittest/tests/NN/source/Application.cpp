@@ -87,6 +87,619 @@ TEST_CASE ("Neuron Class Test")
     }
 }
 
+TEST_CASE ("DenseLayer Class Test")
+{
+    // A scalar layer and a matrix-backed copy of it must compute the same function
+    uint32_t id = 0;
+    Layer layer (3, 2, id);
+    DenseLayer dense (layer);
+
+    // Rows of W start on 64-byte boundaries
+    CHECK (dense.stride() % 8 == 0);
+    CHECK (reinterpret_cast<uintptr_t> (dense.weights()) % 64 == 0);
+    CHECK (dense.parameters().empty());
+
+    // Per-neuron access is a view into the matrix
+    auto& neurons = layer.getNeurons();
+    DenseLayer::NeuronView view = dense.neuron (1);
+    CHECK (view.size() == 3);
+    CHECK (view.weight (2) == doctest::Approx (neurons[1].getWeights()[2]->get_val()));
+    CHECK (view.data() == dense.weights() + dense.stride());
+
+    std::vector<double> values = {1.0, 2.0, 3.0};
+    std::vector<ValuePtr> scalarInput = {ExprNode::Create (values[0]), ExprNode::Create (values[1]), ExprNode::Create (values[2])};
+    std::vector<ValuePtr> denseInput = {ExprNode::Create (values[0]), ExprNode::Create (values[1]), ExprNode::Create (values[2])};
+
+    auto scalarOutput = layer (scalarInput);
+    auto denseOutput = dense (denseInput);
+    REQUIRE (denseOutput.size() == 2);
+
+    ValuePtr scalarLoss = *((*scalarOutput[0] - ExprNode::Create (2.0))->pow (2)) + (*scalarOutput[1] - ExprNode::Create (1.0))->pow (2);
+    ValuePtr denseLoss = *((*denseOutput[0] - ExprNode::Create (2.0))->pow (2)) + (*denseOutput[1] - ExprNode::Create (1.0))->pow (2);
+    CHECK (denseLoss->get_val() == doctest::Approx (scalarLoss->get_val()));
+
+    scalarLoss->backward();
+    denseLoss->backward();
+
+    // Parameter gradients
+    for (size_t n = 0; n < 2; ++n)
+    {
+        DenseLayer::NeuronView v = dense.neuron (n);
+        for (size_t i = 0; i < 3; ++i)
+        {
+            CHECK (v.weight_grad (i) == doctest::Approx (neurons[n].getWeights()[i]->get_grad()));
+        }
+        CHECK (v.bias_grad() == doctest::Approx (neurons[n].getBias()->get_grad()));
+    }
+
+    // Input gradients flow back into the graph
+    for (size_t i = 0; i < 3; ++i)
+    {
+        CHECK (denseInput[i]->get_grad() == doctest::Approx (scalarInput[i]->get_grad()));
+    }
+
+    // sgd_step matches the ExprNode update rule
+    double before = dense.neuron (0).weight (0);
+    double gradient = dense.neuron (0).weight_grad (0);
+    dense.sgd_step (0.1);
+    CHECK (dense.neuron (0).weight (0) == doctest::Approx (before - 0.1 * gradient));
+
+    dense.zero_grad();
+    CHECK (dense.neuron (0).weight_grad (0) == doctest::Approx (0.0));
+    CHECK (dense.neuron (1).bias_grad() == doctest::Approx (0.0));
+
+    // A graph holds the layer's storage rather than the layer, so it still backpropagates
+    // after the layer that built it has been moved
+    DenseLayer reference (layer), source (layer);
+    std::vector<ValuePtr> referenceInput = {ExprNode::Create (values[0]), ExprNode::Create (values[1]), ExprNode::Create (values[2])};
+    std::vector<ValuePtr> movedInput = {ExprNode::Create (values[0]), ExprNode::Create (values[1]), ExprNode::Create (values[2])};
+    auto referenceOutput = reference (referenceInput);
+    auto movedOutput = source (movedInput);
+    DenseLayer moved (std::move (source));
+    (*referenceOutput[0] * referenceOutput[1])->backward();
+    (*movedOutput[0] * movedOutput[1])->backward();
+    for (size_t i = 0; i < 3; ++i)
+    {
+        CHECK (moved.neuron (1).weight_grad (i) == doctest::Approx (reference.neuron (1).weight_grad (i)));
+        CHECK (movedInput[i]->get_grad() == doctest::Approx (referenceInput[i]->get_grad()));
+    }
+}
+
+TEST_CASE ("SparseInputLayer Class Test")
+{
+    // A wide one-hot input through a scalar layer and through its sparse-input copy
+    const size_t D = 300;
+    uint32_t id = 0;
+    Layer layer (D, 4, id);
+    SparseInputLayer sparse (layer);
+    REQUIRE (sparse.inputs() == D);
+    REQUIRE (sparse.size() == 4);
+
+    SparseSample sample = {{7, 1.0}, {120, 1.0}, {299, 0.5}};
+    std::vector<ValuePtr> scalarInput;
+    for (size_t j = 0; j < D; ++j) scalarInput.push_back (ExprNode::Create (0.0));
+    for (const SparseFeature& f : sample) scalarInput[f.index]->set_val (f.value);
+
+    auto scalarOutput = layer (scalarInput);
+    auto sparseOutput = sparse (sample);
+    REQUIRE (sparseOutput.size() == 4);
+
+    ValuePtr scalarLoss = *((*scalarOutput[0] - ExprNode::Create (1.0))->pow (2)) + (*scalarOutput[3] * scalarOutput[1]);
+    ValuePtr sparseLoss = *((*sparseOutput[0] - ExprNode::Create (1.0))->pow (2)) + (*sparseOutput[3] * sparseOutput[1]);
+    CHECK (sparseLoss->get_val() == doctest::Approx (scalarLoss->get_val()));
+    scalarLoss->backward();
+    sparseLoss->backward();
+
+    // Gradients of the active columns match, and only those columns were touched
+    auto& neurons = layer.getNeurons();
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (const SparseFeature& f : sample)
+        {
+            CHECK (sparse.weight_grad (i, f.index) == doctest::Approx (neurons[i].getWeights()[f.index]->get_grad()));
+        }
+        CHECK (sparse.bias_grads()[i] == doctest::Approx (neurons[i].getBias()->get_grad()));
+    }
+    CHECK (sparse.touched_columns().size() == 3);
+
+    // sgd_step moves the active columns only
+    const double active = sparse.weight (2, 120), inactive = sparse.weight (2, 121);
+    const double gradient = sparse.weight_grad (2, 120);
+    sparse.sgd_step (0.1);
+    CHECK (sparse.weight (2, 120) == doctest::Approx (active - 0.1 * gradient));
+    CHECK (sparse.weight (2, 121) == inactive);
+
+    sparse.zero_grad();
+    CHECK (sparse.touched_columns().empty());
+    CHECK (sparse.weight_grad (2, 120) == 0.0);
+
+    // The batched Tensor path accumulates the same gradients as the per-sample graphs
+    std::vector<SparseSample> batch = {{{3, 1.0}, {50, -2.0}}, {{3, 1.0}}, {}};
+    TensorPtr Y = sparse (batch);
+    REQUIRE (Y->size (0) == 3);
+    Tensor::sum (Y)->backward();
+    std::vector<double> batchedGrad = {sparse.weight_grad (1, 3), sparse.weight_grad (1, 50), sparse.bias_grads()[1]};
+
+    sparse.zero_grad();
+    for (const SparseSample& s : batch)
+    {
+        auto outputs = sparse (s);
+        ValuePtr total = outputs[0];
+        for (size_t i = 1; i < outputs.size(); ++i) total = *total + outputs[i];
+        total->backward();
+
+        std::vector<double> y (4);
+        sparse.forward (s, y.data());
+        for (size_t i = 0; i < 4; ++i) CHECK (outputs[i]->get_val() == doctest::Approx (y[i]));
+    }
+    CHECK (sparse.weight_grad (1, 3) == doctest::Approx (batchedGrad[0]));
+    CHECK (sparse.weight_grad (1, 50) == doctest::Approx (batchedGrad[1]));
+    CHECK (sparse.bias_grads()[1] == doctest::Approx (batchedGrad[2]));
+
+    // Both graph forms hold the layer's storage rather than the layer, so they still
+    // backpropagate after the layer that built them has been moved
+    SparseInputLayer source (sparse);
+    source.zero_grad();
+    TensorPtr movedY = source (batch);
+    auto movedOutputs = source (batch[1]);
+    SparseInputLayer moved (std::move (source));
+    Tensor::sum (movedY)->backward();
+    CHECK (moved.weight_grad (1, 50) == doctest::Approx (batchedGrad[1]));
+    moved.zero_grad();
+    movedOutputs[1]->backward();
+    const double y1 = movedOutputs[1]->get_val();
+    CHECK (moved.weight_grad (1, 3) == doctest::Approx (1.0 - y1 * y1));
+}
+
+TEST_CASE ("Embedding Class Test")
+{
+    const size_t count = 40, dim = 5;
+    const double decay = 0.1;
+    Embedding embedding (count, dim, decay);
+
+    // Lookups are views into the table
+    Embedding::RowView view = embedding.row (7);
+    CHECK (view.size() == dim);
+    CHECK (view.data() == embedding.data() + 7 * embedding.stride());
+    CHECK (reinterpret_cast<uintptr_t> (view.data()) % 64 == 0);
+
+    // An eager reference: every row decays every step
+    std::vector<double> reference (count * dim);
+    for (uint32_t id = 0; id < count; ++id)
+    {
+        for (size_t k = 0; k < dim; ++k) reference[id * dim + k] = embedding.row (id)[k];
+    }
+
+    const std::vector<std::vector<uint32_t>> batches = {{1, 2, 1}, {30}, {2, 39, 30, 2}, {}, {5}};
+    for (size_t step = 0; step < batches.size(); ++step)
+    {
+        const double lr = 0.05 * (step + 1);
+        const auto& ids = batches[step];
+
+        embedding.zero_grad();
+        if (!ids.empty())
+        {
+            // loss = sum of the looked-up vectors weighted by their position in the batch
+            TensorPtr E = embedding (ids);
+            std::vector<double> weights (ids.size() * dim);
+            for (size_t n = 0; n < ids.size(); ++n)
+            {
+                for (size_t k = 0; k < dim; ++k) weights[n * dim + k] = double (n + 1);
+            }
+            TensorPtr Wt = Tensor::FromData ({ids.size(), dim}, weights);
+            Wt->set_requires_grad (false);
+            Tensor::sum (Tensor::mul (E, Wt))->backward();
+        }
+
+        std::set<uint32_t> distinct (ids.begin(), ids.end());
+        CHECK (embedding.touched_rows().size() == distinct.size());
+
+        std::vector<double> g (count * dim, 0.0);
+        for (size_t n = 0; n < ids.size(); ++n)
+        {
+            for (size_t k = 0; k < dim; ++k) g[ids[n] * dim + k] += double (n + 1);
+        }
+        for (size_t i = 0; i < reference.size(); ++i) reference[i] -= lr * (g[i] + decay * reference[i]);
+
+        embedding.sgd_step (lr);
+    }
+
+    CHECK (embedding.grad (5) != nullptr);
+    CHECK (embedding.grad (6) == nullptr);
+
+    // Untouched and touched rows alike match the eager updates to rounding once read
+    for (uint32_t id = 0; id < count; ++id)
+    {
+        Embedding::RowView r = embedding.row (id);
+        for (size_t k = 0; k < dim; ++k)
+        {
+            CHECK (r[k] == doctest::Approx (reference[id * dim + k]).epsilon (1e-12));
+        }
+    }
+
+    // The decay factor 1 - lr * decay must stay positive
+    CHECK_THROWS_AS (embedding.sgd_step (1.0 / decay), std::invalid_argument);
+    CHECK_THROWS_AS (Embedding (count, dim, -0.1), std::invalid_argument);
+
+    // A lookup Tensor holds the sparse gradient rather than the layer, so it still
+    // backpropagates after the layer that built it has been moved
+    embedding.zero_grad();
+    TensorPtr E = embedding ({3, 3});
+    Embedding moved (std::move (embedding));
+    Tensor::sum (E)->backward();
+    REQUIRE (moved.grad (3) != nullptr);
+    CHECK (moved.grad (3)[0] == doctest::Approx (2.0));
+    CHECK (moved.touched_rows().size() == 1);
+}
+
+TEST_CASE ("MLP Batched Forward And Backward")
+{
+    // One batched step must match N single-sample passes through the scalar graph
+    const size_t N = 5, D = 3, K = 2;
+    MLP mlp (D, {4, 4, K}, false);
+
+    std::vector<double> x (N * D), t (N * K);
+    for (auto& v : x) v = generateRandomDouble();
+    for (auto& v : t) v = generateRandomDouble();
+
+    TensorPtr X = Tensor::FromData ({N, D}, x);
+    TensorPtr T = Tensor::FromData ({N, K}, t);
+    X->set_requires_grad (false);
+    T->set_requires_grad (false);
+
+    TensorPtr prediction = mlp (X);
+    REQUIRE (prediction->shape() == Tensor::Shape{N, K});
+
+    mlp.zero_grad();
+    TensorPtr loss = Tensor::mseLoss (prediction, T);
+    loss->backward();
+
+    std::vector<double> batchedGrads;
+    for (auto& p : mlp.parameters())
+    {
+        batchedGrads.push_back (p->get_grad());
+    }
+
+    // The batched loss is the mean over all N * K outputs, so each sample contributes
+    // its squared error divided by N * K
+    mlp.zero_grad();
+    for (size_t n = 0; n < N; ++n)
+    {
+        std::vector<ValuePtr> sample;
+        for (size_t j = 0; j < D; ++j)
+        {
+            sample.push_back (ExprNode::Create (x[n * D + j]));
+        }
+        std::vector<ValuePtr> output = mlp (sample);
+
+        ValuePtr sampleLoss = ExprNode::Create (0.0);
+        for (size_t k = 0; k < K; ++k)
+        {
+            CHECK (prediction->at (n, k) == doctest::Approx (output[k]->get_val()));
+            ValuePtr diff = *output[k] - ExprNode::Create (t[n * K + k]);
+            sampleLoss = *sampleLoss + *diff * diff;
+        }
+        sampleLoss = *sampleLoss / static_cast<double> (N * K);
+        sampleLoss->backward();
+    }
+
+    auto params = mlp.parameters();
+    REQUIRE (params.size() == batchedGrads.size());
+    for (size_t i = 0; i < params.size(); ++i)
+    {
+        CHECK (batchedGrads[i] == doctest::Approx (params[i]->get_grad()));
+    }
+}
+
+TEST_CASE ("Quantized MLP Tracks The Double Precision MLP")
+{
+    // Layers wider than 64 inputs exercise the int8 kernels' full blocks as well as the tails
+    const size_t N = 200, D = 70;
+    MLP mlp (D, {100, 40, 3}, false);
+
+    std::vector<std::vector<double>> calibration (N, std::vector<double> (D));
+    std::vector<double> x;
+    for (auto& sample : calibration)
+    {
+        for (auto& v : sample)
+        {
+            v = generateRandomDouble();
+            x.push_back (v);
+        }
+    }
+
+    QuantizedMLP quantized (mlp, calibration);
+    REQUIRE (quantized.inputs() == D);
+    REQUIRE (quantized.outputs() == 3);
+
+    TensorPtr X = Tensor::FromData ({N, D}, x);
+    X->set_requires_grad (false);
+    std::vector<double> expected = mlp (X)->to_vector();
+
+    std::vector<double> y (N * 3);
+    quantized.forward (x.data(), N, y.data());
+
+    // Random weights in [-1, 1] give pre-activations of several units, so the rounding error
+    // of 70-100 products adds up to a few hundredths on the outputs in the steep part of tanh
+    double maxError = 0.0, meanError = 0.0;
+    for (size_t i = 0; i < y.size(); ++i)
+    {
+        maxError = std::max (maxError, std::abs (y[i] - expected[i]));
+        meanError += std::abs (y[i] - expected[i]) / y.size();
+    }
+    CAPTURE (maxError);
+    CHECK (meanError < 0.02);
+    CHECK (maxError < 0.25);
+
+    // The single-sample path runs the same kernels
+    std::vector<double> first = quantized (calibration[0]);
+    for (size_t k = 0; k < 3; ++k)
+    {
+        CHECK (first[k] == y[k]);
+    }
+
+    // One input more than the accumulators allow is refused before anything is quantized
+    MLP tooWide (static_cast<int> (kernels::Int8MaxDepth + 1), {1}, false);
+    CHECK_THROWS_AS (QuantizedMLP (tooWide, calibration), std::invalid_argument);
+}
+
+TEST_CASE_TEMPLATE ("Packed MLP Tracks The Double Precision MLP", T, double, float, kernels::bf16, kernels::fp16)
+{
+    const size_t N = 20, D = 40;
+    MLP mlp (D, {50, 30, 2}, false);
+    PackedMLP<T> packed (mlp);
+    REQUIRE (packed.inputs() == D);
+    REQUIRE (packed.outputs() == 2);
+    CHECK (packed.weightBytes() == (40 * 50 + 50 * 30 + 30 * 2) * sizeof (T) + (50 + 30 + 2) * sizeof (typename PackedMLP<T>::Compute));
+
+    std::vector<double> x (N * D);
+    for (auto& v : x) v = generateRandomDouble();
+    TensorPtr X = Tensor::FromData ({N, D}, x);
+    X->set_requires_grad (false);
+    std::vector<double> expected = mlp (X)->to_vector();
+
+    std::vector<double> y (N * 2);
+    packed.forward (x.data(), N, y.data());
+
+    // bf16 keeps 8 significant bits, fp16 11 and float 24
+    const double tolerance = std::is_same_v<T, double> ? 1e-12 : std::is_same_v<T, float> ? 1e-4 : std::is_same_v<T, kernels::fp16> ? 0.02 : 0.1;
+    for (size_t i = 0; i < y.size(); ++i)
+    {
+        CHECK (std::abs (y[i] - expected[i]) < tolerance);
+    }
+
+    std::vector<double> first = packed (std::vector<double> (x.begin(), x.begin() + D));
+    CHECK (std::abs (first[0] - expected[0]) < tolerance);
+}
+
+TEST_CASE ("Pruned MLP Matches Its Sparse Form")
+{
+    const size_t N = 12, D = 30;
+
+    SUBCASE ("Global threshold")
+    {
+        MLP mlp (D, {40, 20, 2}, false);
+        const size_t total = 30 * 40 + 40 * 20 + 20 * 2;
+        CHECK (magnitudePrune (mlp, 0.8) == static_cast<size_t> (0.8 * total));
+
+        SparseMLP sparse (mlp);
+        CHECK (sparse.nonZeros() == total - static_cast<size_t> (0.8 * total));
+        CHECK (sparse.density() == doctest::Approx (0.2).epsilon (0.01));
+
+        std::vector<double> x (N * D);
+        for (auto& v : x) v = generateRandomDouble();
+        TensorPtr X = Tensor::FromData ({N, D}, x);
+        X->set_requires_grad (false);
+        std::vector<double> expected = mlp (X)->to_vector();
+
+        std::vector<double> y (N * 2);
+        sparse.forward (x.data(), N, y.data());
+        for (size_t i = 0; i < y.size(); ++i)
+        {
+            CHECK (y[i] == doctest::Approx (expected[i]));
+        }
+    }
+
+    SUBCASE ("Per-layer threshold keeps the fraction in every layer")
+    {
+        MLP mlp (D, {40, 20, 2}, false);
+        std::vector<std::vector<double>> before;
+        for (Layer& layer : mlp.getLayers())
+        {
+            before.emplace_back();
+            for (Neuron& neuron : layer.getNeurons())
+            {
+                for (const auto& w : neuron.getWeights()) before.back().push_back (std::abs (w->get_val()));
+            }
+        }
+        magnitudePrune (mlp, 0.5, PruneScope::PerLayer);
+
+        // The pruned weights are the smallest of their layer
+        for (size_t l = 0; l < before.size(); ++l)
+        {
+            double largestPruned = 0.0, smallestKept = 1e300;
+            size_t zeros = 0, k = 0;
+            for (Neuron& neuron : mlp.getLayers()[l].getNeurons())
+            {
+                for (const auto& w : neuron.getWeights())
+                {
+                    if (w->get_val() == 0.0)
+                    {
+                        ++zeros;
+                        largestPruned = std::max (largestPruned, before[l][k]);
+                    }
+                    else smallestKept = std::min (smallestKept, before[l][k]);
+                    ++k;
+                }
+            }
+            CHECK (zeros == before[l].size() / 2);
+            CHECK (largestPruned <= smallestKept);
+        }
+
+        SparseMLP sparse (mlp);
+        for (SparseLayer& layer : sparse.getLayers())
+        {
+            CHECK (layer.density() == doctest::Approx (0.5).epsilon (0.05));
+        }
+    }
+
+    SUBCASE ("Sparse gradients match the ExprNode graph")
+    {
+        MLP mlp (D, {16, 3}, false);
+        magnitudePrune (mlp, 0.6);
+        Layer& layer = mlp.getLayers()[0];
+        SparseLayer sparse (layer);
+
+        std::vector<double> x (D);
+        std::vector<ValuePtr> inputs;
+        for (auto& v : x)
+        {
+            v = generateRandomDouble();
+            inputs.push_back (ExprNode::Create (v));
+        }
+
+        // loss = sum of the layer's outputs, so dY is all ones
+        std::vector<ValuePtr> outputs = layer (inputs);
+        ValuePtr loss = outputs[0];
+        for (size_t i = 1; i < outputs.size(); ++i) loss = *loss + outputs[i];
+        loss->backward();
+
+        std::vector<double> y (16), dY (16, 1.0), dX (D, 0.0);
+        sparse.forward (x.data(), 1, y.data());
+        sparse.backward (x.data(), 1, y.data(), dY.data(), dX.data());
+
+        const auto& W = sparse.weights();
+        auto& neurons = layer.getNeurons();
+        for (size_t i = 0; i < W.rows; ++i)
+        {
+            for (uint32_t k = W.rowStart[i]; k < W.rowStart[i + 1]; ++k)
+            {
+                CHECK (sparse.weight_grads()[k] == doctest::Approx (neurons[i].getWeights()[W.columns[k]]->get_grad()));
+            }
+            CHECK (sparse.bias_grads()[i] == doctest::Approx (neurons[i].getBias()->get_grad()));
+        }
+        for (size_t j = 0; j < D; ++j)
+        {
+            CHECK (dX[j] == doctest::Approx (inputs[j]->get_grad()));
+        }
+    }
+}
+
+TEST_CASE ("Structured Pruning Removes Dead Neurons")
+{
+    const size_t N = 64, D = 12;
+    MLP mlp (D, {24, 16, 2}, false);
+    auto& layers = mlp.getLayers();
+
+    // Every third neuron of the first layer is dead: constant input, saturated output
+    for (size_t j = 0; j < 24; j += 3)
+    {
+        Neuron& neuron = layers[0].getNeurons()[j];
+        for (const auto& w : neuron.getWeights()) w->set_val (0.0);
+        neuron.getBias()->set_val (4.0);
+    }
+    // The next layer ignores neurons 1 and 2 of the second layer
+    for (Neuron& neuron : layers[2].getNeurons())
+    {
+        neuron.getWeights()[1]->set_val (1e-9);
+        neuron.getWeights()[2]->set_val (0.0);
+    }
+
+    std::vector<std::vector<double>> samples (N, std::vector<double> (D));
+    std::vector<double> x;
+    for (auto& sample : samples)
+    {
+        for (auto& v : sample)
+        {
+            v = generateRandomDouble();
+            x.push_back (v);
+        }
+    }
+
+    NeuronImportance scores = neuronImportance (mlp, samples);
+    REQUIRE (scores.importance.size() == 2);
+    CHECK (scores.importance[0][0] == doctest::Approx (0.0));
+    CHECK (scores.mean[0][0] == doctest::Approx (std::tanh (4.0)));
+    CHECK (scores.importance[0][1] > 0.1);
+
+    const uint64_t drawn = threadRandomStream (12345).position();
+    std::unique_ptr<MLP> pruned = pruneNeurons (mlp, samples, 1e-6, false);
+    CHECK (threadRandomStream (12345).position() == drawn);
+    auto& prunedLayers = pruned->getLayers();
+    REQUIRE (prunedLayers.size() == 3);
+    CHECK (prunedLayers[0].size() == 16);
+    CHECK (prunedLayers[1].size() == 14);
+    CHECK (prunedLayers[2].size() == 2);
+
+    TensorPtr X = Tensor::FromData ({N, D}, x);
+    X->set_requires_grad (false);
+    std::vector<double> expected = mlp (X)->to_vector();
+    std::vector<double> y = (*pruned) (X)->to_vector();
+    for (size_t i = 0; i < y.size(); ++i)
+    {
+        CHECK (y[i] == doctest::Approx (expected[i]).epsilon (1e-6));
+    }
+
+    // A tolerance above every score still keeps one neuron per layer
+    std::unique_ptr<MLP> minimal = pruneNeurons (mlp, samples, 1e300, false);
+    CHECK (minimal->getLayers()[0].size() == 1);
+    CHECK (minimal->getLayers()[1].size() == 1);
+    CHECK (minimal->getLayers()[2].size() == 2);
+}
+
+TEST_CASE ("Seeded Initialization Is Independent Of The Thread Count")
+{
+    const int in = 300, out = 70;
+    const uint64_t seed = 2024;
+
+    // One layer built on pools of different sizes
+    std::vector<std::vector<double>> runs;
+    for (unsigned threads : {1u, 3u, 8u})
+    {
+        BS::thread_pool pool (threads);
+        Layer layer (in, out, 1, WeightInit::XavierUniform, seed, pool);
+        std::vector<double> w;
+        for (auto& p : layer.parameters()) w.push_back (p->get_val());
+        runs.push_back (w);
+    }
+    CHECK (runs[0] == runs[1]);
+    CHECK (runs[0] == runs[2]);
+
+    // The MLP, Layer, DenseLayer and TensorLayer initializations agree for the same seed and index
+    MLP mlp (in, {out, 5}, WeightInit::XavierUniform, seed, false);
+    BS::thread_pool pool (4);
+    Layer layer (in, out, 0, WeightInit::XavierUniform, seed, pool);
+    DenseLayer dense (in, out, Activation::TanH, WeightInit::XavierUniform, seed, 0, pool);
+    TensorLayer tensor (in, out, Activation::TanH, WeightInit::XavierUniform, seed, 0, pool);
+    const double bound = std::sqrt (6.0 / (in + out));
+    auto& neurons = mlp.getLayers()[0].getNeurons();
+    for (int i = 0; i < out; ++i)
+    {
+        for (int j = 0; j < in; ++j)
+        {
+            const double w = neurons[i].getWeights()[j]->get_val();
+            CHECK (std::abs (w) <= bound);
+            CHECK (layer.getNeurons()[i].getWeights()[j]->get_val() == w);
+            CHECK (dense.neuron (i).weight (j) == w);
+            CHECK (tensor.weights()->at (i, j) == w);
+        }
+        CHECK (neurons[i].getBias()->get_val() == 0.0);
+    }
+    MLP other (in, {out, 5}, WeightInit::XavierUniform, seed + 1, false);
+    CHECK (other.getLayers()[0].getNeurons()[0].getWeights()[0]->get_val() != neurons[0].getWeights()[0]->get_val());
+
+    // He normal: zero mean and variance 2 / fanIn
+    TensorPtr W = Tensor::Initialized ({256, 512}, WeightInit::HeNormal, seed, 3, pool);
+    double mean = 0.0, meanSq = 0.0;
+    for (double w : W->to_vector())
+    {
+        mean += w / W->numel();
+        meanSq += w * w / W->numel();
+    }
+    CHECK (std::abs (mean) < 0.003);
+    CHECK (meanSq == doctest::Approx (2.0 / 512).epsilon (0.03));
+}
+
 class Application : public Jahley::App
 {
  public:
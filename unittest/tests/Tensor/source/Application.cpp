@@ -0,0 +1,702 @@
+﻿#include "Jahley.h"
+
+const std::string APP_NAME = "Tensor";
+
+#ifdef CHECK
+#undef CHECK
+#endif
+
+#define DOCTEST_CONFIG_IMPLEMENT
+#include <doctest/doctest.h>
+
+#include <json/json.hpp>
+using nlohmann::json;
+
+// Central difference estimate of d(loss)/d(param[i]) for every stride-th element of param;
+// the elements in between are left at zero. 'loss' rebuilds the graph from scratch and
+// returns the scalar loss value.
+static std::vector<double> numericGradient (TensorPtr param, const std::function<double()>& loss, double h = 1e-6, size_t stride = 1)
+{
+    std::vector<double> g (param->numel());
+    double* p = param->data();
+    for (size_t i = 0; i < param->numel(); i += stride)
+    {
+        double saved = p[i];
+        p[i] = saved + h;
+        double up = loss();
+        p[i] = saved - h;
+        double down = loss();
+        p[i] = saved;
+        g[i] = (up - down) / (2.0 * h);
+    }
+    return g;
+}
+
+// Compares the analytic gradient with finite differences. A stride above one samples every
+// stride-th element, which keeps the check affordable on large parameters.
+static void checkGradient (TensorPtr param, const std::function<TensorPtr()>& build, size_t stride = 1)
+{
+    param->zero_grad();
+    build()->backward();
+    std::vector<double> analytic = param->grad_vector();
+    std::vector<double> numeric = numericGradient (param, [&]() { return build()->item(); }, 1e-6, stride);
+
+    for (size_t i = 0; i < analytic.size(); i += stride)
+    {
+        CHECK (analytic[i] == doctest::Approx (numeric[i]).epsilon (1e-5));
+    }
+}
+
+TEST_CASE ("Tensor storage and views")
+{
+    TensorPtr a = Tensor::FromData ({2, 3}, {1, 2, 3, 4, 5, 6});
+
+    // Storage is 64-byte aligned
+    CHECK (reinterpret_cast<uintptr_t> (a->data()) % 64 == 0);
+    CHECK (a->is_contiguous());
+    CHECK (a->at (1, 2) == doctest::Approx (6.0));
+
+    SUBCASE ("Transpose is a view sharing storage")
+    {
+        TensorPtr t = a->transpose();
+        CHECK (t->shape() == Tensor::Shape{3, 2});
+        CHECK_FALSE (t->is_contiguous());
+        CHECK (t->at (2, 1) == doctest::Approx (6.0));
+
+        a->at (0, 2) = 10.0;
+        CHECK (t->at (2, 0) == doctest::Approx (10.0));
+
+        std::vector<double> values = t->to_vector();
+        CHECK (values == std::vector<double>{1, 4, 2, 5, 10, 6});
+    }
+
+    SUBCASE ("Reshape keeps row-major order")
+    {
+        TensorPtr r = a->reshape ({3, 2});
+        CHECK (r->at (2, 0) == doctest::Approx (5.0));
+    }
+}
+
+TEST_CASE ("Tensor ops forward")
+{
+    TensorPtr a = Tensor::FromData ({2, 3}, {1, 2, 3, 4, 5, 6});
+    TensorPtr b = Tensor::FromData ({3, 2}, {7, 8, 9, 10, 11, 12});
+
+    SUBCASE ("MatMul")
+    {
+        TensorPtr c = Tensor::matmul (a, b);
+        CHECK (c->to_vector() == std::vector<double>{58, 64, 139, 154});
+    }
+
+    SUBCASE ("Broadcast add of a row vector")
+    {
+        TensorPtr bias = Tensor::FromData ({3}, {10, 20, 30});
+        TensorPtr c = Tensor::add (a, bias);
+        CHECK (c->to_vector() == std::vector<double>{11, 22, 33, 14, 25, 36});
+    }
+
+    SUBCASE ("Broadcast mul of a column vector")
+    {
+        TensorPtr col = Tensor::FromData ({2, 1}, {2, 3});
+        TensorPtr c = Tensor::mul (a, col);
+        CHECK (c->to_vector() == std::vector<double>{2, 4, 6, 12, 15, 18});
+    }
+
+    SUBCASE ("Reductions")
+    {
+        CHECK (Tensor::sum (a)->item() == doctest::Approx (21.0));
+        CHECK (Tensor::mean (a)->item() == doctest::Approx (3.5));
+        CHECK (Tensor::sum (a, 0)->to_vector() == std::vector<double>{5, 7, 9});
+        CHECK (Tensor::sum (a, 1)->to_vector() == std::vector<double>{6, 15});
+    }
+}
+
+TEST_CASE ("Tensor gradients match finite differences")
+{
+    TensorPtr x = Tensor::FromData ({3, 4}, {0.1, -0.2, 0.3, 0.4, -0.5, 0.6, 0.7, -0.8, 0.9, 1.0, -1.1, 0.2});
+    TensorPtr W = Tensor::FromData ({2, 4}, {0.5, -0.3, 0.2, 0.1, -0.4, 0.6, -0.2, 0.3});
+    TensorPtr b = Tensor::FromData ({2}, {0.1, -0.2});
+    TensorPtr target = Tensor::FromData ({3, 2}, {0.5, -0.5, 0.1, 0.2, -0.3, 0.4});
+
+    SUBCASE ("MatMul through a transposed view")
+    {
+        auto build = [&]() { return Tensor::mseLoss (Tensor::tanH (Tensor::matmul (x, W->transpose())), target); };
+        checkGradient (W, build);
+        checkGradient (x, build);
+    }
+
+    SUBCASE ("Broadcast add and elementwise activations")
+    {
+        auto build = [&]() {
+            TensorPtr h = Tensor::add (Tensor::matmul (x, W->transpose()), b);
+            return Tensor::sum (Tensor::mul (Tensor::sigmoid (h), Tensor::relu (h)));
+        };
+        checkGradient (b, build);
+        checkGradient (W, build);
+    }
+
+    SUBCASE ("Fused dense op")
+    {
+        for (Activation act : {Activation::TanH, Activation::Sigmoid, Activation::None})
+        {
+            auto build = [&]() { return Tensor::mseLoss (Tensor::dense (x, W, b, act), target); };
+            checkGradient (W, build);
+            checkGradient (b, build);
+            checkGradient (x, build);
+        }
+    }
+
+    SUBCASE ("Fused dense op with frozen weights")
+    {
+        W->set_requires_grad (false);
+        b->set_requires_grad (false);
+        auto build = [&]() { return Tensor::mseLoss (Tensor::dense (x, W, b, Activation::TanH), target); };
+        checkGradient (x, build);
+        CHECK_FALSE (W->has_grad());
+        CHECK_FALSE (b->has_grad());
+    }
+
+    SUBCASE ("Softmax cross-entropy")
+    {
+        std::vector<int> labels = {1, 0, 1};
+        auto build = [&]() { return Tensor::softmaxCrossEntropy (Tensor::dense (x, W, b, Activation::None), labels); };
+        checkGradient (W, build);
+        checkGradient (b, build);
+    }
+}
+
+TEST_CASE ("TensorLayer matches the scalar Layer")
+{
+    Layer layer (3, 2, 0);
+    TensorLayer tensorLayer (layer);
+
+    std::vector<double> values = {1.0, -2.0, 0.5};
+    std::vector<ValuePtr> input = {ExprNode::Create (values[0]), ExprNode::Create (values[1]), ExprNode::Create (values[2])};
+
+    // Scalar path
+    auto output = layer (input);
+    ValuePtr loss = *(output[0]->pow (2)) + output[1]->pow (2);
+    loss->backward();
+
+    // Tensor path: one fused node for the whole layer
+    TensorPtr x = Tensor::FromData ({1, 3}, values);
+    TensorPtr y = tensorLayer (x);
+    TensorPtr tensorLoss = Tensor::sum (Tensor::mul (y, y));
+    tensorLoss->backward();
+
+    CHECK (y->get_op() == "Dense");
+    CHECK (y->at (0, 0) == doctest::Approx (output[0]->get_val()));
+    CHECK (y->at (0, 1) == doctest::Approx (output[1]->get_val()));
+    CHECK (tensorLoss->item() == doctest::Approx (loss->get_val()));
+
+    // Gradients land in the same order as Layer::parameters(): weights then bias per neuron
+    auto params = layer.parameters();
+    double* dW = tensorLayer.weights()->grad();
+    double* db = tensorLayer.biases()->grad();
+    for (size_t n = 0; n < 2; ++n)
+    {
+        for (size_t i = 0; i < 3; ++i)
+        {
+            CHECK (dW[n * 3 + i] == doctest::Approx (params[n * 4 + i]->get_grad()));
+        }
+        CHECK (db[n] == doctest::Approx (params[n * 4 + 3]->get_grad()));
+    }
+
+    // zero_grad clears tensor parameters too
+    tensorLayer.zero_grad();
+    CHECK (tensorLayer.weights()->grad()[0] == doctest::Approx (0.0));
+}
+
+TEST_CASE ("Convolutions match the direct loops and finite differences")
+{
+    // 2 samples, 2 channels of 5 x 6, 3 filters of 3 x 3, stride 2 vertically, padding 1
+    const size_t N = 2, C = 2, H = 5, Wd = 6, F = 3, K = 3;
+    std::vector<double> xv (N * C * H * Wd), wv (F * C * K * K);
+    for (auto& v : xv) v = generateRandomDouble();
+    for (auto& v : wv) v = 0.3 * generateRandomDouble();
+    TensorPtr x = Tensor::FromData ({N, C, H, Wd}, xv);
+    TensorPtr W = Tensor::FromData ({F, C, K, K}, wv);
+    TensorPtr b = Tensor::FromData ({F}, {0.1, -0.2, 0.05});
+
+    TensorPtr y = Tensor::conv2d (x, W, b, {2, 1}, {1, 1}, Activation::TanH);
+    const size_t OH = (H + 2 - K) / 2 + 1, OW = Wd + 2 - K + 1;
+    REQUIRE (y->shape() == Tensor::Shape{N, F, OH, OW});
+
+    for (size_t n = 0; n < N; ++n)
+        for (size_t f = 0; f < F; ++f)
+            for (size_t oy = 0; oy < OH; ++oy)
+                for (size_t ox = 0; ox < OW; ++ox)
+                {
+                    double s = b->at (f);
+                    for (size_t c = 0; c < C; ++c)
+                        for (size_t ki = 0; ki < K; ++ki)
+                            for (size_t kj = 0; kj < K; ++kj)
+                            {
+                                const ptrdiff_t iy = ptrdiff_t (oy * 2 + ki) - 1, ix = ptrdiff_t (ox + kj) - 1;
+                                if (iy < 0 || iy >= ptrdiff_t (H) || ix < 0 || ix >= ptrdiff_t (Wd)) continue;
+                                s += wv[((f * C + c) * K + ki) * K + kj] * xv[((n * C + c) * H + iy) * Wd + ix];
+                            }
+                    CHECK (y->data()[((n * F + f) * OH + oy) * OW + ox] == doctest::Approx (std::tanh (s)));
+                }
+
+    SUBCASE ("Conv2D gradients")
+    {
+        auto build = [&]() { return Tensor::sum (Tensor::mul (Tensor::conv2d (x, W, b, {2, 1}, {1, 1}, Activation::TanH), Tensor::conv2d (x, W, b, {2, 1}, {1, 1}, Activation::TanH))); };
+        checkGradient (W, build);
+        checkGradient (b, build);
+        checkGradient (x, build);
+    }
+
+    SUBCASE ("Conv2D with frozen filters")
+    {
+        W->set_requires_grad (false);
+        b->set_requires_grad (false);
+        auto build = [&]() { return Tensor::sum (Tensor::conv2d (x, W, b, {2, 1}, {1, 1}, Activation::TanH)); };
+        checkGradient (x, build);
+        CHECK_FALSE (W->has_grad());
+        CHECK_FALSE (b->has_grad());
+    }
+
+    SUBCASE ("Conv1D over signal windows")
+    {
+        Conv1D conv (2, 4, 3, 2, 1, Activation::None);
+        TensorPtr signal = Tensor::Random ({3, 2, 9});
+        TensorPtr out = conv (signal);
+        REQUIRE (out->shape() == Tensor::Shape{3, 4, 5});
+
+        const double* w = conv.weights()->data();
+        const double* s = signal->data();
+        for (size_t n = 0; n < 3; ++n)
+            for (size_t f = 0; f < 4; ++f)
+                for (size_t o = 0; o < 5; ++o)
+                {
+                    double expected = 0.0;
+                    for (size_t c = 0; c < 2; ++c)
+                        for (size_t k = 0; k < 3; ++k)
+                        {
+                            const ptrdiff_t i = ptrdiff_t (o * 2 + k) - 1;
+                            if (i >= 0 && i < 9) expected += w[(f * 2 + c) * 3 + k] * s[(n * 2 + c) * 9 + i];
+                        }
+                    CHECK (out->data()[(n * 4 + f) * 5 + o] == doctest::Approx (expected));
+                }
+
+        auto build = [&]() { TensorPtr o = conv (signal); return Tensor::sum (Tensor::mul (o, o)); };
+        checkGradient (conv.weights(), build);
+        checkGradient (signal, build);
+    }
+}
+
+static double sigmoid (double v) { return 1.0 / (1.0 + std::exp (-v)); }
+
+TEST_CASE ("Recurrent layers match the step equations and finite differences")
+{
+    const size_t T = 4, N = 2, In = 3, H = 5;
+    TensorPtr x = Tensor::Random ({T, N, In});
+
+    SUBCASE ("LSTM")
+    {
+        LSTM lstm (In, H, T);
+        auto params = lstm.tensor_parameters();
+        const double* Wx = params[0]->data();
+        const double* Wh = params[1]->data();
+        const double* b = params[2]->data();
+
+        TensorPtr y = lstm (x);
+        REQUIRE (y->shape() == Tensor::Shape{T, N, H});
+
+        // Direct evaluation of the gate equations, one step at a time
+        std::vector<double> h (N * H, 0.0), c (N * H, 0.0);
+        for (size_t t = 0; t < T; ++t)
+        {
+            std::vector<double> hNext (N * H), cNext (N * H);
+            for (size_t n = 0; n < N; ++n)
+                for (size_t k = 0; k < H; ++k)
+                {
+                    double a[4];
+                    for (size_t g = 0; g < 4; ++g)
+                    {
+                        const size_t row = g * H + k;
+                        a[g] = b[row];
+                        for (size_t j = 0; j < In; ++j) a[g] += Wx[row * In + j] * x->data()[(t * N + n) * In + j];
+                        for (size_t j = 0; j < H; ++j) a[g] += Wh[row * H + j] * h[n * H + j];
+                    }
+                    cNext[n * H + k] = sigmoid (a[1]) * c[n * H + k] + sigmoid (a[0]) * std::tanh (a[2]);
+                    hNext[n * H + k] = sigmoid (a[3]) * std::tanh (cNext[n * H + k]);
+                }
+            h = hNext;
+            c = cNext;
+            for (size_t i = 0; i < N * H; ++i)
+            {
+                CHECK (y->data()[t * N * H + i] == doctest::Approx (h[i]));
+            }
+        }
+
+        auto build = [&]() { lstm.resetState(); TensorPtr o = lstm (x); return Tensor::sum (Tensor::mul (o, o)); };
+        for (auto& p : params) checkGradient (p, build);
+        checkGradient (x, build);
+    }
+
+    SUBCASE ("GRU")
+    {
+        GRU gru (In, H, T);
+        auto params = gru.tensor_parameters();
+        for (auto& p : {params[2], params[3]})
+            for (size_t i = 0; i < p->numel(); ++i) p->data()[i] = 0.2 * generateRandomDouble();
+        const double* Wx = params[0]->data();
+        const double* Wh = params[1]->data();
+        const double* bx = params[2]->data();
+        const double* bh = params[3]->data();
+
+        TensorPtr y = gru (x);
+        REQUIRE (y->shape() == Tensor::Shape{T, N, H});
+
+        std::vector<double> h (N * H, 0.0);
+        for (size_t t = 0; t < T; ++t)
+        {
+            std::vector<double> hNext (N * H);
+            for (size_t n = 0; n < N; ++n)
+                for (size_t k = 0; k < H; ++k)
+                {
+                    double ax[3], ah[3];
+                    for (size_t g = 0; g < 3; ++g)
+                    {
+                        const size_t row = g * H + k;
+                        ax[g] = bx[row];
+                        ah[g] = bh[row];
+                        for (size_t j = 0; j < In; ++j) ax[g] += Wx[row * In + j] * x->data()[(t * N + n) * In + j];
+                        for (size_t j = 0; j < H; ++j) ah[g] += Wh[row * H + j] * h[n * H + j];
+                    }
+                    const double r = sigmoid (ax[0] + ah[0]), z = sigmoid (ax[1] + ah[1]);
+                    const double nn = std::tanh (ax[2] + r * ah[2]);
+                    hNext[n * H + k] = (1.0 - z) * nn + z * h[n * H + k];
+                }
+            h = hNext;
+            for (size_t i = 0; i < N * H; ++i)
+            {
+                CHECK (y->data()[t * N * H + i] == doctest::Approx (h[i]));
+            }
+        }
+
+        auto build = [&]() { gru.resetState(); TensorPtr o = gru (x); return Tensor::sum (Tensor::mul (o, o)); };
+        for (auto& p : params) checkGradient (p, build);
+        checkGradient (x, build);
+    }
+
+    SUBCASE ("Truncated BPTT carries the state but not the gradient")
+    {
+        LSTM lstm (In, H, 2);
+        CHECK_THROWS_AS (lstm (x), std::invalid_argument);
+
+        // The whole sequence in one window, as the reference
+        LSTM full (In, H, T);
+        auto src = full.tensor_parameters(), dst = lstm.tensor_parameters();
+        for (size_t i = 0; i < src.size(); ++i) std::copy (src[i]->data(), src[i]->data() + src[i]->numel(), dst[i]->data());
+        TensorPtr reference = full (x);
+
+        std::vector<double> first (x->data(), x->data() + 2 * N * In), second (x->data() + 2 * N * In, x->data() + T * N * In);
+        TensorPtr x1 = Tensor::FromData ({2, N, In}, first);
+        TensorPtr x2 = Tensor::FromData ({2, N, In}, second);
+        TensorPtr y1 = lstm (x1);
+        TensorPtr y2 = lstm (x2);
+        for (size_t i = 0; i < 2 * N * H; ++i)
+        {
+            CHECK (y1->data()[i] == doctest::Approx (reference->data()[i]));
+            CHECK (y2->data()[i] == doctest::Approx (reference->data()[2 * N * H + i]));
+        }
+
+        Tensor::sum (y2)->backward();
+        for (size_t i = 0; i < x1->numel(); ++i) CHECK (x1->grad()[i] == 0.0);
+        bool flows = false;
+        for (size_t i = 0; i < x2->numel(); ++i) flows = flows || x2->grad()[i] != 0.0;
+        CHECK (flows);
+
+        lstm.resetState();
+        TensorPtr restart = lstm (x1);
+        for (size_t i = 0; i < 2 * N * H; ++i) CHECK (restart->data()[i] == doctest::Approx (y1->data()[i]));
+    }
+}
+
+TEST_CASE ("Self-attention matches the direct softmax and finite differences")
+{
+    // Two query and key tiles, the second one partial
+    const size_t N = 2, L = 70, D = 8, heads = 2, dh = D / heads;
+    TensorPtr qkv = Tensor::Random ({N, L, 3 * D});
+    const double* p = qkv->data();
+
+    for (bool causal : {false, true})
+    {
+        CAPTURE (causal);
+        TensorPtr out = Tensor::selfAttention (qkv, heads, causal);
+        REQUIRE (out->shape() == Tensor::Shape{N, L, D});
+
+        for (size_t n = 0; n < N; ++n)
+            for (size_t h = 0; h < heads; ++h)
+                for (size_t i = 0; i < L; ++i)
+                {
+                    const size_t keys = causal ? i + 1 : L;
+                    const double* q = p + (n * L + i) * 3 * D + h * dh;
+                    std::vector<double> w (keys);
+                    double maxScore = -1e300, total = 0.0;
+                    for (size_t j = 0; j < keys; ++j)
+                    {
+                        const double* k = p + (n * L + j) * 3 * D + D + h * dh;
+                        w[j] = 0.0;
+                        for (size_t c = 0; c < dh; ++c) w[j] += q[c] * k[c];
+                        w[j] /= std::sqrt (double (dh));
+                        maxScore = std::max (maxScore, w[j]);
+                    }
+                    for (double& v : w) total += v = std::exp (v - maxScore);
+                    for (size_t c = 0; c < dh; ++c)
+                    {
+                        double expected = 0.0;
+                        for (size_t j = 0; j < keys; ++j) expected += w[j] / total * p[(n * L + j) * 3 * D + 2 * D + h * dh + c];
+                        CHECK (out->data()[(n * L + i) * D + h * dh + c] == doctest::Approx (expected));
+                    }
+                }
+
+        // Every 37th element: 91 of them, spread over both sequences and all of q, k and v
+        checkGradient (qkv, [&]() { TensorPtr o = Tensor::selfAttention (qkv, heads, causal); return Tensor::sum (Tensor::mul (o, o)); }, 37);
+    }
+
+    SUBCASE ("MultiHeadAttention module gradients")
+    {
+        MultiHeadAttention attention (D, heads, true);
+        TensorPtr x = Tensor::Random ({2, 5, D});
+        auto build = [&]() { TensorPtr o = attention (x); return Tensor::sum (Tensor::mul (o, o)); };
+        for (auto& param : attention.tensor_parameters()) checkGradient (param, build);
+        checkGradient (x, build);
+        CHECK_THROWS_AS (MultiHeadAttention (D, 3), std::invalid_argument);
+    }
+}
+
+TEST_CASE ("Normalization layers match the direct formulas and finite differences")
+{
+    SUBCASE ("LayerNorm")
+    {
+        LayerNorm norm (10);
+        for (auto& p : norm.tensor_parameters())
+            for (size_t i = 0; i < p->numel(); ++i) p->data()[i] += 0.5 * generateRandomDouble();
+
+        TensorPtr x = Tensor::Random ({3, 2, 10});
+        TensorPtr y = norm (x);
+        REQUIRE (y->shape() == x->shape());
+        for (size_t r = 0; r < 6; ++r)
+        {
+            const double* xr = x->data() + r * 10;
+            double mean = 0.0, var = 0.0;
+            for (size_t k = 0; k < 10; ++k) mean += xr[k] / 10.0;
+            for (size_t k = 0; k < 10; ++k) var += (xr[k] - mean) * (xr[k] - mean) / 10.0;
+            for (size_t k = 0; k < 10; ++k)
+            {
+                const double expected = (xr[k] - mean) / std::sqrt (var + 1e-5) * norm.scale()->at (k) + norm.shift()->at (k);
+                CHECK (y->data()[r * 10 + k] == doctest::Approx (expected));
+            }
+        }
+
+        TensorPtr weights = Tensor::Random ({3, 2, 10});
+        weights->set_requires_grad (false);
+        auto build = [&]() { return Tensor::sum (Tensor::mul (norm (x), weights)); };
+        checkGradient (x, build);
+        checkGradient (norm.scale(), build);
+        checkGradient (norm.shift(), build);
+    }
+
+    SUBCASE ("LayerNorm statistics stay accurate with a large offset")
+    {
+        // Several merged blocks, values 1e6 apart from their spread
+        const size_t D = 1000;
+        std::vector<double> v (D);
+        for (auto& e : v) e = 1e6 + generateRandomDouble();
+        LayerNorm norm (D);
+        TensorPtr y = norm (Tensor::FromData ({1, D}, v));
+
+        double mean = 0.0, var = 0.0;
+        for (double e : v) mean += (e - 1e6) / D;
+        for (double e : v) var += (e - 1e6 - mean) * (e - 1e6 - mean) / D;
+        for (size_t k = 0; k < D; ++k)
+        {
+            CHECK (y->data()[k] == doctest::Approx ((v[k] - 1e6 - mean) / std::sqrt (var + 1e-5)).epsilon (1e-7));
+        }
+    }
+
+    SUBCASE ("BatchNorm training")
+    {
+        const size_t N = 6, D = 5;
+        BatchNorm norm (D, 0.1);
+        TensorPtr x = Tensor::Random ({N, D});
+        TensorPtr y = norm (x);
+
+        for (size_t k = 0; k < D; ++k)
+        {
+            double mean = 0.0, var = 0.0;
+            for (size_t n = 0; n < N; ++n) mean += x->at (n, k) / N;
+            for (size_t n = 0; n < N; ++n) var += (x->at (n, k) - mean) * (x->at (n, k) - mean) / N;
+            for (size_t n = 0; n < N; ++n)
+            {
+                CHECK (y->at (n, k) == doctest::Approx ((x->at (n, k) - mean) / std::sqrt (var + 1e-5)));
+            }
+            CHECK (norm.running_mean()[k] == doctest::Approx (0.1 * mean));
+            CHECK (norm.running_var()[k] == doctest::Approx (0.9 + 0.1 * var * N / (N - 1)));
+        }
+
+        TensorPtr weights = Tensor::Random ({N, D});
+        weights->set_requires_grad (false);
+        for (size_t i = 0; i < D; ++i) norm.scale()->data()[i] += 0.5 * generateRandomDouble();
+        auto build = [&]() { return Tensor::sum (Tensor::mul (norm (x), weights)); };
+        checkGradient (x, build);
+        checkGradient (norm.scale(), build);
+        checkGradient (norm.shift(), build);
+    }
+
+    SUBCASE ("BatchNorm running variance far below eps")
+    {
+        // The variance is ~1e-18, so 1 / rstd^2 - eps would keep no correct digits
+        const size_t N = 4, D = 2;
+        BatchNorm norm (D, 1.0);
+        TensorPtr x = Tensor::Create ({N, D});
+        for (size_t n = 0; n < N; ++n)
+        {
+            x->at (n, 0) = 1.0 + 1e-9 * n;
+            x->at (n, 1) = 2.0 - 3e-9 * n * n;
+        }
+        norm (x);
+
+        for (size_t k = 0; k < D; ++k)
+        {
+            double mean = 0.0, var = 0.0;
+            for (size_t n = 0; n < N; ++n) mean += x->at (n, k) / N;
+            for (size_t n = 0; n < N; ++n) var += (x->at (n, k) - mean) * (x->at (n, k) - mean) / (N - 1);
+            CHECK (norm.running_var()[k] == doctest::Approx (var).scale (0.0).epsilon (1e-6));
+        }
+    }
+
+    SUBCASE ("BatchNorm folds into the preceding layer")
+    {
+        TensorLayer linear (4, 5, Activation::None);
+        BatchNorm norm (5);
+        for (int step = 0; step < 20; ++step)
+        {
+            TensorPtr batch = Tensor::Random ({8, 4});
+            norm (linear (batch));
+        }
+        for (size_t i = 0; i < 5; ++i)
+        {
+            norm.scale()->data()[i] = 1.0 + 0.5 * generateRandomDouble();
+            norm.shift()->data()[i] = 0.5 * generateRandomDouble();
+        }
+
+        norm.train (false);
+        TensorPtr x = Tensor::Random ({3, 4});
+        TensorPtr expected = Tensor::tanH (norm (linear (x)));
+        const uint64_t drawn = threadRandomStream (12345).position();
+        TensorLayer folded = foldBatchNorm (linear, norm, Activation::TanH);
+        CHECK (threadRandomStream (12345).position() == drawn);
+        TensorPtr actual = folded (x);
+        for (size_t i = 0; i < expected->numel(); ++i)
+        {
+            CHECK (actual->data()[i] == doctest::Approx (expected->data()[i]));
+        }
+
+        TensorLayer nonlinear (4, 5);
+        CHECK_THROWS_AS (foldBatchNorm (nonlinear, norm), std::invalid_argument);
+
+        norm.train (true);
+        CHECK_THROWS_AS (foldBatchNorm (linear, norm), std::invalid_argument);
+    }
+}
+
+TEST_CASE ("Dropout regenerates its mask in backward")
+{
+    TensorPtr x = Tensor::Random ({4, 50});
+    Dropout dropout (0.25, 1234);
+
+    TensorPtr first = dropout (x, Activation::TanH);
+    TensorPtr second = dropout (x, Activation::TanH);
+    CHECK (dropout.steps() == 2);
+    CHECK (first->to_vector() != second->to_vector());
+
+    // The same seed and step reproduce the mask, so the loss is a smooth function of x
+    auto build = [&]() { TensorPtr y = Tensor::dropout (x, 0.25, 1234, 0, Activation::TanH); return Tensor::sum (Tensor::mul (y, y)); };
+    CHECK (Tensor::dropout (x, 0.25, 1234, 0, Activation::TanH)->to_vector() == first->to_vector());
+    checkGradient (x, build);
+
+    dropout.train (false);
+    TensorPtr inference = dropout (x, Activation::TanH);
+    for (size_t i = 0; i < x->numel(); ++i) CHECK (inference->data()[i] == doctest::Approx (std::tanh (x->data()[i])));
+    CHECK_THROWS_AS (Dropout (1.0), std::invalid_argument);
+}
+
+TEST_CASE ("Memory planner reuses buffers without changing gradients")
+{
+    const size_t N = 6;
+    TensorLayer first (8, 16, Activation::TanH), second (16, 16, Activation::None), third (16, 4, Activation::None);
+    LayerNorm norm (16);
+    TensorPtr x = Tensor::Random ({N, 8});
+    TensorPtr target = Tensor::Random ({N, 4});
+    x->set_requires_grad (false);
+    target->set_requires_grad (false);
+
+    auto build = [&]() { return Tensor::mseLoss (third (Tensor::relu (second (norm (first (x))))), target); };
+    std::vector<TensorPtr> params = { first.weights(), first.biases(), second.weights(), second.biases(), third.weights() };
+
+    auto gradients = [&]()
+    {
+        std::vector<double> g;
+        for (auto& p : params)
+        {
+            std::vector<double> pg = p->grad_vector();
+            g.insert (g.end(), pg.begin(), pg.end());
+        }
+        return g;
+    };
+
+    for (auto& p : params) p->zero_grad();
+    build()->backward();
+    std::vector<double> expected = gradients();
+
+    // Planned backward gives the same leaf gradients, also when the slabs are reused
+    MemoryPlanner planner;
+    for (int step = 0; step < 2; ++step)
+    {
+        for (auto& p : params) p->zero_grad();
+        const MemoryReport& report = planner.backward (build());
+        CHECK (gradients() == expected);
+
+        CHECK (report.gradientSlabs < report.gradientBuffers);
+        CHECK (report.peakGradientBytes <= report.plannedGradientBytes);
+        CHECK (report.plannedGradientBytes < report.naiveGradientBytes);
+        CHECK (report.peakValueBytes <= report.plannedValueBytes);
+        CHECK (report.plannedValueBytes <= report.naiveValueBytes);
+        CHECK (report.savedBytes() > 0);
+        CHECK (report.toJson()["bytes"]["saved"] == report.savedBytes());
+    }
+
+    // Without gradients, each elementwise op of the chain takes over its input's buffer
+    TensorPtr W = Tensor::Random ({16, 8}), b = Tensor::Create ({16});
+    W->set_requires_grad (false);
+    b->set_requires_grad (false);
+    TensorPtr y = Tensor::sigmoid (Tensor::scale (Tensor::tanH (Tensor::dense (x, W, b, Activation::None)), 0.5));
+    const MemoryReport& inference = planner.plan (Tensor::sum (y));
+    CHECK (inference.gradientBuffers == 0);
+    CHECK (inference.valueBuffers == 4);
+    CHECK (inference.inPlace == 3);
+    CHECK (inference.valueSlabs == 1);
+    CHECK (inference.plannedValueBytes == N * 16 * sizeof (double));
+}
+
+class Application : public Jahley::App
+{
+ public:
+    Application() :
+        Jahley::App()
+    {
+        doctest::Context().run();
+    }
+
+ private:
+};
+
+Jahley::App* Jahley::CreateApplication()
+{
+    return new Application();
+}